@@ -2,8 +2,23 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#ifdef SETSUNA_APP_EGL
+#	include <EGL/egl.h>
+#	include <EGL/eglext.h>
+#	ifndef EGL_PLATFORM_SURFACELESS_MESA
+#		define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#	endif
+#endif
+
 #include <setsuna_app/app_glfw.h>
+#include <setsuna/gl_state.h>
+#include <setsuna/geometry_manager.h>
+#include <setsuna/readback_manager.h>
+#include <setsuna/upload_queue.h>
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <numeric>
 
 namespace setsuna {
 
@@ -12,10 +27,26 @@ app_glfw* app_glfw::_instance = nullptr;
 app_glfw::app_glfw(std::string_view name,
                    uint32_t window_width, uint32_t window_height,
                    int gl_major, int gl_minor) :
-    m_name(name),
-    m_window_width{window_width}, m_window_height{window_height} {
+    m_name(name), m_window{nullptr},
+    m_window_width{window_width}, m_window_height{window_height},
+    m_run_mode{run_mode::RM_SERIAL}, m_slot_started(2), m_stopping{false},
+    m_latency_ms{0.0}, m_average_latency_ms{0.0},
+    m_headless_frames{0}, m_frames{0}, m_stop_requested{false},
+    m_egl_display{nullptr}, m_egl_context{nullptr},
+    m_offscreen_framebuffer{0}, m_offscreen_renderbuffers{0, 0} {
 	_instance = this;
 
+	if (auto frames = std::getenv("SETSUNA_HEADLESS_FRAMES")) {
+		m_headless_frames = static_cast<uint32_t>(std::max(0l, std::strtol(frames, nullptr, 10)));
+	}
+
+	if (headless()) {
+		if (!init_headless(gl_major, gl_minor)) {
+			std::exit(EXIT_FAILURE);
+		}
+		return;
+	}
+
 	glfwSetErrorCallback(error_cb);
 
 	if (!glfwInit()) {
@@ -34,6 +65,24 @@ app_glfw::app_glfw(std::string_view name,
 }
 
 app_glfw::~app_glfw() {
+	// the singletons holding OpenGL objects must release them while the context is alive
+	geometry_manager::instance().release();
+	readback_manager::instance().release();
+	upload_queue::instance().release();
+
+	if (headless()) {
+#ifdef SETSUNA_APP_EGL
+		gl_state::instance().set_default_framebuffer(0);
+		glDeleteFramebuffers(1, &m_offscreen_framebuffer);
+		glDeleteRenderbuffers(2, m_offscreen_renderbuffers);
+
+		eglMakeCurrent(m_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(m_egl_display, m_egl_context);
+		eglTerminate(m_egl_display);
+#endif
+		return;
+	}
+
 	glfwDestroyWindow(m_window);
 	glfwTerminate();
 }
@@ -67,22 +116,260 @@ void app_glfw::init_window(int gl_major, int gl_minor) {
 	glfwSwapInterval(1);
 }
 
+bool app_glfw::init_headless(int gl_major, int gl_minor) {
+#ifdef SETSUNA_APP_EGL
+	// prefer the surfaceless platform, which needs neither a display server nor a GPU
+	EGLDisplay display = EGL_NO_DISPLAY;
+	auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+	  eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (get_platform_display) {
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (display == EGL_NO_DISPLAY) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint egl_major, egl_minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &egl_major, &egl_minor)) {
+		std::cerr << "Could not initialize EGL" << std::endl;
+		return false;
+	}
+
+	const EGLint config_attribs[] = {
+	  EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+	  EGL_NONE};
+	EGLConfig config;
+	EGLint configs_count = 0;
+	if (!eglBindAPI(EGL_OPENGL_API) ||
+	    !eglChooseConfig(display, config_attribs, &config, 1, &configs_count) ||
+	    configs_count == 0) {
+		std::cerr << "Could not find an OpenGL capable EGL config" << std::endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	const EGLint context_attribs[] = {
+	  EGL_CONTEXT_MAJOR_VERSION, gl_major,
+	  EGL_CONTEXT_MINOR_VERSION, gl_minor,
+	  EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+	  EGL_NONE};
+	auto context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+	if (context == EGL_NO_CONTEXT ||
+	    !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		std::cerr << "Could not create a surfaceless OpenGL context" << std::endl;
+		if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+		eglTerminate(display);
+		return false;
+	}
+	m_egl_display = display;
+	m_egl_context = context;
+
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+		std::cerr << "Could not initialize context" << std::endl;
+		return false;
+	}
+
+	// there is no default framebuffer without a surface, render into an offscreen one
+	m_framebuffer_width = m_window_width;
+	m_framebuffer_height = m_window_height;
+
+	glCreateRenderbuffers(2, m_offscreen_renderbuffers);
+	glNamedRenderbufferStorage(m_offscreen_renderbuffers[0], GL_RGBA8,
+	                           m_framebuffer_width, m_framebuffer_height);
+	glNamedRenderbufferStorage(m_offscreen_renderbuffers[1], GL_DEPTH24_STENCIL8,
+	                           m_framebuffer_width, m_framebuffer_height);
+
+	glCreateFramebuffers(1, &m_offscreen_framebuffer);
+	glNamedFramebufferRenderbuffer(m_offscreen_framebuffer, GL_COLOR_ATTACHMENT0,
+	                               GL_RENDERBUFFER, m_offscreen_renderbuffers[0]);
+	glNamedFramebufferRenderbuffer(m_offscreen_framebuffer, GL_DEPTH_STENCIL_ATTACHMENT,
+	                               GL_RENDERBUFFER, m_offscreen_renderbuffers[1]);
+	if (glCheckNamedFramebufferStatus(m_offscreen_framebuffer, GL_FRAMEBUFFER) !=
+	    GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Could not create the offscreen framebuffer" << std::endl;
+		return false;
+	}
+	gl_state::instance().set_default_framebuffer(m_offscreen_framebuffer);
+
+	std::cout << "Running headless for " << m_headless_frames << " frames on "
+	          << glGetString(GL_RENDERER) << std::endl;
+	return true;
+#else
+	std::cerr << "Headless mode requires EGL, which was not found at build time" << std::endl;
+	return false;
+#endif
+}
+
 void app_glfw::start() {
 	init();
-	run();
+
+	m_frames = 0;
+	m_frame_times.clear();
+	m_last_present = clock::now();
+
+	if (m_run_mode == run_mode::RM_PIPELINED) {
+		run_pipelined();
+	}
+	else {
+		run();
+	}
+
+	if (headless()) {
+		report_timings();
+	}
+}
+
+void app_glfw::set_run_mode(run_mode mode, uint32_t snapshots_count) {
+	m_run_mode = mode;
+	m_slot_started.resize(std::max(snapshots_count, 2u));
 }
 
 void app_glfw::stop() {
-	glfwSetWindowShouldClose(m_window, GL_TRUE);
+	if (headless()) {
+		m_stop_requested = true;
+	}
+	else {
+		glfwSetWindowShouldClose(m_window, GL_TRUE);
+	}
 }
 
-void app_glfw::run() {
-	while (!glfwWindowShouldClose(m_window)) {
+bool app_glfw::running() const {
+	if (headless()) {
+		return !m_stop_requested && m_frames < m_headless_frames;
+	}
+	return !glfwWindowShouldClose(m_window);
+}
+
+void app_glfw::poll_events() {
+	if (!headless()) {
 		glfwPollEvents();
+	}
+}
+
+void app_glfw::present() {
+	if (headless()) {
+		// nothing throttles the loop, so wait for the GPU to measure the real frame time
+		glFinish();
+
+		auto now = clock::now();
+		m_frame_times.push_back(std::chrono::duration<double, std::milli>(now - m_last_present).count());
+		m_last_present = now;
+	}
+	else {
+		glfwSwapBuffers(m_window);
+	}
+	++m_frames;
+}
+
+void app_glfw::report_timings() const {
+	if (m_frame_times.empty()) return;
+
+	auto sorted = m_frame_times;
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&sorted](double p) {
+		return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(p * sorted.size()))];
+	};
+	auto total = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+	auto average = total / sorted.size();
+
+	std::cout << m_name << ": " << sorted.size() << " frames in " << total << " ms\n"
+	          << "  frame time (ms): avg " << average
+	          << ", min " << sorted.front()
+	          << ", p50 " << percentile(0.5)
+	          << ", p95 " << percentile(0.95)
+	          << ", max " << sorted.back() << "\n"
+	          << "  fps: " << 1000.0 / average << "\n"
+	          << "  average latency (ms): " << m_average_latency_ms << std::endl;
+}
+
+void app_glfw::run() {
+	while (running()) {
+		auto started = clock::now();
+		poll_events();
+		gl_update();
 		update();
 		render();
-		glfwSwapBuffers(m_window);
+		present();
+		record_latency(started);
+	}
+}
+
+void app_glfw::run_pipelined() {
+	m_free_slots.clear();
+	m_ready_slots.clear();
+	for (uint32_t slot = 0; slot < m_slot_started.size(); ++slot) {
+		m_free_slots.push_back(slot);
+	}
+	m_stopping = false;
+	m_simulation_thread = std::thread(&app_glfw::simulate, this);
+
+	while (running()) {
+		poll_events();
+
+		uint32_t slot;
+		{
+			std::unique_lock<std::mutex> lock(m_queue_mutex);
+			// do not block forever so that window events keep being processed
+			if (!m_ready_cv.wait_for(lock, std::chrono::milliseconds(100),
+			                         [this]() { return !m_ready_slots.empty(); })) {
+				continue;
+			}
+			slot = m_ready_slots.front();
+			m_ready_slots.pop_front();
+		}
+
+		gl_update();
+		consume(slot);
+		render();
+		present();
+		record_latency(m_slot_started[slot]);
+
+		{
+			std::lock_guard<std::mutex> lock(m_queue_mutex);
+			m_free_slots.push_back(slot);
+		}
+		m_free_cv.notify_one();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_queue_mutex);
+		m_stopping = true;
 	}
+	m_free_cv.notify_one();
+	m_simulation_thread.join();
+}
+
+void app_glfw::simulate() {
+	while (true) {
+		uint32_t slot;
+		{
+			std::unique_lock<std::mutex> lock(m_queue_mutex);
+			m_free_cv.wait(lock, [this]() { return m_stopping || !m_free_slots.empty(); });
+			if (m_stopping) return;
+			slot = m_free_slots.front();
+			m_free_slots.pop_front();
+		}
+
+		m_slot_started[slot] = clock::now();
+		update();
+		publish(slot);
+
+		{
+			std::lock_guard<std::mutex> lock(m_queue_mutex);
+			m_ready_slots.push_back(slot);
+		}
+		m_ready_cv.notify_one();
+	}
+}
+
+void app_glfw::record_latency(clock::time_point started) {
+	m_latency_ms = std::chrono::duration<double, std::milli>(clock::now() - started).count();
+
+	// exponential moving average over roughly the last 60 frames
+	constexpr double weight = 1.0 / 60.0;
+	m_average_latency_ms = m_average_latency_ms == 0.0
+	                         ? m_latency_ms
+	                         : m_average_latency_ms + (m_latency_ms - m_average_latency_ms) * weight;
 }
 
 void app_glfw::on_window_resize(int width, int height) {
@@ -1,15 +1,36 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 struct GLFWwindow;
 
 namespace setsuna {
 
+/*
+Set the environment variable SETSUNA_HEADLESS_FRAMES to a positive number to
+run without a window: the context is created by EGL without any surface
+(requires EGL_MESA_platform_surfaceless or EGL_KHR_surfaceless_context, e.g.
+Mesa llvmpipe), the default framebuffer is replaced by an offscreen one, and the
+app exits after rendering that many frames, printing the frame timings.
+*/
 class app_glfw {
 
 public:
+	enum class run_mode {
+		// poll, update, render and swap on one thread
+		RM_SERIAL,
+		// update frame N+1 on a simulation thread while rendering frame N
+		RM_PIPELINED
+	};
+
 	app_glfw(std::string_view name,
 	         uint32_t window_width, uint32_t window_height,
 	         int gl_major = 4, int gl_minor = 2);
@@ -25,13 +46,50 @@ public:
 	void start();
 	void stop();
 
+	// call before start(), snapshots_count is the depth of the handoff queue (at least 2)
+	void set_run_mode(run_mode mode, uint32_t snapshots_count = 2);
+
+	// time from the start of update() to the end of the swap of the same frame, in milliseconds
+	double frame_latency() const { return m_latency_ms; }
+	double average_frame_latency() const { return m_average_latency_ms; }
+
+	bool headless() const { return m_headless_frames > 0; }
+
 protected:
 	virtual void init() = 0;
+
+	/*
+	In pipelined mode update() runs on the simulation thread, which has no
+	OpenGL context, so it must not call OpenGL, neither directly nor through
+	the engine, e.g. resource_manager::update() finishing loaders on the main
+	thread or upload_queue::update(). Do those in gl_update() instead.
+	*/
 	virtual void update() = 0;
 	virtual void render() = 0;
 
+	/*
+	Called once per frame on the GL thread, right before update() in serial
+	mode and right before consume() in pipelined mode, for the polling that
+	needs the context.
+	*/
+	virtual void gl_update() {}
+
+	/*
+	Only called in pipelined mode. After update() the simulation thread calls
+	publish() to copy everything render() needs into the snapshot 'slot', and the
+	GL thread calls consume() with the same slot right before render(). A slot
+	is never published and consumed at the same time, but update() and render()
+	do run concurrently, so render() must only read the consumed snapshot.
+
+	Input callbacks always run on the GL thread, concurrently with update() in
+	pipelined mode, so guard whatever they share with update().
+	*/
+	virtual void publish(uint32_t slot) {}
+	virtual void consume(uint32_t slot) {}
+
 	// main loop
 	void run();
+	void run_pipelined();
 
 	virtual void on_window_resize(int width, int height);
 	// the size of a framebuffer may change independently of the size of a window
@@ -57,7 +115,45 @@ protected:
 	static app_glfw* _instance;
 
 private:
+	using clock = std::chrono::steady_clock;
+
 	void init_window(int gl_major, int gl_minor);
+	bool init_headless(int gl_major, int gl_minor);
+
+	bool running() const;
+	void poll_events();
+	void present();
+	void report_timings() const;
+
+	void simulate();
+
+	void record_latency(clock::time_point started);
+
+	run_mode m_run_mode;
+
+	// bounded handoff queue between the simulation and the GL thread
+	std::mutex m_queue_mutex;
+	std::condition_variable m_free_cv;
+	std::condition_variable m_ready_cv;
+	std::deque<uint32_t> m_free_slots;
+	std::deque<uint32_t> m_ready_slots;
+	std::vector<clock::time_point> m_slot_started;
+	bool m_stopping;
+	std::thread m_simulation_thread;
+
+	double m_latency_ms;
+	double m_average_latency_ms;
+
+	// headless mode
+	uint32_t m_headless_frames;
+	uint32_t m_frames;
+	std::atomic<bool> m_stop_requested;
+	clock::time_point m_last_present;
+	void* m_egl_display;
+	void* m_egl_context;
+	unsigned int m_offscreen_framebuffer;
+	unsigned int m_offscreen_renderbuffers[2];
+	std::vector<double> m_frame_times;
 
 	static void error_cb(int error, const char* description);
 	static void window_size_cb(GLFWwindow*, int width, int height);
@@ -0,0 +1,174 @@
+#include <setsuna_app/app_glfw.h>
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/geometry.h>
+#include <setsuna/shader_program.h>
+#include <setsuna/command_buffer.h>
+#include <setsuna/thread_pool.h>
+#include <setsuna/camera.h>
+#include <setsuna/logger.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+
+using namespace setsuna;
+
+/*
+Measure the throughput of command recording, on one thread and on the
+thread pool, and of replaying the recorded commands on the OpenGL thread.
+Every object records one matrix upload, a vertex array bind and a draw.
+
+The app runs pipelined: the simulation thread moves the objects for the next
+frame while the GL thread records and replays the current one.
+*/
+class app : public app_glfw {
+
+public:
+	app(std::string_view name) :
+	    app_glfw(name, 800, 600, 4, 5), m_time{0.0f}, m_frame_worlds{nullptr}, m_frames{0},
+	    m_serial_ms{0.0}, m_parallel_ms{0.0}, m_replay_ms{0.0},
+	    m_serial_commands{0}, m_parallel_commands{0} {
+		m_worlds.resize(objects_count);
+		m_snapshots.resize(snapshots_count);
+		set_run_mode(run_mode::RM_PIPELINED, snapshots_count);
+	}
+
+private:
+	static constexpr uint32_t objects_count = 100000;
+	static constexpr std::size_t objects_per_chunk = 2048;
+	static constexpr uint32_t frames_per_report = 120;
+	static constexpr uint32_t snapshots_count = 3;
+
+	using clock = std::chrono::steady_clock;
+
+	void init() override {
+		m_mesh = geometry::sphere(0.1f, 8, 8);
+
+		m_shader_program.add_shader(shader_type::ST_VERTEX, "shaders/simple.vert");
+		m_shader_program.add_shader(shader_type::ST_FRAGMENT, "shaders/simple.frag");
+		m_shader_program.compile();
+		m_shader_program.apply();
+		m_shader_program.upload_uniform("projection",
+		                                glm::perspective(glm::radians(75.0f),
+		                                                 m_window_width / float(m_window_height),
+		                                                 0.01f, 1000.0f));
+		m_shader_program.upload_uniform("view", glm::mat4(1.0f));
+
+		// -1 if the shader has no such uniform, which OpenGL silently ignores
+		m_world_location = m_shader_program.uniform_location("world");
+
+		m_chunks.resize(m_pool.chunks_count(objects_count, objects_per_chunk));
+
+		glViewport(0, 0, m_framebuffer_width, m_framebuffer_height);
+		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	// on the simulation thread, no OpenGL here
+	void update() override {
+		m_time += 1.0f / 60.0f;
+		for (uint32_t i = 0; i < objects_count; ++i) {
+			auto x = float(i % 400) - 200.0f;
+			auto y = float(i / 400 % 250) - 125.0f;
+			auto z = -150.0f + glm::sin(m_time + 0.01f * float(i));
+			m_worlds[i] = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z));
+		}
+	}
+
+	// every matrix is rewritten by the next update(), so the buffers are swapped rather than copied
+	void publish(uint32_t slot) override {
+		m_worlds.swap(m_snapshots[slot]);
+		m_worlds.resize(objects_count);
+	}
+
+	void consume(uint32_t slot) override {
+		m_frame_worlds = &m_snapshots[slot];
+	}
+
+	void render() override {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// single threaded recording for reference
+		auto t0 = clock::now();
+		m_serial.clear();
+		record(m_serial, 0, objects_count);
+		auto t1 = clock::now();
+
+		auto chunk_size = (objects_count + m_chunks.size() - 1) / m_chunks.size();
+		m_pool.run(m_chunks.size(), [&](std::size_t chunk) {
+			auto begin = chunk * chunk_size;
+			auto end = std::min<std::size_t>(begin + chunk_size, objects_count);
+			m_chunks[chunk].clear();
+			record(m_chunks[chunk], begin, end);
+		});
+		auto t2 = clock::now();
+
+		std::size_t commands = 0;
+		for (auto& cmds : m_chunks) {
+			cmds.replay();
+			commands += cmds.size();
+		}
+		auto t3 = clock::now();
+
+		using ms = std::chrono::duration<double, std::milli>;
+		m_serial_ms += ms(t1 - t0).count();
+		m_parallel_ms += ms(t2 - t1).count();
+		m_replay_ms += ms(t3 - t2).count();
+		m_serial_commands += m_serial.size();
+		m_parallel_commands += commands;
+
+		if (++m_frames == frames_per_report) {
+			LOG_MESSAGE("Commands per ms: record %.0f (1 thread), record %.0f (%u threads), replay %.0f, "
+			            "frame latency %.2f ms",
+			            m_serial_commands / m_serial_ms,
+			            m_parallel_commands / m_parallel_ms, m_pool.threads_count() + 1,
+			            m_parallel_commands / m_replay_ms, average_frame_latency());
+			m_frames = 0;
+			m_serial_ms = m_parallel_ms = m_replay_ms = 0.0;
+			m_serial_commands = m_parallel_commands = 0;
+		}
+	}
+
+	void record(command_buffer& cmds, std::size_t begin, std::size_t end) {
+		cmds.use_program(m_shader_program.name());
+		auto& worlds = *m_frame_worlds;
+		for (auto i = begin; i < end; ++i) {
+			cmds.uniform(m_world_location, m_mesh->instance_matrix(worlds[i]));
+			m_mesh->record(cmds);
+		}
+	}
+
+	void on_framebuffer_resize(int width, int height) override {
+		app_glfw::on_framebuffer_resize(width, height);
+		glViewport(0, 0, m_framebuffer_width, m_framebuffer_height);
+	}
+
+private:
+	ref<mesh> m_mesh;
+
+	// written by update(), handed to render() through the snapshots
+	float m_time;
+	std::vector<glm::mat4> m_worlds;
+	std::vector<std::vector<glm::mat4>> m_snapshots;
+	const std::vector<glm::mat4>* m_frame_worlds;
+	shader_program m_shader_program;
+	GLint m_world_location;
+
+	thread_pool m_pool;
+	command_buffer m_serial;
+	std::vector<command_buffer> m_chunks;
+
+	uint32_t m_frames;
+	double m_serial_ms;
+	double m_parallel_ms;
+	double m_replay_ms;
+	// every chunk records its own program switch, so the counts differ
+	std::size_t m_serial_commands;
+	std::size_t m_parallel_commands;
+};
+
+int main() {
+	auto papp = new app("Command buffer benchmark");
+	papp->start();
+	delete papp;
+
+	return 0;
+}
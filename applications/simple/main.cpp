@@ -6,6 +6,9 @@
 #include <setsuna/geometry.h>
 #include <setsuna/resource_manager.h>
 #include <setsuna/texture_manager.h>
+#include <setsuna/upload_queue.h>
+#include <setsuna/instance_batcher.h>
+#include <setsuna/logger.h>
 #include <setsuna_loaders/texture_loader.h>
 
 #include <setsuna/material.h>
@@ -21,7 +24,7 @@ class app : public app_glfw {
 
 public:
 	app(std::string_view name) :
-	    app_glfw(name, 800, 600, 4, 5) {
+	    app_glfw(name, 800, 600, 4, 5), m_collapsed_draws{0} {
 		m_scene = new object3d();
 	}
 
@@ -76,29 +79,43 @@ private:
 		//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	}
 
-	void update() override {
+	void gl_update() override {
 		resource_manager::instance().update();
+		upload_queue::instance().update();
+	}
 
+	void update() override {
 		m_scene->accept(update_visitor{});
 	}
 
 	void render() override {
+		// everything allocated last frame is dead now
+		m_frame_allocator.reset();
+
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		m_shader_program.upload_uniform("view",
 		                                m_camera->view_matrix());
 
-		simple_culler sc(*m_camera, simple_culler::mode::CM_BOUNDING_BOX);
+		simple_culler sc(*m_camera, simple_culler::mode::CM_BOUNDING_BOX, m_frame_allocator);
 		m_scene->accept(sc);
+		sc.render_queue.sort();
+
+		// world matrices are fed as instance attributes and
+		// material properties are read from a shader storage block
+		// coarser levels of detail deviate by about a pixel on screen
+		instance_batcher::lod_selection lods{
+		  glm::vec3(glm::inverse(m_camera->view_matrix())[3]),
+		  m_camera->projection_matrix()[1][1] * m_framebuffer_height * 0.5f, 1.0f};
+		m_batcher.build(sc.render_queue, &lods);
+		for (auto& batch : m_batcher.batches()) {
+			m_batcher.render(batch);
+		}
+		m_batcher.flush();
 
-		for (auto& item : sc.render_queue) {
-			m_shader_program.upload_uniform("world", item.world_matrix);
-			ref<texture> tex;
-			item.material->get_property("albedo", tex);
-			m_shader_program.upload_uniform("u_tex",
-			                                tex->address());
-
-			item.mesh->render();
+		if (m_batcher.collapsed_draws() != m_collapsed_draws) {
+			m_collapsed_draws = m_batcher.collapsed_draws();
+			LOG_MESSAGE("Draw calls collapsed by instancing: %u", m_collapsed_draws);
 		}
 	}
 
@@ -114,6 +131,9 @@ private:
 	camera* m_camera;
 	material m_material;
 	shader_program m_shader_program;
+	frame_allocator m_frame_allocator;
+	instance_batcher m_batcher;
+	uint32_t m_collapsed_draws;
 };
 
 int main() {
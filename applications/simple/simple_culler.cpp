@@ -4,29 +4,44 @@
 #include <setsuna/camera.h>
 #include <setsuna/mesh_filter.h>
 #include <setsuna/mesh_renderer.h>
+#include <setsuna/skinned_mesh.h>
 
 using namespace setsuna;
 
-simple_culler::simple_culler(camera& cam, simple_culler::mode mode) :
-    visitor(traversal_mode::TM_CHILDREN), m_camera{&cam}, m_cull_mode{mode} {}
+simple_culler::simple_culler(camera& cam, simple_culler::mode mode, frame_allocator& allocator) :
+    visitor(traversal_mode::TM_CHILDREN), render_queue(allocator), m_camera{&cam}, m_cull_mode{mode} {
+	render_queue.begin(cam);
+}
 
 void simple_culler::apply(object3d& o3d) {
+	auto culled = [this](const auto& bounds) {
+		if (m_cull_mode == mode::CM_BOUNDING_BOX) {
+			return !m_camera->frustum().intersect(bounds.bounding_box());
+		}
+		return !m_camera->frustum().intersect(bounds.bounding_sphere());
+	};
+
+	// skinned meshes are drawn from their dynamic meshes
+	auto skinned = o3d.get_component<skinned_mesh>();
+	if (skinned != nullptr && !culled(*skinned)) {
+		render_queue.push(render_item{
+		                    &o3d.world_matrix(),
+		                    nullptr,
+		                    skinned->material.get(),
+		                    skinned->target().get()},
+		                  setsuna::render_queue::pass::RP_OPAQUE);
+	}
+
 	auto renderer = o3d.get_component<mesh_renderer>();
 	auto filter = o3d.get_component<mesh_filter>();
 	if (renderer == nullptr || filter == nullptr) return;
 
-	bool culled = true;
-	if (m_cull_mode == mode::CM_BOUNDING_BOX) {
-		culled = !m_camera->frustum().intersect(renderer->bounding_box());
-	}
-	else {
-		culled = !m_camera->frustum().intersect(renderer->bounding_sphere());
-	}
-
-	if (culled) return;
+	if (culled(*renderer)) return;
 
-	render_queue.emplace_back(render_item{
-	  o3d.world_matrix(),
-	  filter->mesh,
-	  renderer->material});
+	render_queue.push(render_item{
+	                    &o3d.world_matrix(),
+	                    filter->mesh.get(),
+	                    renderer->material.get(),
+	                    nullptr},
+	                  setsuna::render_queue::pass::RP_OPAQUE);
 }
@@ -1,25 +1,14 @@
 #pragma once
 
 #include <setsuna/visitor.h>
-#include <setsuna/ref.h>
-#include <glm/glm.hpp>
-#include <vector>
+#include <setsuna/render_queue.h>
 
 namespace setsuna {
 
 class camera;
-class mesh;
-class material_instance;
 
 }  // namespace setsuna
 
-struct render_item {
-
-	glm::mat4 world_matrix;
-	setsuna::ref<setsuna::mesh> mesh;
-	setsuna::ref<setsuna::material_instance> material;
-};
-
 class simple_culler : public setsuna::visitor {
 
 public:
@@ -28,11 +17,11 @@ public:
 		CM_BOUNDING_SPHERE
 	};
 
-	simple_culler(setsuna::camera&, mode);
+	simple_culler(setsuna::camera&, mode, setsuna::frame_allocator&);
 
 	void apply(setsuna::object3d&) override;
 
-	std::vector<render_item> render_queue;
+	setsuna::render_queue render_queue;
 
 private:
 	// do frustum culling according to this camera
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+/** @file
+@brief Header for @ref setsuna::mapped_file
+*/
+
+namespace setsuna {
+
+/**
+@brief Read-only memory mapping of a whole file
+*/
+class mapped_file {
+
+public:
+	/**
+	@brief Default constructor, nothing is mapped
+	*/
+	mapped_file();
+
+	/**
+	@brief Destructor
+	*/
+	~mapped_file();
+
+	/**
+	@brief Copying is not allowed
+	*/
+	mapped_file(const mapped_file&) = delete;
+
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	/**
+	@brief Move-constructor
+	*/
+	mapped_file(mapped_file&& other) noexcept;
+
+	/**
+	@brief Move assignment
+	*/
+	mapped_file& operator=(mapped_file&& other) noexcept;
+
+	/**
+	@brief Map @p filename , the previous mapping is closed
+
+	@return Whether the file is mapped, an empty file is never mapped
+	*/
+	bool open(std::string_view filename);
+
+	/**
+	@brief Unmap the file
+	*/
+	void close();
+
+	/**
+	@brief Touch every page so that later reads do not fault
+
+	Call it on a loading thread to keep page-ins off the main thread.
+	*/
+	void prefetch() const;
+
+	/**
+	@brief Get the mapped data, nullptr if nothing is mapped
+	*/
+	const uint8_t* data() const { return m_data; }
+
+	/**
+	@brief Get the size of the mapped data in bytes
+	*/
+	std::size_t size() const { return m_size; }
+
+private:
+	const uint8_t* m_data;
+	std::size_t m_size;
+
+	// file and mapping handles on Windows
+	void* m_file;
+	void* m_mapping;
+};
+
+}  // namespace setsuna
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <setsuna/vertex_layout.h>
+#include <setsuna/aabb.h>
+#include <setsuna/sphere.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::mesh_file
+*/
+
+namespace setsuna {
+
+/**
+@brief Format of one vertex attribute in a mesh file, see @ref setsuna::vertex_attribute_format
+*/
+struct mesh_file_attribute {
+	uint32_t attribindex; /**< @brief Attribute location in the vertex shader */
+	uint32_t components;  /**< @brief Number of elementary data per attribute */
+	uint32_t type;        /**< @brief Type of the elementary data, e.g. @p GL_FLOAT */
+	uint32_t offset;      /**< @brief Offset in bytes relative to the start of a vertex */
+	uint32_t normalized;  /**< @brief Whether integer data is normalized, 0 or 1 */
+};
+
+/**
+@brief Header at the start of a mesh file
+
+All values are little-endian. The vertices and the indices are stored right
+after the header at 16-byte aligned offsets, exactly as they are uploaded.
+*/
+struct mesh_file_header {
+	char magic[4];                             /**< @brief Always @p SMSH */
+	uint32_t version;                          /**< @brief @ref setsuna::mesh_file::version */
+	uint32_t attributes_count;                 /**< @brief Number of used entries in @ref attributes */
+	uint32_t stride;                           /**< @brief Size of an interleaved vertex in bytes */
+	uint32_t vertices_count;                   /**< @brief Number of vertices */
+	uint32_t indices_count;                    /**< @brief Number of indices, 0 if not indexed */
+	uint32_t index_type;                       /**< @brief @p GL_UNSIGNED_BYTE , @p GL_UNSIGNED_SHORT or @p GL_UNSIGNED_INT */
+	uint32_t flags;                            /**< @brief Combination of @ref setsuna::mesh_file::quantized_flag */
+	float bounds_min[3];                       /**< @brief Minimum of the bounding box in model space */
+	float bounds_max[3];                       /**< @brief Maximum of the bounding box in model space */
+	float sphere_center[3];                    /**< @brief Center of the bounding sphere in model space */
+	float sphere_radius;                       /**< @brief Radius of the bounding sphere */
+	float dequantization_offset[3];            /**< @brief See @ref setsuna::mesh::set_dequantization() */
+	float dequantization_scale;                /**< @brief See @ref setsuna::mesh::set_dequantization() */
+	uint64_t vertices_offset;                  /**< @brief Offset of the vertices from the start of the file */
+	uint64_t indices_offset;                   /**< @brief Offset of the indices from the start of the file */
+	mesh_file_attribute attributes[12];        /**< @brief Vertex attributes, locations 12 and above are reserved for instancing */
+};
+
+static_assert(sizeof(mesh_file_header) == 344, "mesh_file_header must not be padded");
+
+/**
+@brief Compact binary mesh container
+
+A mesh file is laid out to be memory-mapped and uploaded without parsing,
+see @ref setsuna::mesh_loader . Write one from any attributes, for example:
+
+@code{.cpp}
+vertex_layout layout;
+uint32_t count;
+auto vertices = mesh::interleave(layout, count, positions, texcoords, normals);
+mesh_file::write("models/rock.smsh", layout, vertices.data(), count, indices,
+                 box, bounding_sphere);
+@endcode
+*/
+class mesh_file {
+
+public:
+	/**
+	@brief Current version of the format
+	*/
+	static constexpr uint32_t version = 1;
+
+	/**
+	@brief The positions are quantized and need the dequantization transform
+	*/
+	static constexpr uint32_t quantized_flag = 1;
+
+	/**
+	@brief Write a mesh file
+
+	@param filename				Path of the file
+	@param layout				Layout of the vertices
+	@param vertices				Interleaved vertex data, @p layout.stride * @p vertices_count bytes
+	@param vertices_count		Number of vertices
+	@param indices				Triangle list, stored in the narrowest integer type possible
+	@param box					Bounding box in model space
+	@param bounding_sphere		Bounding sphere in model space
+	@param dequantization_scale	Scale of the dequantization, 0 if the positions are not quantized
+	@param dequantization_offset	Offset of the dequantization
+
+	@return Whether the file is written
+	*/
+	static bool write(std::string_view filename,
+	                  const vertex_layout& layout,
+	                  const void* vertices,
+	                  uint32_t vertices_count,
+	                  const std::vector<uint32_t>& indices,
+	                  const aabb<3>& box,
+	                  const sphere& bounding_sphere,
+	                  float dequantization_scale = 0.0f,
+	                  const glm::vec3& dequantization_offset = glm::vec3(0.0f));
+
+	/**
+	@brief Check that @p size bytes at @p data hold a complete mesh file
+
+	@return The header, or nullptr if the data is not a valid mesh file of this version
+	*/
+	static const mesh_file_header* validate(const uint8_t* data, std::size_t size);
+
+	/**
+	@brief Get the vertex layout described by @p header
+	*/
+	static vertex_layout layout(const mesh_file_header& header);
+};
+
+}  // namespace setsuna
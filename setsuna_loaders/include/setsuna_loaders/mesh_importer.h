@@ -0,0 +1,93 @@
+#pragma once
+
+#include <setsuna/mesh.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::mesh_importer
+*/
+
+namespace setsuna {
+
+class thread_pool;
+
+/**
+@brief Triangle mesh produced by @ref setsuna::mesh_importer
+
+The attributes are at locations 0, 1 and 2 in the order of declaration, the same
+as the meshes of @ref setsuna::geometry . Texture coordinates or normals are
+empty if the file has none, which @ref setsuna::mesh::create() skips.
+*/
+struct imported_mesh {
+	attribute<glm::vec3> positions; /**< @brief Positions */
+	attribute<glm::vec2> texcoords; /**< @brief Texture coordinates, as stored in the file */
+	attribute<glm::vec3> normals;   /**< @brief Normals */
+	std::vector<uint32_t> indices;  /**< @brief Triangle list */
+
+	/**
+	@brief Default constructor, all streams are empty
+	*/
+	imported_mesh() :
+	    positions(3, GL_FLOAT, {}), texcoords(2, GL_FLOAT, {}), normals(3, GL_FLOAT, {}) {}
+};
+
+/**
+@brief Parallel importer of Wavefront OBJ and glTF 2.0 meshes
+
+The file is memory-mapped and parsed by a @ref setsuna::thread_pool :
+- OBJ files are split into ranges of whole lines, every range is parsed
+  independently, and relative indices are resolved afterwards;
+- glTF files (@p .gltf with external or embedded buffers, or @p .glb ) are
+  decoded accessor by accessor, every accessor split across the threads.
+  The triangles of all primitives of all meshes are merged, node transforms
+  are not applied, sparse accessors are not supported.
+
+Identical vertices are then welded by hash tables sharded across the threads.
+The throughput is logged as a message. Usage example:
+
+@code{.cpp}
+thread_pool pool;
+imported_mesh imported;
+if (mesh_importer::import("models/sponza.obj", imported, pool)) {
+	auto mesh = mesh::create_indexed(true, std::move(imported.indices), mesh_optimization::MO_ALL,
+	                                 imported.positions, imported.texcoords, imported.normals);
+	mesh->calculate_bounding_box(imported.positions.data, &pool);
+}
+@endcode
+
+Nothing here calls OpenGL, so importing could also run on a loading thread.
+*/
+class mesh_importer {
+
+public:
+	/**
+	@brief Statistics of the last import
+	*/
+	struct statistics {
+		std::size_t bytes;            /**< @brief Size of the file */
+		double seconds;               /**< @brief Time from mapping the file to welding the vertices */
+		double megabytes_per_second;  /**< @brief Throughput */
+		std::size_t corners_count;    /**< @brief Number of vertices before welding */
+		std::size_t vertices_count;   /**< @brief Number of vertices after welding */
+	};
+
+	/**
+	@brief Import @p filename by its extension, @p .obj , @p .gltf or @p .glb
+
+	@param filename	Path of the file
+	@param result	Receives the mesh
+	@param pool		Threads to parse with
+	@param stats	Receives the statistics if not nullptr
+
+	@return Whether the import succeeded, errors are logged
+	*/
+	static bool import(std::string_view filename,
+	                   imported_mesh& result,
+	                   thread_pool& pool,
+	                   statistics* stats = nullptr);
+};
+
+}  // namespace setsuna
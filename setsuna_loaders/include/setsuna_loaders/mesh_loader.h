@@ -0,0 +1,81 @@
+#pragma once
+
+#include <setsuna/loader.h>
+#include <setsuna/mesh.h>
+#include <setsuna/ref.h>
+#include <setsuna_loaders/mapped_file.h>
+#include <setsuna_loaders/mesh_file.h>
+#include <string>
+#include <string_view>
+
+/** @file
+@brief Header for @ref setsuna::mesh_loader
+*/
+
+namespace setsuna {
+
+/**
+@brief Mesh loader of @ref setsuna::mesh_file
+
+The file is memory-mapped and paged in on the loading thread, then the vertices
+and indices are uploaded straight from the mapping on the main thread, so
+loading costs one page-in and one copy, with nothing parsed.
+
+Usage example:
+
+@code{.cpp}
+resource_manager::instance().load<mesh_loader>(
+	[&filter](ref<resource> loaded) {
+		filter.mesh = static_cast<mesh*>(loaded.get());
+	},
+	"models/rock.smsh"
+);
+@endcode
+
+Until loading finishes, @ref get() returns an empty mesh which draws nothing.
+*/
+class mesh_loader : public loader {
+
+	RTTI_ENABLE(mesh_loader, loader)
+
+public:
+	/**
+	@brief Constructor
+
+	@param mesh_name Filename of the mesh file
+	*/
+	mesh_loader(std::string_view mesh_name);
+
+	/**
+	@brief Destructor
+	*/
+	~mesh_loader() {}
+
+	void create_resource() override;
+
+	void sub_thread_stage() override;
+
+	void main_thread_stage() override;
+
+	bool match(const loader&) const override;
+
+	/**
+	@brief Get the loading result
+
+	@return Return the loaded mesh if loading has finished,
+	otherwise return an empty mesh
+	*/
+	ref<resource> get() const override { return m_mesh; }
+
+protected:
+	std::string m_mesh_name;
+
+	mapped_file m_file;
+
+	// points into m_file, nullptr if the file is invalid
+	const mesh_file_header* m_header;
+
+	ref<mesh> m_mesh;
+};
+
+}  // namespace setsuna
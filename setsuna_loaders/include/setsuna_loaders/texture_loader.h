@@ -2,6 +2,7 @@
 
 #include <setsuna/loader.h>
 #include <setsuna/texture.h>
+#include <setsuna/upload_queue.h>
 #include <setsuna/ref.h>
 #include <string>
 #include <string_view>
@@ -17,6 +18,10 @@ namespace setsuna {
 
 Supported formats: 8bit per-channel JPEG/PNG/BMP/TGA
 
+The decoded pixels are copied into @ref setsuna::upload_queue on the loading
+thread whenever it has room, so the main thread only queues the copy into the
+texture, otherwise they are uploaded synchronously.
+
 Usage example:
 
 @code{.cpp}
@@ -47,7 +52,10 @@ public:
 	/**
 	@brief Destructor
 	*/
-	~texture_loader() {}
+	~texture_loader() {
+		// never reached the main thread, give the staging memory back
+		if (m_staged) upload_queue::instance().release(m_staged.value());
+	}
 
 	void create_resource() override;
 
@@ -72,6 +80,9 @@ protected:
 
 	uint8_t* m_data;
 
+	// the pixels in the staging ring of the upload queue, if it had room
+	std::optional<upload_queue::staging_region> m_staged;
+
 	ref<texture> m_texture;
 };
 
@@ -0,0 +1,136 @@
+#include <setsuna_loaders/mapped_file.h>
+#include <setsuna/logger.h>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace setsuna {
+
+mapped_file::mapped_file() :
+    m_data{nullptr}, m_size{0}, m_file{nullptr}, m_mapping{nullptr} {}
+
+mapped_file::~mapped_file() {
+	close();
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept :
+    m_data{other.m_data}, m_size{other.m_size}, m_file{other.m_file}, m_mapping{other.m_mapping} {
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_file = nullptr;
+	other.m_mapping = nullptr;
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+	if (this != &other) {
+		close();
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_file, other.m_file);
+		std::swap(m_mapping, other.m_mapping);
+	}
+	return *this;
+}
+
+bool mapped_file::open(std::string_view filename) {
+	close();
+	std::string name(filename);
+
+#ifdef _WIN32
+	auto file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+	                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		LOG_ERROR("Failed to open file: %s", name.c_str());
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	auto data = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (data == nullptr) {
+		LOG_ERROR("Failed to map file: %s", name.c_str());
+		if (mapping != nullptr) CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file = file;
+	m_mapping = mapping;
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+	auto fd = ::open(name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		LOG_ERROR("Failed to open file: %s", name.c_str());
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	auto data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping stays valid after closing the descriptor
+	::close(fd);
+	if (data == MAP_FAILED) {
+		LOG_ERROR("Failed to map file: %s", name.c_str());
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = static_cast<std::size_t>(st.st_size);
+#endif
+
+	return true;
+}
+
+void mapped_file::close() {
+	if (m_data == nullptr) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+#else
+	munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+	m_file = nullptr;
+	m_mapping = nullptr;
+}
+
+void mapped_file::prefetch() const {
+	if (m_data == nullptr) return;
+
+#ifndef _WIN32
+	madvise(const_cast<uint8_t*>(m_data), m_size, MADV_WILLNEED);
+#endif
+
+	// volatile so that the reads are not optimized away
+	volatile uint8_t sink = 0;
+	for (std::size_t offset = 0; offset < m_size; offset += 4096) {
+		sink = sink + m_data[offset];
+	}
+	(void)sink;
+}
+
+}  // namespace setsuna
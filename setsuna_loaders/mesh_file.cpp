@@ -0,0 +1,152 @@
+#include <setsuna_loaders/mesh_file.h>
+#include <setsuna/logger.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace setsuna {
+
+static constexpr uint64_t data_alignment = 16;
+
+static uint64_t align(uint64_t offset) {
+	return (offset + data_alignment - 1) / data_alignment * data_alignment;
+}
+
+static uint32_t index_size(uint32_t type) {
+	switch (type) {
+	case GL_UNSIGNED_BYTE:
+		return sizeof(uint8_t);
+	case GL_UNSIGNED_SHORT:
+		return sizeof(uint16_t);
+	case GL_UNSIGNED_INT:
+		return sizeof(uint32_t);
+	default:
+		return 0;
+	}
+}
+
+template<typename T>
+static std::vector<uint8_t> pack_indices(const std::vector<uint32_t>& indices) {
+	std::vector<uint8_t> result(indices.size() * sizeof(T));
+	for (std::size_t i = 0; i < indices.size(); ++i) {
+		auto index = static_cast<T>(indices[i]);
+		std::memcpy(result.data() + i * sizeof(T), &index, sizeof(T));
+	}
+	return result;
+}
+
+bool mesh_file::write(std::string_view filename,
+                      const vertex_layout& layout,
+                      const void* vertices,
+                      uint32_t vertices_count,
+                      const std::vector<uint32_t>& indices,
+                      const aabb<3>& box,
+                      const sphere& bounding_sphere,
+                      float dequantization_scale,
+                      const glm::vec3& dequantization_offset) {
+	std::string name(filename);
+
+	mesh_file_header header;
+	std::memset(&header, 0, sizeof(header));
+	if (layout.attributes.size() > std::size(header.attributes)) {
+		LOG_ERROR("Too many vertex attributes to write mesh file: %s", name.c_str());
+		return false;
+	}
+
+	std::memcpy(header.magic, "SMSH", 4);
+	header.version = version;
+	header.attributes_count = static_cast<uint32_t>(layout.attributes.size());
+	header.stride = layout.stride;
+	header.vertices_count = vertices_count;
+	header.indices_count = static_cast<uint32_t>(indices.size());
+	header.flags = dequantization_scale > 0.0f ? quantized_flag : 0;
+	for (int i = 0; i < 3; ++i) {
+		header.bounds_min[i] = box.min[i];
+		header.bounds_max[i] = box.max[i];
+		header.sphere_center[i] = bounding_sphere.center[i];
+		header.dequantization_offset[i] = dequantization_offset[i];
+	}
+	header.sphere_radius = bounding_sphere.radius;
+	header.dequantization_scale = dequantization_scale;
+	for (std::size_t i = 0; i < layout.attributes.size(); ++i) {
+		auto& attr = layout.attributes[i];
+		header.attributes[i] = mesh_file_attribute{attr.attribindex, attr.components, attr.type,
+		                                           attr.offset, attr.normalized ? 1u : 0u};
+	}
+
+	// same choice as mesh::set_indices()
+	std::vector<uint8_t> packed;
+	if (vertices_count <= 0x100) {
+		header.index_type = GL_UNSIGNED_BYTE;
+		packed = pack_indices<uint8_t>(indices);
+	}
+	else if (vertices_count <= 0x10000) {
+		header.index_type = GL_UNSIGNED_SHORT;
+		packed = pack_indices<uint16_t>(indices);
+	}
+	else {
+		header.index_type = GL_UNSIGNED_INT;
+		packed = pack_indices<uint32_t>(indices);
+	}
+
+	auto vertices_size = uint64_t(layout.stride) * vertices_count;
+	header.vertices_offset = align(sizeof(header));
+	header.indices_offset = align(header.vertices_offset + vertices_size);
+
+	std::ofstream file(name, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		LOG_ERROR("Failed to open mesh file for writing: %s", name.c_str());
+		return false;
+	}
+
+	static const char zeros[data_alignment] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(zeros, header.vertices_offset - sizeof(header));
+	file.write(static_cast<const char*>(vertices), vertices_size);
+	file.write(zeros, header.indices_offset - header.vertices_offset - vertices_size);
+	file.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+
+	if (!file) {
+		LOG_ERROR("Failed to write mesh file: %s", name.c_str());
+		return false;
+	}
+	return true;
+}
+
+const mesh_file_header* mesh_file::validate(const uint8_t* data, std::size_t size) {
+	if (data == nullptr || size < sizeof(mesh_file_header)) return nullptr;
+
+	auto header = reinterpret_cast<const mesh_file_header*>(data);
+	if (std::memcmp(header->magic, "SMSH", 4) != 0 || header->version != version) return nullptr;
+	if (header->attributes_count > std::size(header->attributes)) return nullptr;
+
+	auto indices_size = uint64_t(index_size(header->index_type)) * header->indices_count;
+	if (header->indices_count > 0 && indices_size == 0) return nullptr;
+
+	auto vertices_size = uint64_t(header->stride) * header->vertices_count;
+	if (header->vertices_offset < sizeof(mesh_file_header) ||
+	    header->vertices_offset > size || vertices_size > size - header->vertices_offset) {
+		return nullptr;
+	}
+	if (header->indices_offset > size || indices_size > size - header->indices_offset) return nullptr;
+
+	for (uint32_t i = 0; i < header->attributes_count; ++i) {
+		if (header->attributes[i].offset >= header->stride) return nullptr;
+	}
+
+	return header;
+}
+
+vertex_layout mesh_file::layout(const mesh_file_header& header) {
+	vertex_layout result;
+	result.stride = header.stride;
+	for (uint32_t i = 0; i < header.attributes_count; ++i) {
+		auto& attr = header.attributes[i];
+		result.attributes.push_back(vertex_attribute_format{
+		  attr.attribindex, attr.components, attr.type, attr.offset, attr.normalized != 0});
+	}
+	return result;
+}
+
+}  // namespace setsuna
@@ -0,0 +1,1038 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna_loaders/mesh_importer.h>
+#include <setsuna_loaders/mapped_file.h>
+#include <setsuna/logger.h>
+#include <setsuna/thread_pool.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace setsuna {
+
+static constexpr auto no_index = std::numeric_limits<uint32_t>::max();
+
+// bytes of input handed to a thread at least, smaller files are parsed on fewer threads
+static constexpr std::size_t parse_grain = 1 << 20;
+
+// keys welded by a thread at least
+static constexpr std::size_t weld_grain = 1 << 16;
+
+// hash of the 32-bit words of a key
+template<typename Key>
+static uint64_t hash_key(const Key& key) {
+	static_assert(sizeof(Key) % sizeof(uint32_t) == 0, "keys must consist of 32-bit words");
+	uint32_t words[sizeof(Key) / sizeof(uint32_t)];
+	std::memcpy(words, &key, sizeof(Key));
+
+	uint64_t h = 0x9E3779B97F4A7C15ull;
+	for (auto w : words) {
+		h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+		h ^= h >> 32;
+	}
+	return h;
+}
+
+/*
+Welding of identical keys by hash tables sharded across the threads
+
+Every key is hashed once, and its index is put into the bucket of the shard
+its hash belongs to by a stable counting scatter. Every thread then welds only
+the keys of its own bucket into its own open addressing table, so no
+synchronization is needed and the total work stays linear in the keys. The
+welded identifiers are numbered shard by shard, in order of first occurrence
+within a shard, so the result does not depend on the scheduling.
+
+remap receives the welded identifier of every key, representatives receives
+the index of a key of every welded identifier. Keys are compared bitwise.
+*/
+template<typename Key>
+static void weld(const std::vector<Key>& keys,
+                 thread_pool& pool,
+                 std::vector<uint32_t>& remap,
+                 std::vector<uint32_t>& representatives) {
+	auto count = keys.size();
+	auto shards_count = pool.chunks_count(count, weld_grain);
+	auto chunk_size = (count + shards_count - 1) / shards_count;
+	auto shard_of = [shards_count](uint64_t h) { return static_cast<std::size_t>((h >> 40) % shards_count); };
+
+	remap.resize(count);
+
+	// hash the keys and count the keys of every shard, per chunk of keys
+	std::vector<uint64_t> hashes(count);
+	std::vector<uint32_t> starts(shards_count * shards_count, 0);
+	pool.run(shards_count, [&](std::size_t chunk) {
+		auto begin = chunk * chunk_size;
+		auto end = std::min(begin + chunk_size, count);
+		auto chunk_counts = &starts[chunk * shards_count];
+		for (auto i = begin; i < end; ++i) {
+			hashes[i] = hash_key(keys[i]);
+			++chunk_counts[shard_of(hashes[i])];
+		}
+	});
+
+	// the bucket of a shard holds the ranges of all chunks in order, so it stays sorted
+	std::vector<uint32_t> bucket_offsets(shards_count + 1, 0);
+	uint32_t next = 0;
+	for (std::size_t shard = 0; shard < shards_count; ++shard) {
+		bucket_offsets[shard] = next;
+		for (std::size_t chunk = 0; chunk < shards_count; ++chunk) {
+			auto chunk_count = starts[chunk * shards_count + shard];
+			starts[chunk * shards_count + shard] = next;
+			next += chunk_count;
+		}
+	}
+	bucket_offsets[shards_count] = next;
+
+	std::vector<uint32_t> buckets(count);
+	pool.run(shards_count, [&](std::size_t chunk) {
+		auto begin = chunk * chunk_size;
+		auto end = std::min(begin + chunk_size, count);
+		auto chunk_starts = &starts[chunk * shards_count];
+		for (auto i = begin; i < end; ++i) {
+			buckets[chunk_starts[shard_of(hashes[i])]++] = static_cast<uint32_t>(i);
+		}
+	});
+
+	std::vector<std::vector<uint32_t>> shard_representatives(shards_count);
+	pool.run(shards_count, [&](std::size_t shard) {
+		auto& shard_keys = shard_representatives[shard];
+		std::vector<uint32_t> table(1024, no_index);
+		auto mask = table.size() - 1;
+
+		for (auto b = bucket_offsets[shard]; b < bucket_offsets[shard + 1]; ++b) {
+			auto i = buckets[b];
+			auto slot = static_cast<std::size_t>(hashes[i]) & mask;
+			while (table[slot] != no_index &&
+			       std::memcmp(&keys[shard_keys[table[slot]]], &keys[i], sizeof(Key)) != 0) {
+				slot = (slot + 1) & mask;
+			}
+			if (table[slot] != no_index) {
+				remap[i] = table[slot];
+				continue;
+			}
+
+			auto id = static_cast<uint32_t>(shard_keys.size());
+			shard_keys.push_back(i);
+			table[slot] = id;
+			remap[i] = id;
+
+			// keep the load factor under a half
+			if (shard_keys.size() * 2 > table.size()) {
+				table.assign(table.size() * 2, no_index);
+				mask = table.size() - 1;
+				for (uint32_t k = 0; k < shard_keys.size(); ++k) {
+					auto s = static_cast<std::size_t>(hashes[shard_keys[k]]) & mask;
+					while (table[s] != no_index) s = (s + 1) & mask;
+					table[s] = k;
+				}
+			}
+		}
+	});
+
+	std::vector<uint32_t> shard_offsets(shards_count + 1, 0);
+	for (std::size_t s = 0; s < shards_count; ++s) {
+		shard_offsets[s + 1] = shard_offsets[s] + static_cast<uint32_t>(shard_representatives[s].size());
+	}
+	representatives.resize(shard_offsets.back());
+	for (std::size_t s = 0; s < shards_count; ++s) {
+		std::copy(shard_representatives[s].begin(), shard_representatives[s].end(),
+		          representatives.begin() + shard_offsets[s]);
+	}
+
+	if (shards_count > 1) {
+		pool.run(shards_count, [&](std::size_t shard) {
+			for (auto b = bucket_offsets[shard]; b < bucket_offsets[shard + 1]; ++b) {
+				remap[buckets[b]] += shard_offsets[shard];
+			}
+		});
+	}
+}
+
+/*
+Wavefront OBJ
+*/
+namespace {
+
+// indices into the concatenated streams, no_index if the corner has none
+struct obj_key {
+	uint32_t position;
+	uint32_t texcoord;
+	uint32_t normal;
+};
+
+// a corner as written, relative indices are counted from the start of its chunk
+struct obj_corner {
+	int32_t index[3];
+	uint32_t relative_mask;
+};
+
+struct obj_chunk {
+	const char* begin;
+	const char* end;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texcoords;
+	std::vector<glm::vec3> normals;
+	std::vector<obj_corner> corners;  // three per triangle
+	std::size_t error_offset;         // offset of the first malformed line from begin, or npos
+};
+
+}  // namespace
+
+static constexpr auto no_corner_index = std::numeric_limits<int32_t>::min();
+static constexpr auto no_error = std::string::npos;
+
+static bool is_blank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* skip_blanks(const char* p, const char* end) {
+	while (p < end && is_blank(*p)) ++p;
+	return p;
+}
+
+static bool parse_float(const char*& p, const char* end, float& value) {
+	p = skip_blanks(p, end);
+	if (p < end && *p == '+') ++p;
+	auto [next, error] = std::from_chars(p, end, value);
+	if (error != std::errc()) return false;
+	p = next;
+	return true;
+}
+
+template<typename T>
+static bool parse_floats(const char*& p, const char* end, T& value) {
+	for (int k = 0; k < T::length(); ++k) {
+		if (!parse_float(p, end, value[k])) return false;
+	}
+	return true;
+}
+
+// one index of a corner, into a stream that has local_count elements so far in this chunk
+static bool parse_index(const char*& p, const char* end, std::size_t local_count, obj_corner& corner, int k) {
+	long value = 0;
+	auto [next, error] = std::from_chars(p, end, value);
+	if (error != std::errc() || value == 0) return false;
+	p = next;
+
+	if (value > 0) {
+		if (value > std::numeric_limits<int32_t>::max()) return false;
+		corner.index[k] = static_cast<int32_t>(value - 1);
+	}
+	else {
+		// may be negative if it refers to a previous chunk
+		auto local = static_cast<long>(local_count) + value;
+		if (local <= no_corner_index) return false;
+		corner.index[k] = static_cast<int32_t>(local);
+		corner.relative_mask |= 1u << k;
+	}
+	return true;
+}
+
+static bool parse_face(const char* p, const char* end, obj_chunk& chunk) {
+	auto first = chunk.corners.size();
+	std::size_t count = 0;
+
+	while (true) {
+		p = skip_blanks(p, end);
+		if (p == end) break;
+
+		obj_corner corner{{no_corner_index, no_corner_index, no_corner_index}, 0};
+		if (!parse_index(p, end, chunk.positions.size(), corner, 0)) return false;
+		if (p < end && *p == '/') {
+			++p;
+			if (p < end && *p != '/' && !parse_index(p, end, chunk.texcoords.size(), corner, 1)) return false;
+			if (p < end && *p == '/') {
+				++p;
+				if (!parse_index(p, end, chunk.normals.size(), corner, 2)) return false;
+			}
+		}
+		if (p < end && !is_blank(*p)) return false;
+
+		// fan triangulation of polygons
+		if (count >= 3) {
+			auto pivot = chunk.corners[first];
+			auto previous = chunk.corners.back();
+			chunk.corners.push_back(pivot);
+			chunk.corners.push_back(previous);
+		}
+		chunk.corners.push_back(corner);
+		++count;
+	}
+
+	if (count < 3) {
+		chunk.corners.resize(first);
+		return false;
+	}
+	return true;
+}
+
+static void parse_obj_chunk(obj_chunk& chunk) {
+	chunk.error_offset = no_error;
+	auto p = chunk.begin;
+
+	while (p < chunk.end) {
+		auto line_end = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+		if (line_end == nullptr) line_end = chunk.end;
+
+		auto s = skip_blanks(p, line_end);
+		auto valid = true;
+		if (line_end - s >= 2 && s[0] == 'v' && is_blank(s[1])) {
+			glm::vec3 position;
+			s += 1;
+			valid = parse_floats(s, line_end, position);
+			chunk.positions.push_back(position);
+		}
+		else if (line_end - s >= 3 && s[0] == 'v' && s[1] == 't' && is_blank(s[2])) {
+			// a third coordinate is allowed and ignored
+			glm::vec2 texcoord;
+			s += 2;
+			valid = parse_floats(s, line_end, texcoord);
+			chunk.texcoords.push_back(texcoord);
+		}
+		else if (line_end - s >= 3 && s[0] == 'v' && s[1] == 'n' && is_blank(s[2])) {
+			glm::vec3 normal;
+			s += 2;
+			valid = parse_floats(s, line_end, normal);
+			chunk.normals.push_back(normal);
+		}
+		else if (line_end - s >= 2 && s[0] == 'f' && is_blank(s[1])) {
+			valid = parse_face(s + 1, line_end, chunk);
+		}
+		// comments, groups, materials and smoothing groups are ignored
+
+		if (!valid && chunk.error_offset == no_error) {
+			chunk.error_offset = static_cast<std::size_t>(p - chunk.begin);
+		}
+		p = line_end + 1;
+	}
+}
+
+static bool import_obj(const uint8_t* data,
+                       std::size_t size,
+                       imported_mesh& result,
+                       thread_pool& pool,
+                       std::size_t& corners_count) {
+	auto text = reinterpret_cast<const char*>(data);
+	auto text_end = text + size;
+
+	// split into ranges of whole lines
+	auto chunks_count = pool.chunks_count(size, parse_grain);
+	std::vector<obj_chunk> chunks(chunks_count);
+	auto begin = text;
+	for (std::size_t c = 0; c < chunks_count; ++c) {
+		auto end = c + 1 == chunks_count ? text_end : std::max(begin, text + size * (c + 1) / chunks_count);
+		if (end < text_end) {
+			auto newline = static_cast<const char*>(std::memchr(end, '\n', text_end - end));
+			end = newline == nullptr ? text_end : newline + 1;
+		}
+		chunks[c].begin = begin;
+		chunks[c].end = end;
+		begin = end;
+	}
+
+	pool.run(chunks_count, [&chunks](std::size_t c) { parse_obj_chunk(chunks[c]); });
+
+	// streams are concatenated in chunk order
+	std::vector<obj_key> keys;
+	std::size_t positions_base = 0, texcoords_base = 0, normals_base = 0, corners_base = 0;
+	std::vector<std::size_t> bases(chunks_count * 4);
+	for (std::size_t c = 0; c < chunks_count; ++c) {
+		auto& chunk = chunks[c];
+		if (chunk.error_offset != no_error) {
+			auto line = 1 + std::count(text, chunk.begin + chunk.error_offset, '\n');
+			LOG_ERROR("Malformed OBJ line %zu", static_cast<std::size_t>(line));
+			return false;
+		}
+		bases[c * 4] = positions_base;
+		bases[c * 4 + 1] = texcoords_base;
+		bases[c * 4 + 2] = normals_base;
+		bases[c * 4 + 3] = corners_base;
+		positions_base += chunk.positions.size();
+		texcoords_base += chunk.texcoords.size();
+		normals_base += chunk.normals.size();
+		corners_base += chunk.corners.size();
+	}
+	if (corners_base > no_index || positions_base >= no_index) {
+		LOG_ERROR("OBJ file too large");
+		return false;
+	}
+	keys.resize(corners_base);
+	corners_count = corners_base;
+
+	std::vector<glm::vec3> positions(positions_base);
+	std::vector<glm::vec2> texcoords(texcoords_base);
+	std::vector<glm::vec3> normals(normals_base);
+	std::size_t counts[3] = {positions_base, texcoords_base, normals_base};
+	std::atomic<bool> failed{false};
+
+	pool.run(chunks_count, [&](std::size_t c) {
+		auto& chunk = chunks[c];
+		std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + bases[c * 4]);
+		std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + bases[c * 4 + 1]);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + bases[c * 4 + 2]);
+
+		auto out = keys.begin() + bases[c * 4 + 3];
+		for (auto& corner : chunk.corners) {
+			uint32_t resolved[3];
+			for (int k = 0; k < 3; ++k) {
+				if (corner.index[k] == no_corner_index) {
+					resolved[k] = no_index;
+					continue;
+				}
+				auto index = static_cast<int64_t>(corner.index[k]);
+				if (corner.relative_mask & (1u << k)) index += static_cast<int64_t>(bases[c * 4 + k]);
+				if (index < 0 || static_cast<std::size_t>(index) >= counts[k]) {
+					failed = true;
+					index = 0;
+				}
+				resolved[k] = static_cast<uint32_t>(index);
+			}
+			*out++ = obj_key{resolved[0], resolved[1], resolved[2]};
+		}
+	});
+	if (failed) {
+		LOG_ERROR("OBJ face index out of range");
+		return false;
+	}
+
+	std::vector<uint32_t> representatives;
+	weld(keys, pool, result.indices, representatives);
+
+	// corners without texture coordinates or normals get zeros if others have them
+	auto vertices_count = representatives.size();
+	result.positions.data.resize(vertices_count);
+	result.texcoords.data.resize(texcoords.empty() ? 0 : vertices_count);
+	result.normals.data.resize(normals.empty() ? 0 : vertices_count);
+	pool.parallel_for(vertices_count, weld_grain, [&](std::size_t begin, std::size_t end) {
+		for (auto v = begin; v < end; ++v) {
+			auto& key = keys[representatives[v]];
+			result.positions.data[v] = positions[key.position];
+			if (!texcoords.empty()) {
+				result.texcoords.data[v] = key.texcoord == no_index ? glm::vec2(0.0f) : texcoords[key.texcoord];
+			}
+			if (!normals.empty()) {
+				result.normals.data[v] = key.normal == no_index ? glm::vec3(0.0f) : normals[key.normal];
+			}
+		}
+	});
+	return true;
+}
+
+/*
+glTF 2.0
+*/
+namespace {
+
+// just enough of JSON for glTF, keys and values of objects are in separate arrays
+struct json {
+	enum json_type { JT_NULL, JT_BOOLEAN, JT_NUMBER, JT_STRING, JT_ARRAY, JT_OBJECT };
+
+	json_type type = JT_NULL;
+	double number = 0.0;
+	std::string string;
+	std::vector<json> elements;
+	std::vector<std::string> keys;
+
+	const json* find(std::string_view key) const {
+		if (type != JT_OBJECT) return nullptr;
+		for (std::size_t i = 0; i < keys.size(); ++i) {
+			if (keys[i] == key) return &elements[i];
+		}
+		return nullptr;
+	}
+
+	const json* at(std::size_t index) const {
+		return type == JT_ARRAY && index < elements.size() ? &elements[index] : nullptr;
+	}
+
+	double number_or(std::string_view key, double fallback) const {
+		auto value = find(key);
+		return value != nullptr && value->type == JT_NUMBER ? value->number : fallback;
+	}
+
+	std::string_view string_or(std::string_view key, std::string_view fallback) const {
+		auto value = find(key);
+		return value != nullptr && value->type == JT_STRING ? std::string_view(value->string) : fallback;
+	}
+};
+
+class json_parser {
+
+public:
+	json_parser(const char* begin, const char* end) :
+	    m_p(begin), m_end(end) {}
+
+	bool parse(json& value) {
+		if (!parse_value(value, 0)) return false;
+		skip_blanks();
+		return m_p == m_end;
+	}
+
+private:
+	void skip_blanks() {
+		while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r')) ++m_p;
+	}
+
+	bool consume(std::string_view literal) {
+		if (static_cast<std::size_t>(m_end - m_p) < literal.size() ||
+		    std::string_view(m_p, literal.size()) != literal) {
+			return false;
+		}
+		m_p += literal.size();
+		return true;
+	}
+
+	bool parse_value(json& value, int depth) {
+		if (depth > 64) return false;
+		skip_blanks();
+		if (m_p == m_end) return false;
+
+		switch (*m_p) {
+		case '{': {
+			value.type = json::JT_OBJECT;
+			++m_p;
+			skip_blanks();
+			if (consume("}")) return true;
+			while (true) {
+				skip_blanks();
+				value.keys.emplace_back();
+				if (!parse_string(value.keys.back())) return false;
+				skip_blanks();
+				if (!consume(":")) return false;
+				value.elements.emplace_back();
+				if (!parse_value(value.elements.back(), depth + 1)) return false;
+				skip_blanks();
+				if (consume("}")) return true;
+				if (!consume(",")) return false;
+			}
+		}
+		case '[': {
+			value.type = json::JT_ARRAY;
+			++m_p;
+			skip_blanks();
+			if (consume("]")) return true;
+			while (true) {
+				value.elements.emplace_back();
+				if (!parse_value(value.elements.back(), depth + 1)) return false;
+				skip_blanks();
+				if (consume("]")) return true;
+				if (!consume(",")) return false;
+			}
+		}
+		case '"':
+			value.type = json::JT_STRING;
+			return parse_string(value.string);
+		case 't':
+			value.type = json::JT_BOOLEAN;
+			value.number = 1.0;
+			return consume("true");
+		case 'f':
+			value.type = json::JT_BOOLEAN;
+			return consume("false");
+		case 'n':
+			return consume("null");
+		default: {
+			value.type = json::JT_NUMBER;
+			auto [next, error] = std::from_chars(m_p, m_end, value.number);
+			if (error != std::errc()) return false;
+			m_p = next;
+			return true;
+		}
+		}
+	}
+
+	bool parse_string(std::string& s) {
+		if (!consume("\"")) return false;
+		while (m_p < m_end && *m_p != '"') {
+			if (*m_p != '\\') {
+				s.push_back(*m_p++);
+				continue;
+			}
+			if (++m_p == m_end) return false;
+			switch (*m_p++) {
+			case '"':
+				s.push_back('"');
+				break;
+			case '\\':
+				s.push_back('\\');
+				break;
+			case '/':
+				s.push_back('/');
+				break;
+			case 'b':
+				s.push_back('\b');
+				break;
+			case 'f':
+				s.push_back('\f');
+				break;
+			case 'n':
+				s.push_back('\n');
+				break;
+			case 'r':
+				s.push_back('\r');
+				break;
+			case 't':
+				s.push_back('\t');
+				break;
+			case 'u': {
+				// UTF-16 surrogates are not combined, names and URIs are ASCII in practice
+				uint32_t code = 0;
+				if (m_end - m_p < 4) return false;
+				auto [next, error] = std::from_chars(m_p, m_p + 4, code, 16);
+				if (error != std::errc() || next != m_p + 4) return false;
+				m_p = next;
+				if (code < 0x80) {
+					s.push_back(static_cast<char>(code));
+				}
+				else if (code < 0x800) {
+					s.push_back(static_cast<char>(0xC0 | (code >> 6)));
+					s.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+				}
+				else {
+					s.push_back(static_cast<char>(0xE0 | (code >> 12)));
+					s.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+					s.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+				}
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		return consume("\"");
+	}
+
+	const char* m_p;
+	const char* m_end;
+};
+
+struct gltf_buffer {
+	const uint8_t* data;
+	std::size_t size;
+};
+
+// a resolved accessor, data points to its first element
+struct gltf_accessor {
+	const uint8_t* data;
+	std::size_t count;
+	std::size_t stride;
+	uint32_t component_type;
+	uint32_t components;
+	bool normalized;
+};
+
+struct gltf_primitive {
+	gltf_accessor positions;
+	gltf_accessor texcoords;  // data is nullptr if absent
+	gltf_accessor normals;    // data is nullptr if absent
+	gltf_accessor indices;    // data is nullptr if not indexed
+	std::size_t first_vertex;
+	std::size_t first_index;
+};
+
+// the welding key of a glTF vertex
+struct gltf_vertex {
+	glm::vec3 position;
+	glm::vec2 texcoord;
+	glm::vec3 normal;
+};
+
+}  // namespace
+
+static constexpr uint32_t glb_magic = 0x46546C67;       // "glTF"
+static constexpr uint32_t glb_json_chunk = 0x4E4F534A;  // "JSON"
+static constexpr uint32_t glb_bin_chunk = 0x004E4942;   // "BIN\0"
+
+static uint32_t read_u32(const uint8_t* p) {
+	uint32_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static std::size_t component_size(uint32_t component_type) {
+	switch (component_type) {
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:
+		return 1;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+		return 2;
+	case GL_UNSIGNED_INT:
+	case GL_FLOAT:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+static uint32_t type_components(std::string_view type) {
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	return 0;
+}
+
+static bool decode_base64(std::string_view text, std::vector<uint8_t>& bytes) {
+	auto sextet = [](char c) -> int {
+		if (c >= 'A' && c <= 'Z') return c - 'A';
+		if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+		if (c >= '0' && c <= '9') return c - '0' + 52;
+		if (c == '+') return 62;
+		if (c == '/') return 63;
+		return -1;
+	};
+
+	bytes.clear();
+	bytes.reserve(text.size() / 4 * 3);
+	uint32_t bits = 0;
+	int bits_count = 0;
+	for (auto c : text) {
+		if (c == '=') break;
+		auto value = sextet(c);
+		if (value < 0) return false;
+		bits = (bits << 6) | static_cast<uint32_t>(value);
+		bits_count += 6;
+		if (bits_count >= 8) {
+			bits_count -= 8;
+			bytes.push_back(static_cast<uint8_t>(bits >> bits_count));
+		}
+	}
+	return true;
+}
+
+static bool resolve_accessor(const json& document,
+                             const std::vector<gltf_buffer>& buffers,
+                             std::size_t index,
+                             gltf_accessor& result) {
+	auto accessors = document.find("accessors");
+	auto views = document.find("bufferViews");
+	auto accessor = accessors != nullptr ? accessors->at(index) : nullptr;
+	if (accessor == nullptr || views == nullptr) return false;
+
+	if (accessor->find("sparse") != nullptr) {
+		LOG_ERROR("Sparse glTF accessors are not supported");
+		return false;
+	}
+	auto view = views->at(static_cast<std::size_t>(accessor->number_or("bufferView", -1.0)));
+	if (view == nullptr) return false;
+	auto buffer_index = static_cast<std::size_t>(view->number_or("buffer", -1.0));
+	if (buffer_index >= buffers.size()) return false;
+
+	result.component_type = static_cast<uint32_t>(accessor->number_or("componentType", 0.0));
+	result.components = type_components(accessor->string_or("type", ""));
+	result.count = static_cast<std::size_t>(accessor->number_or("count", 0.0));
+	auto normalized = accessor->find("normalized");
+	result.normalized = normalized != nullptr && normalized->type == json::JT_BOOLEAN && normalized->number != 0.0;
+
+	auto element_size = component_size(result.component_type) * result.components;
+	if (element_size == 0) return false;
+	result.stride = static_cast<std::size_t>(view->number_or("byteStride", 0.0));
+	if (result.stride == 0) result.stride = element_size;
+
+	auto view_offset = static_cast<std::size_t>(view->number_or("byteOffset", 0.0));
+	auto view_length = static_cast<std::size_t>(view->number_or("byteLength", 0.0));
+	auto offset = static_cast<std::size_t>(accessor->number_or("byteOffset", 0.0));
+	auto& buffer = buffers[buffer_index];
+	if (view_offset + view_length > buffer.size) return false;
+	if (result.count > 0 && offset + (result.count - 1) * result.stride + element_size > view_length) return false;
+
+	result.data = buffer.data + view_offset + offset;
+	return true;
+}
+
+// component c of element i as a float, normalized integers are mapped to [0, 1] or [-1, 1]
+static float read_component(const gltf_accessor& a, std::size_t i, uint32_t c) {
+	auto p = a.data + i * a.stride + c * component_size(a.component_type);
+	switch (a.component_type) {
+	case GL_FLOAT: {
+		float value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	case GL_UNSIGNED_BYTE:
+		return a.normalized ? *p / 255.0f : *p;
+	case GL_BYTE: {
+		auto value = static_cast<int8_t>(*p);
+		return a.normalized ? std::max(value / 127.0f, -1.0f) : value;
+	}
+	case GL_UNSIGNED_SHORT: {
+		uint16_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return a.normalized ? value / 65535.0f : value;
+	}
+	case GL_SHORT: {
+		int16_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return a.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+	}
+	default:
+		return 0.0f;
+	}
+}
+
+static uint32_t read_index(const gltf_accessor& a, std::size_t i) {
+	auto p = a.data + i * a.stride;
+	switch (a.component_type) {
+	case GL_UNSIGNED_BYTE:
+		return *p;
+	case GL_UNSIGNED_SHORT: {
+		uint16_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	default:
+		return read_u32(p);
+	}
+}
+
+static bool import_gltf(std::string_view filename,
+                        const uint8_t* data,
+                        std::size_t size,
+                        imported_mesh& result,
+                        thread_pool& pool,
+                        std::size_t& corners_count) {
+	// a binary glTF has the document and its first buffer in chunks
+	const char* json_begin = reinterpret_cast<const char*>(data);
+	const char* json_end = json_begin + size;
+	gltf_buffer bin{nullptr, 0};
+	if (size >= 12 && read_u32(data) == glb_magic) {
+		if (read_u32(data + 4) != 2) {
+			LOG_ERROR("Unsupported glTF version");
+			return false;
+		}
+		std::size_t offset = 12;
+		while (offset + 8 <= size) {
+			auto length = read_u32(data + offset);
+			auto type = read_u32(data + offset + 4);
+			if (offset + 8 + length > size) break;
+			if (type == glb_json_chunk) {
+				json_begin = reinterpret_cast<const char*>(data + offset + 8);
+				json_end = json_begin + length;
+			}
+			else if (type == glb_bin_chunk && bin.data == nullptr) {
+				bin = gltf_buffer{data + offset + 8, length};
+			}
+			offset += 8 + ((length + 3) & ~std::size_t(3));
+		}
+	}
+
+	json document;
+	if (!json_parser(json_begin, json_end).parse(document) || document.type != json::JT_OBJECT) {
+		LOG_ERROR("Malformed glTF document");
+		return false;
+	}
+
+	// buffers, external ones are mapped next to the document
+	std::string directory(filename.substr(0, filename.find_last_of("/\\") + 1));
+	std::vector<gltf_buffer> buffers;
+	std::vector<mapped_file> external_files;
+	std::vector<std::vector<uint8_t>> embedded_data;
+	if (auto list = document.find("buffers"); list != nullptr && list->type == json::JT_ARRAY) {
+		external_files.reserve(list->elements.size());
+		embedded_data.reserve(list->elements.size());
+		for (auto& buffer : list->elements) {
+			auto uri = buffer.string_or("uri", "");
+			auto length = static_cast<std::size_t>(buffer.number_or("byteLength", 0.0));
+			if (uri.empty()) {
+				buffers.push_back(bin);
+			}
+			else if (uri.substr(0, 5) == "data:") {
+				auto comma = uri.find(";base64,");
+				embedded_data.emplace_back();
+				if (comma == std::string_view::npos || !decode_base64(uri.substr(comma + 8), embedded_data.back())) {
+					LOG_ERROR("Unsupported glTF data URI");
+					return false;
+				}
+				buffers.push_back(gltf_buffer{embedded_data.back().data(), embedded_data.back().size()});
+			}
+			else {
+				auto path = directory + std::string(uri);
+				external_files.emplace_back();
+				if (!external_files.back().open(path)) {
+					LOG_ERROR("Failed to load glTF buffer: %s", path.c_str());
+					return false;
+				}
+				buffers.push_back(gltf_buffer{external_files.back().data(), external_files.back().size()});
+			}
+			if (buffers.back().size < length) {
+				LOG_ERROR("Truncated glTF buffer");
+				return false;
+			}
+		}
+	}
+
+	// triangle list primitives of all meshes
+	std::vector<gltf_primitive> primitives;
+	std::size_t vertices_total = 0, indices_total = 0;
+	auto has_texcoords = false, has_normals = false;
+	if (auto meshes = document.find("meshes"); meshes != nullptr && meshes->type == json::JT_ARRAY) {
+		for (auto& m : meshes->elements) {
+			auto list = m.find("primitives");
+			if (list == nullptr || list->type != json::JT_ARRAY) continue;
+
+			for (auto& p : list->elements) {
+				if (p.number_or("mode", 4.0) != 4.0) {
+					LOG_WARNING("Skipped a glTF primitive that is not a triangle list");
+					continue;
+				}
+				auto attributes = p.find("attributes");
+				if (attributes == nullptr || attributes->find("POSITION") == nullptr) continue;
+
+				gltf_primitive primitive{};
+				auto accessor = [&](const json* source, std::string_view key, gltf_accessor& a) {
+					auto index = source->number_or(key, -1.0);
+					return index < 0.0 || resolve_accessor(document, buffers, static_cast<std::size_t>(index), a);
+				};
+				if (!accessor(attributes, "POSITION", primitive.positions) ||
+				    !accessor(attributes, "TEXCOORD_0", primitive.texcoords) ||
+				    !accessor(attributes, "NORMAL", primitive.normals) ||
+				    !accessor(&p, "indices", primitive.indices)) {
+					LOG_ERROR("Invalid glTF accessor");
+					return false;
+				}
+
+				auto vertices_count = primitive.positions.count;
+				if (primitive.positions.components != 3 ||
+				    (primitive.texcoords.data != nullptr &&
+				     (primitive.texcoords.components != 2 || primitive.texcoords.count != vertices_count)) ||
+				    (primitive.normals.data != nullptr &&
+				     (primitive.normals.components != 3 || primitive.normals.count != vertices_count)) ||
+				    (primitive.indices.data != nullptr && primitive.indices.components != 1)) {
+					LOG_ERROR("Unsupported glTF attribute format");
+					return false;
+				}
+
+				primitive.first_vertex = vertices_total;
+				primitive.first_index = indices_total;
+				vertices_total += vertices_count;
+				indices_total += (primitive.indices.data != nullptr ? primitive.indices.count : vertices_count) / 3 * 3;
+				has_texcoords = has_texcoords || primitive.texcoords.data != nullptr;
+				has_normals = has_normals || primitive.normals.data != nullptr;
+				primitives.push_back(primitive);
+			}
+		}
+	}
+	if (vertices_total >= no_index || indices_total > no_index) {
+		LOG_ERROR("glTF file too large");
+		return false;
+	}
+
+	// every accessor is split across the threads
+	std::vector<gltf_vertex> vertices(vertices_total);
+	std::vector<uint32_t> indices(indices_total);
+	std::atomic<bool> failed{false};
+	for (auto& primitive : primitives) {
+		auto vertices_count = primitive.positions.count;
+		auto out = vertices.begin() + primitive.first_vertex;
+		pool.parallel_for(vertices_count, weld_grain, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; ++i) {
+				gltf_vertex v{glm::vec3(0.0f), glm::vec2(0.0f), glm::vec3(0.0f)};
+				for (uint32_t c = 0; c < 3; ++c) v.position[c] = read_component(primitive.positions, i, c);
+				if (primitive.texcoords.data != nullptr) {
+					for (uint32_t c = 0; c < 2; ++c) v.texcoord[c] = read_component(primitive.texcoords, i, c);
+				}
+				if (primitive.normals.data != nullptr) {
+					for (uint32_t c = 0; c < 3; ++c) v.normal[c] = read_component(primitive.normals, i, c);
+				}
+				out[i] = v;
+			}
+		});
+
+		auto indices_count = (primitive.indices.data != nullptr ? primitive.indices.count : vertices_count) / 3 * 3;
+		auto first_vertex = static_cast<uint32_t>(primitive.first_vertex);
+		pool.parallel_for(indices_count, weld_grain, [&](std::size_t begin, std::size_t end) {
+			for (auto i = begin; i < end; ++i) {
+				auto index = primitive.indices.data != nullptr ? read_index(primitive.indices, i)
+				                                              : static_cast<uint32_t>(i);
+				if (index >= vertices_count) {
+					failed = true;
+					index = 0;
+				}
+				indices[primitive.first_index + i] = first_vertex + index;
+			}
+		});
+	}
+	if (failed) {
+		LOG_ERROR("glTF index out of range");
+		return false;
+	}
+	corners_count = vertices_total;
+
+	// primitives often duplicate vertices at their boundaries
+	std::vector<uint32_t> remap, representatives;
+	weld(vertices, pool, remap, representatives);
+
+	auto welded_count = representatives.size();
+	result.positions.data.resize(welded_count);
+	result.texcoords.data.resize(has_texcoords ? welded_count : 0);
+	result.normals.data.resize(has_normals ? welded_count : 0);
+	pool.parallel_for(welded_count, weld_grain, [&](std::size_t begin, std::size_t end) {
+		for (auto v = begin; v < end; ++v) {
+			auto& vertex = vertices[representatives[v]];
+			result.positions.data[v] = vertex.position;
+			if (has_texcoords) result.texcoords.data[v] = vertex.texcoord;
+			if (has_normals) result.normals.data[v] = vertex.normal;
+		}
+	});
+
+	result.indices.resize(indices_total);
+	pool.parallel_for(indices_total, weld_grain, [&](std::size_t begin, std::size_t end) {
+		for (auto i = begin; i < end; ++i) {
+			result.indices[i] = remap[indices[i]];
+		}
+	});
+	return true;
+}
+
+bool mesh_importer::import(std::string_view filename,
+                           imported_mesh& result,
+                           thread_pool& pool,
+                           statistics* stats) {
+	std::string name(filename);
+	auto dot = name.find_last_of('.');
+	std::string extension = dot == std::string::npos ? "" : name.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(),
+	               [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+	if (extension != "obj" && extension != "gltf" && extension != "glb") {
+		LOG_ERROR("Unsupported mesh format: %s", name.c_str());
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	mapped_file file;
+	if (!file.open(name)) {
+		LOG_ERROR("Failed to load mesh: %s", name.c_str());
+		return false;
+	}
+
+	result = imported_mesh();
+	std::size_t corners_count = 0;
+	auto succeeded = extension == "obj" ? import_obj(file.data(), file.size(), result, pool, corners_count)
+	                                    : import_gltf(filename, file.data(), file.size(), result, pool, corners_count);
+	if (!succeeded) {
+		LOG_ERROR("Failed to import mesh: %s", name.c_str());
+		result = imported_mesh();
+		return false;
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	auto megabytes = file.size() / (1024.0 * 1024.0);
+	auto seconds = std::max(elapsed.count(), 1e-9);
+	LOG_MESSAGE("Imported mesh: %s, %.1f MB in %.3f s (%.1f MB/s), %zu vertices welded to %zu, %zu triangles",
+	            name.c_str(), megabytes, seconds, megabytes / seconds, corners_count,
+	            result.positions.data.size(), result.indices.size() / 3);
+
+	if (stats != nullptr) {
+		*stats = statistics{file.size(), seconds, megabytes / seconds, corners_count, result.positions.data.size()};
+	}
+	return true;
+}
+
+}  // namespace setsuna
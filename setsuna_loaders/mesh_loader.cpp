@@ -0,0 +1,73 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna_loaders/mesh_loader.h>
+#include <setsuna/logger.h>
+
+namespace setsuna {
+
+mesh_loader::mesh_loader(std::string_view mesh_name) :
+    loader(),
+    m_mesh_name(mesh_name), m_header{nullptr} {}
+
+bool mesh_loader::match(const loader& other) const {
+	auto p = type_cast<const mesh_loader*>(&other);
+	if (p != nullptr) {
+		return m_mesh_name == p->m_mesh_name;
+	}
+	return false;
+}
+
+void mesh_loader::create_resource() {
+	m_mesh = mesh::create_interleaved(vertex_layout{{}, 0}, nullptr, 0);
+}
+
+void mesh_loader::main_thread_stage() {
+	if (m_header != nullptr) {
+		auto data = m_file.data();
+		m_mesh = mesh::create_interleaved(mesh_file::layout(*m_header),
+		                                  data + m_header->vertices_offset, m_header->vertices_count);
+		if (m_header->indices_count > 0) {
+			m_mesh->set_indices(data + m_header->indices_offset, m_header->indices_count, m_header->index_type);
+		}
+
+		aabb<3> box;
+		box.min = glm::vec3(m_header->bounds_min[0], m_header->bounds_min[1], m_header->bounds_min[2]);
+		box.max = glm::vec3(m_header->bounds_max[0], m_header->bounds_max[1], m_header->bounds_max[2]);
+		sphere bounding_sphere(glm::vec3(m_header->sphere_center[0], m_header->sphere_center[1],
+		                                 m_header->sphere_center[2]),
+		                       m_header->sphere_radius);
+		m_mesh->set_bounds(box, bounding_sphere);
+
+		if (m_header->flags & mesh_file::quantized_flag) {
+			m_mesh->set_dequantization(glm::vec3(m_header->dequantization_offset[0],
+			                                     m_header->dequantization_offset[1],
+			                                     m_header->dequantization_offset[2]),
+			                           m_header->dequantization_scale);
+		}
+	}
+
+	// the data has been uploaded
+	m_header = nullptr;
+	m_file.close();
+}
+
+void mesh_loader::sub_thread_stage() {
+	LOG_MESSAGE("Loading mesh: %s", m_mesh_name.c_str());
+
+	if (!m_file.open(m_mesh_name)) {
+		LOG_ERROR("Failed to load mesh: %s", m_mesh_name.c_str());
+		return;
+	}
+
+	m_header = mesh_file::validate(m_file.data(), m_file.size());
+	if (m_header == nullptr) {
+		LOG_ERROR("Invalid mesh file: %s", m_mesh_name.c_str());
+		m_file.close();
+		return;
+	}
+
+	m_file.prefetch();
+
+	LOG_MESSAGE("Finish loading mesh: %s", m_mesh_name.c_str());
+}
+
+}  // namespace setsuna
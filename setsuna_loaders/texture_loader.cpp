@@ -1,6 +1,7 @@
 ﻿#include <setsuna_loaders/texture_loader.h>
 #include <setsuna/texture_manager.h>
 #include <setsuna/logger.h>
+#include <cstring>
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_ONLY_JPEG
@@ -28,7 +29,12 @@ void texture_loader::create_resource() {
 }
 
 void texture_loader::main_thread_stage() {
-	if (m_data != nullptr) {
+	if (m_staged) {
+		m_texture = texture_manager::instance().new_texture(m_desc);
+		upload_queue::instance().upload_texture(m_staged.value(), m_texture, 0, GL_UNSIGNED_BYTE);
+		m_staged.reset();
+	}
+	else if (m_data != nullptr) {
 		m_texture = texture_manager::instance().new_texture(m_desc);
 		m_texture->set_image(0, GL_UNSIGNED_BYTE, m_data);
 	}
@@ -66,6 +72,14 @@ void texture_loader::sub_thread_stage() {
 		m_desc.width = width;
 		m_desc.height = height;
 		m_desc.mip_levels_count = 1;
+
+		auto size = std::size_t(width) * height * channels;
+		m_staged = upload_queue::instance().reserve(size);
+		if (m_staged) {
+			std::memcpy(m_staged->data, m_data, size);
+			stbi_image_free(m_data);
+			m_data = nullptr;
+		}
 	}
 	else {
 		LOG_ERROR("Failed to load image: %s", m_image_name.c_str());
@@ -0,0 +1,224 @@
+#include <setsuna/bounds_calculator.h>
+#include <setsuna/meshlet_builder.h>
+#include <setsuna/thread_pool.h>
+#include <setsuna/simd.h>
+#include <algorithm>
+
+namespace setsuna {
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "positions are read as packed floats");
+
+// per-thread partial results of the first pass
+struct extent_partial {
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+// squared distances of the second pass, to the box center and to the Ritter center
+struct radius_partial {
+	float box_sq;
+	float ritter_sq;
+};
+
+#ifdef SETSUNA_SSE2
+
+// load 4 packed positions and transpose them into x, y and z lanes
+static inline void load4(const float* p, __m128& x, __m128& y, __m128& z) {
+	auto a = _mm_loadu_ps(p);      // x0 y0 z0 x1
+	auto b = _mm_loadu_ps(p + 4);  // y1 z1 x2 y2
+	auto c = _mm_loadu_ps(p + 8);  // z2 x3 y3 z3
+	auto xy = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));  // x2 y2 x3 y3
+	auto yz = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));  // y0 z0 y1 z1
+	x = _mm_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+	y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+	z = _mm_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+static inline float horizontal_min(__m128 v) {
+	v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtss_f32(v);
+}
+
+static inline float horizontal_max(__m128 v) {
+	v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtss_f32(v);
+}
+
+static inline __m128 distance_sq(__m128 x, __m128 y, __m128 z, const glm::vec3& c) {
+	auto dx = _mm_sub_ps(x, _mm_set1_ps(c.x));
+	auto dy = _mm_sub_ps(y, _mm_set1_ps(c.y));
+	auto dz = _mm_sub_ps(z, _mm_set1_ps(c.z));
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+}
+
+#endif
+
+// minimum and maximum of count positions, count > 0
+static extent_partial min_max(const glm::vec3* positions, std::size_t count) {
+	extent_partial result{positions[0], positions[0]};
+	std::size_t i = 0;
+#ifdef SETSUNA_SSE2
+	if (count >= 4) {
+		__m128 min_x, min_y, min_z;
+		load4(&positions[0].x, min_x, min_y, min_z);
+		auto max_x = min_x, max_y = min_y, max_z = min_z;
+		for (i = 4; i + 4 <= count; i += 4) {
+			__m128 x, y, z;
+			load4(&positions[i].x, x, y, z);
+			min_x = _mm_min_ps(min_x, x);
+			min_y = _mm_min_ps(min_y, y);
+			min_z = _mm_min_ps(min_z, z);
+			max_x = _mm_max_ps(max_x, x);
+			max_y = _mm_max_ps(max_y, y);
+			max_z = _mm_max_ps(max_z, z);
+		}
+		result.min = glm::vec3(horizontal_min(min_x), horizontal_min(min_y), horizontal_min(min_z));
+		result.max = glm::vec3(horizontal_max(max_x), horizontal_max(max_y), horizontal_max(max_z));
+	}
+#endif
+	for (; i < count; ++i) {
+		result.min = glm::min(result.min, positions[i]);
+		result.max = glm::max(result.max, positions[i]);
+	}
+	return result;
+}
+
+// largest squared distance of count positions to each of the centers
+template<std::size_t centers_count>
+static void max_distances_sq(const glm::vec3* positions, std::size_t count,
+                             const glm::vec3 (&centers)[centers_count], float (&result)[centers_count]) {
+	std::fill(std::begin(result), std::end(result), 0.0f);
+	std::size_t i = 0;
+#ifdef SETSUNA_SSE2
+	__m128 max_sq[centers_count];
+	for (auto& m : max_sq) m = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		__m128 x, y, z;
+		load4(&positions[i].x, x, y, z);
+		for (std::size_t c = 0; c < centers_count; ++c) {
+			max_sq[c] = _mm_max_ps(max_sq[c], distance_sq(x, y, z, centers[c]));
+		}
+	}
+	for (std::size_t c = 0; c < centers_count; ++c) {
+		result[c] = horizontal_max(max_sq[c]);
+	}
+#endif
+	for (; i < count; ++i) {
+		for (std::size_t c = 0; c < centers_count; ++c) {
+			auto d = positions[i] - centers[c];
+			result[c] = std::max(result[c], glm::dot(d, d));
+		}
+	}
+}
+
+void bounds_calculator::calculate(const std::vector<glm::vec3>& positions,
+                                  aabb<3>& box,
+                                  sphere& bounding_sphere,
+                                  thread_pool* pool) {
+	box.reset();
+	bounding_sphere = sphere();
+	if (positions.empty()) return;
+
+	auto count = positions.size();
+	auto data = positions.data();
+
+	std::size_t chunks = 1;
+	if (pool && count >= parallel_threshold) {
+		chunks = pool->chunks_count(count, parallel_threshold / 2);
+	}
+	auto chunk_size = (count + chunks - 1) / chunks;
+	chunks = (count + chunk_size - 1) / chunk_size;
+
+	auto for_each_chunk = [&](auto&& fn) {
+		if (chunks > 1) {
+			pool->run(chunks, fn);
+		}
+		else {
+			fn(0);
+		}
+	};
+	auto chunk_range = [&](std::size_t chunk, std::size_t& begin, std::size_t& end) {
+		begin = chunk * chunk_size;
+		end = std::min(begin + chunk_size, count);
+	};
+
+	// first pass, the extents
+	std::vector<extent_partial> extents(chunks);
+	for_each_chunk([&](std::size_t chunk) {
+		std::size_t begin, end;
+		chunk_range(chunk, begin, end);
+		extents[chunk] = min_max(data + begin, end - begin);
+	});
+	box.min = extents[0].min;
+	box.max = extents[0].max;
+	for (auto& e : extents) {
+		box.expand(e.min);
+		box.expand(e.max);
+	}
+
+	// center of Ritter's sphere of a strided subsample, its radius is measured below
+	auto stride = std::max<std::size_t>(count / ritter_samples, 1);
+	std::vector<glm::vec3> samples;
+	samples.reserve(count / stride + 1);
+	for (std::size_t i = 0; i < count; i += stride) {
+		samples.push_back(data[i]);
+	}
+	const glm::vec3 centers[] = {box.center(), sphere::ritter(samples).center};
+
+	// second pass, the exact radii around both centers
+	std::vector<radius_partial> radii(chunks);
+	for_each_chunk([&](std::size_t chunk) {
+		std::size_t begin, end;
+		chunk_range(chunk, begin, end);
+		float dist_sq[2];
+		max_distances_sq(data + begin, end - begin, centers, dist_sq);
+		radii[chunk] = radius_partial{dist_sq[0], dist_sq[1]};
+	});
+	radius_partial radius{0.0f, 0.0f};
+	for (auto& r : radii) {
+		radius.box_sq = std::max(radius.box_sq, r.box_sq);
+		radius.ritter_sq = std::max(radius.ritter_sq, r.ritter_sq);
+	}
+
+	bounding_sphere = radius.ritter_sq < radius.box_sq ? sphere(centers[1], glm::sqrt(radius.ritter_sq))
+	                                                   : sphere(centers[0], glm::sqrt(radius.box_sq));
+}
+
+void bounds_calculator::calculate(std::vector<meshlet>& meshlets,
+                                  const std::vector<uint32_t>& indices,
+                                  const std::vector<glm::vec3>& positions,
+                                  thread_pool* pool) {
+	auto fn = [&](std::size_t begin, std::size_t end) {
+		// repeated vertices change neither the extents nor the radii, so no deduplication
+		std::vector<glm::vec3> points;
+		for (auto i = begin; i < end; ++i) {
+			auto& m = meshlets[i];
+			points.clear();
+			for (auto k = m.first_index; k < m.first_index + m.indices_count; ++k) {
+				points.push_back(positions[indices[k]]);
+			}
+			if (points.empty()) {
+				m.bounds = sphere();
+				continue;
+			}
+
+			auto extent = min_max(points.data(), points.size());
+			const glm::vec3 centers[] = {(extent.min + extent.max) * 0.5f, sphere::ritter(points).center};
+			float dist_sq[2];
+			max_distances_sq(points.data(), points.size(), centers, dist_sq);
+			m.bounds = dist_sq[1] < dist_sq[0] ? sphere(centers[1], glm::sqrt(dist_sq[1]))
+			                                   : sphere(centers[0], glm::sqrt(dist_sq[0]));
+		}
+	};
+
+	if (pool) {
+		pool->parallel_for(meshlets.size(), meshlets_per_chunk, fn);
+	}
+	else {
+		fn(0, meshlets.size());
+	}
+}
+
+}  // namespace setsuna
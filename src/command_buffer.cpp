@@ -0,0 +1,172 @@
+#include <setsuna/command_buffer.h>
+#include <setsuna/gl_state.h>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace setsuna {
+
+namespace {
+
+// payloads of the commands, read back by memcpy so no alignment is assumed
+
+struct name_cmd {
+	GLuint name;
+};
+
+struct buffer_range_cmd {
+	GLenum target;
+	GLuint index;
+	GLuint buffer;
+	GLintptr offset;
+	GLsizeiptr size;
+};
+
+struct texture_unit_cmd {
+	GLuint unit;
+	GLuint texture;
+};
+
+template<typename T>
+struct uniform_cmd {
+	GLint location;
+	T value;
+};
+
+struct draw_arrays_cmd {
+	GLint first;
+	GLsizei count;
+	GLsizei instance_count;
+	GLuint base_instance;
+};
+
+struct draw_elements_cmd {
+	GLsizei count;
+	GLenum type;
+	uint32_t offset;
+	GLint base_vertex;
+	GLsizei instance_count;
+	GLuint base_instance;
+};
+
+template<typename T>
+T read(const uint8_t*& cursor) {
+	T payload;
+	std::memcpy(&payload, cursor, sizeof(T));
+	cursor += sizeof(T);
+	return payload;
+}
+
+}  // namespace
+
+command_buffer::command_buffer() :
+    m_count{0} {}
+
+void command_buffer::use_program(GLuint program) {
+	push(command_type::CT_USE_PROGRAM, name_cmd{program});
+}
+
+void command_buffer::bind_vertex_array(GLuint vao) {
+	push(command_type::CT_BIND_VERTEX_ARRAY, name_cmd{vao});
+}
+
+void command_buffer::bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+                                       GLintptr offset, GLsizeiptr size) {
+	push(command_type::CT_BIND_BUFFER_RANGE, buffer_range_cmd{target, index, buffer, offset, size});
+}
+
+void command_buffer::bind_texture_unit(GLuint unit, GLuint texture) {
+	push(command_type::CT_BIND_TEXTURE_UNIT, texture_unit_cmd{unit, texture});
+}
+
+void command_buffer::uniform(GLint location, int value) {
+	push(command_type::CT_UNIFORM_INT, uniform_cmd<int>{location, value});
+}
+
+void command_buffer::uniform(GLint location, float value) {
+	push(command_type::CT_UNIFORM_FLOAT, uniform_cmd<float>{location, value});
+}
+
+void command_buffer::uniform(GLint location, const glm::vec4& value) {
+	push(command_type::CT_UNIFORM_VEC4, uniform_cmd<glm::vec4>{location, value});
+}
+
+void command_buffer::uniform(GLint location, const glm::mat4& value) {
+	push(command_type::CT_UNIFORM_MAT4, uniform_cmd<glm::mat4>{location, value});
+}
+
+void command_buffer::draw_arrays(GLint first, GLsizei count,
+                                 GLsizei instance_count, GLuint base_instance) {
+	push(command_type::CT_DRAW_ARRAYS, draw_arrays_cmd{first, count, instance_count, base_instance});
+}
+
+void command_buffer::draw_elements(GLsizei count, GLenum type, uint32_t offset, GLint base_vertex,
+                                   GLsizei instance_count, GLuint base_instance) {
+	push(command_type::CT_DRAW_ELEMENTS,
+	     draw_elements_cmd{count, type, offset, base_vertex, instance_count, base_instance});
+}
+
+void command_buffer::replay() const {
+	auto& state = gl_state::instance();
+
+	auto cursor = m_data.data();
+	auto end = cursor + m_data.size();
+	while (cursor < end) {
+		switch (read<command_type>(cursor)) {
+		case command_type::CT_USE_PROGRAM:
+			state.use_program(read<name_cmd>(cursor).name);
+			break;
+		case command_type::CT_BIND_VERTEX_ARRAY:
+			state.bind_vertex_array(read<name_cmd>(cursor).name);
+			break;
+		case command_type::CT_BIND_BUFFER_RANGE: {
+			auto cmd = read<buffer_range_cmd>(cursor);
+			state.bind_buffer_range(cmd.target, cmd.index, cmd.buffer, cmd.offset, cmd.size);
+			break;
+		}
+		case command_type::CT_BIND_TEXTURE_UNIT: {
+			auto cmd = read<texture_unit_cmd>(cursor);
+			state.bind_texture_unit(cmd.unit, cmd.texture);
+			break;
+		}
+		case command_type::CT_UNIFORM_INT: {
+			auto cmd = read<uniform_cmd<int>>(cursor);
+			glUniform1i(cmd.location, cmd.value);
+			break;
+		}
+		case command_type::CT_UNIFORM_FLOAT: {
+			auto cmd = read<uniform_cmd<float>>(cursor);
+			glUniform1f(cmd.location, cmd.value);
+			break;
+		}
+		case command_type::CT_UNIFORM_VEC4: {
+			auto cmd = read<uniform_cmd<glm::vec4>>(cursor);
+			glUniform4fv(cmd.location, 1, glm::value_ptr(cmd.value));
+			break;
+		}
+		case command_type::CT_UNIFORM_MAT4: {
+			auto cmd = read<uniform_cmd<glm::mat4>>(cursor);
+			glUniformMatrix4fv(cmd.location, 1, GL_FALSE, glm::value_ptr(cmd.value));
+			break;
+		}
+		case command_type::CT_DRAW_ARRAYS: {
+			auto cmd = read<draw_arrays_cmd>(cursor);
+			glDrawArraysInstancedBaseInstance(GL_TRIANGLES, cmd.first, cmd.count,
+			                                  cmd.instance_count, cmd.base_instance);
+			break;
+		}
+		case command_type::CT_DRAW_ELEMENTS: {
+			auto cmd = read<draw_elements_cmd>(cursor);
+			glDrawElementsInstancedBaseVertexBaseInstance(
+			  GL_TRIANGLES, cmd.count, cmd.type, reinterpret_cast<void*>(uintptr_t(cmd.offset)),
+			  cmd.instance_count, cmd.base_vertex, cmd.base_instance);
+			break;
+		}
+		}
+	}
+}
+
+void command_buffer::clear() {
+	m_data.clear();
+	m_count = 0;
+}
+
+}  // namespace setsuna
@@ -0,0 +1,184 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/dynamic_mesh.h>
+#include <setsuna/mesh.h>
+#include <setsuna/gl_state.h>
+#include <setsuna/command_buffer.h>
+#include <setsuna/logger.h>
+#include <algorithm>
+#include <cstring>
+
+namespace setsuna {
+
+// longer lists of missed ranges are merged, at worst into a single range
+static constexpr std::size_t max_pending_ranges = 64;
+
+setsuna::ref<dynamic_mesh> dynamic_mesh::create(const vertex_layout& layout,
+                                                uint32_t max_vertices,
+                                                uint32_t max_indices,
+                                                uint32_t regions_count) {
+	return new dynamic_mesh(layout, max_vertices, max_indices, std::max(regions_count, 1u));
+}
+
+dynamic_mesh::dynamic_mesh(const vertex_layout& layout,
+                           uint32_t max_vertices,
+                           uint32_t max_indices,
+                           uint32_t regions_count) :
+    m_layout(layout),
+    m_max_vertices{max_vertices}, m_max_indices{max_indices},
+    m_indices_offset{(std::size_t(layout.stride) * max_vertices + 255) & ~std::size_t(255)},
+    m_copy_size{m_indices_offset + sizeof(uint32_t) * max_indices},
+    m_stream(m_copy_size, regions_count),
+    m_vao{0}, m_instancing{false}, m_base{0}, m_region{0},
+    m_shadow(m_copy_size), m_pending(regions_count),
+    m_vertices_count{0}, m_indices_count{0}, m_streamed_bytes{0} {
+	glCreateVertexArrays(1, &m_vao);
+	m_layout.apply(m_vao, m_stream.name());
+	glVertexArrayElementBuffer(m_vao, m_stream.name());
+
+	// per-instance world matrix, see mesh::instance_attribindex
+	for (uint32_t col = 0; col < 4; ++col) {
+		glVertexArrayAttribFormat(m_vao, mesh::instance_attribindex + col,
+		                          4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * col);
+		glVertexArrayAttribBinding(m_vao, mesh::instance_attribindex + col, mesh::instance_attribindex);
+	}
+	glVertexArrayBindingDivisor(m_vao, mesh::instance_attribindex, 1);
+
+	begin_frame();
+}
+
+dynamic_mesh::~dynamic_mesh() {
+	gl_state::instance().on_delete_vertex_array(m_vao);
+	glDeleteVertexArrays(1, &m_vao);
+}
+
+void dynamic_mesh::begin_frame(uint32_t rewritten_vertices) {
+	m_stream.begin_region();
+	// a whole region is reserved for the copy, so this never fails
+	m_base = m_stream.allocate(m_copy_size, 256).value();
+	m_region = static_cast<uint32_t>(m_base / m_stream.region_size());
+	glVertexArrayVertexBuffer(m_vao, 0, m_stream.name(), m_base, m_layout.stride);
+	m_streamed_bytes = 0;
+
+	// catch up with the updates made while this copy was in flight
+	auto& pending = m_pending[m_region];
+	std::sort(pending.begin(), pending.end(),
+	          [](const byte_range& lhs, const byte_range& rhs) { return lhs.begin < rhs.begin; });
+	std::size_t merged = 0;
+	for (std::size_t i = 0; i < pending.size(); ++i) {
+		if (merged > 0 && pending[i].begin <= pending[merged - 1].end) {
+			pending[merged - 1].end = std::max(pending[merged - 1].end, pending[i].end);
+		}
+		else {
+			pending[merged++] = pending[i];
+		}
+	}
+	pending.resize(merged);
+
+	auto rewritten = std::size_t(m_layout.stride) * std::min(rewritten_vertices, m_max_vertices);
+	for (auto& range : pending) {
+		auto begin = std::max(range.begin, rewritten);
+		if (begin >= range.end) continue;
+		std::memcpy(m_stream.data(m_base + begin), m_shadow.data() + begin, range.end - begin);
+		m_streamed_bytes += range.end - begin;
+	}
+	pending.clear();
+}
+
+void dynamic_mesh::update_vertices(uint32_t first, const void* vertices, uint32_t count) {
+	if (std::size_t(first) + count > m_max_vertices) {
+		LOG_ERROR("Vertices out of the capacity of the dynamic mesh");
+		return;
+	}
+	write(std::size_t(m_layout.stride) * first, vertices, std::size_t(m_layout.stride) * count);
+}
+
+void dynamic_mesh::update_indices(uint32_t first, const uint32_t* indices, uint32_t count) {
+	if (std::size_t(first) + count > m_max_indices) {
+		LOG_ERROR("Indices out of the capacity of the dynamic mesh");
+		return;
+	}
+	write(m_indices_offset + sizeof(uint32_t) * first, indices, sizeof(uint32_t) * count);
+}
+
+void dynamic_mesh::write(std::size_t offset, const void* data, std::size_t size) {
+	if (size == 0) return;
+
+	std::memcpy(m_shadow.data() + offset, data, size);
+	std::memcpy(m_stream.data(m_base + offset), data, size);
+	m_streamed_bytes += size;
+
+	for (uint32_t region = 0; region < m_pending.size(); ++region) {
+		if (region == m_region) continue;
+
+		auto& pending = m_pending[region];
+		// consecutive updates of a frame are usually adjacent
+		if (!pending.empty() && pending.back().end == offset) {
+			pending.back().end = offset + size;
+			continue;
+		}
+		pending.push_back(byte_range{offset, offset + size});
+		if (pending.size() > max_pending_ranges) {
+			auto begin = pending.front().begin, end = pending.front().end;
+			for (auto& range : pending) {
+				begin = std::min(begin, range.begin);
+				end = std::max(end, range.end);
+			}
+			pending.assign(1, byte_range{begin, end});
+		}
+	}
+}
+
+void dynamic_mesh::set_counts(uint32_t vertices_count, uint32_t indices_count) {
+	m_vertices_count = std::min(vertices_count, m_max_vertices);
+	m_indices_count = std::min(indices_count, m_max_indices);
+}
+
+void dynamic_mesh::render() {
+	gl_state::instance().bind_vertex_array(m_vao);
+
+	if (m_indices_count > 0) {
+		glDrawElements(GL_TRIANGLES, m_indices_count, GL_UNSIGNED_INT,
+		               reinterpret_cast<void*>(m_base + m_indices_offset));
+	}
+	else if (m_vertices_count > 0) {
+		glDrawArrays(GL_TRIANGLES, 0, m_vertices_count);
+	}
+}
+
+void dynamic_mesh::render_instanced(GLuint instance_buffer, GLuint base_instance, GLsizei count) {
+	if (!m_instancing) {
+		// enable lazily so that render() never reads from an unbound buffer
+		for (uint32_t col = 0; col < 4; ++col) {
+			glEnableVertexArrayAttrib(m_vao, mesh::instance_attribindex + col);
+		}
+		m_instancing = true;
+	}
+	glVertexArrayVertexBuffer(m_vao, mesh::instance_attribindex, instance_buffer, 0, sizeof(glm::mat4));
+	gl_state::instance().bind_vertex_array(m_vao);
+
+	if (m_indices_count > 0) {
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, m_indices_count, GL_UNSIGNED_INT,
+		                                    reinterpret_cast<void*>(m_base + m_indices_offset),
+		                                    count, base_instance);
+	}
+	else if (m_vertices_count > 0) {
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, m_vertices_count, count, base_instance);
+	}
+}
+
+void dynamic_mesh::record(command_buffer& cmds) const {
+	cmds.bind_vertex_array(m_vao);
+	if (m_indices_count > 0) {
+		cmds.draw_elements(m_indices_count, GL_UNSIGNED_INT, static_cast<uint32_t>(m_base + m_indices_offset));
+	}
+	else if (m_vertices_count > 0) {
+		cmds.draw_arrays(0, m_vertices_count);
+	}
+}
+
+void dynamic_mesh::set_bounds(const aabb<3>& box, const sphere& bounding_sphere) {
+	m_aabb = box;
+	m_bounding_sphere = bounding_sphere;
+}
+
+}  // namespace setsuna
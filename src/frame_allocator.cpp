@@ -0,0 +1,51 @@
+#include <setsuna/frame_allocator.h>
+#include <algorithm>
+
+namespace setsuna {
+
+frame_allocator::frame_allocator(std::size_t block_size) :
+    m_block{new uint8_t[block_size]}, m_block_size{block_size}, m_head{0},
+    m_overflow_size{0}, m_overflow_head{0}, m_overflow_used{0} {}
+
+void* frame_allocator::allocate_overflow(std::size_t size, std::size_t alignment) {
+	auto bump = [&]() -> void* {
+		auto base = reinterpret_cast<std::uintptr_t>(m_overflow_blocks.back().get());
+		auto aligned = (base + m_overflow_head + alignment - 1) & ~(std::uintptr_t(alignment) - 1);
+		if (aligned + size > base + m_overflow_size) return nullptr;
+
+		m_overflow_used += aligned + size - (base + m_overflow_head);
+		m_overflow_head = aligned + size - base;
+		return reinterpret_cast<void*>(aligned);
+	};
+
+	if (!m_overflow_blocks.empty()) {
+		auto ptr = bump();
+		if (ptr != nullptr) return ptr;
+	}
+
+	// new[] only guarantees fundamental alignment, so reserve room to align
+	m_overflow_size = std::max(m_block_size, size + alignment);
+	m_overflow_head = 0;
+	m_overflow_blocks.emplace_back(new uint8_t[m_overflow_size]);
+	return bump();
+}
+
+void frame_allocator::reset() {
+	if (!m_overflow_blocks.empty()) {
+		// grow so that a frame like this one fits in a single block next time
+		// an empty initial block must not stall the doubling
+		auto block_size = std::max<std::size_t>(m_block_size, 1);
+		while (block_size < used()) block_size *= 2;
+
+		m_overflow_blocks.clear();
+		m_block.reset(new uint8_t[block_size]);
+		m_block_size = block_size;
+	}
+
+	m_head = 0;
+	m_overflow_size = 0;
+	m_overflow_head = 0;
+	m_overflow_used = 0;
+}
+
+}  // namespace setsuna
@@ -1,6 +1,7 @@
 ﻿#include <setsuna/rtti_prefix.h>
 #include <setsuna/framebuffer.h>
 #include <setsuna/texture_container.h>
+#include <setsuna/gl_state.h>
 
 namespace setsuna {
 
@@ -10,6 +11,7 @@ framebuffer::framebuffer() {
 }
 
 framebuffer::~framebuffer() {
+	gl_state::instance().on_delete_framebuffer(m_name);
 	glDeleteFramebuffers(1, &m_name);
 }
 
@@ -26,6 +28,29 @@ bool framebuffer::is_complete() const {
 	       GL_FRAMEBUFFER_COMPLETE;
 }
 
+void framebuffer::read_color_async(std::size_t index, readback_manager::callback_t callback) const {
+	if (index >= m_color_attachments.size()) {
+		LOG_WARNING("The color attachment to read does not exist");
+		return;
+	}
+
+	auto& desc = m_color_attachments[index]->description();
+	readback_manager::instance().request(m_name, GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(index),
+	                                     desc.width, desc.height,
+	                                     GL_RGBA, GL_UNSIGNED_BYTE, std::move(callback));
+}
+
+void framebuffer::read_depth_async(readback_manager::callback_t callback) const {
+	if (!m_depth_attachment) {
+		LOG_WARNING("The depth attachment to read does not exist");
+		return;
+	}
+
+	auto& desc = m_depth_attachment->description();
+	readback_manager::instance().request(m_name, GL_NONE, desc.width, desc.height,
+	                                     GL_DEPTH_COMPONENT, GL_FLOAT, std::move(callback));
+}
+
 void framebuffer::add_attachment(ref<texture>& tex) {
 	auto& desc = tex->description();
 
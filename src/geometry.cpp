@@ -60,8 +60,7 @@ ref<mesh> geometry::sphere(float radius,
 	attribute a0(3, GL_FLOAT, std::move(positions));
 	attribute a1(2, GL_FLOAT, std::move(texcoords));
 	attribute a2(3, GL_FLOAT, std::move(normals));
-	auto mesh = mesh::create(true, a0, a1, a2);
-	mesh->set_indices(indices);
+	auto mesh = mesh::create_indexed(true, std::move(indices), mesh_optimization::MO_ALL, a0, a1, a2);
 	mesh->calculate_bounding_box(a0.data);
 	return mesh;
 }
@@ -113,8 +112,7 @@ ref<mesh> geometry::plane(float width, float height,
 	attribute a0(3, GL_FLOAT, std::move(positions));
 	attribute a1(2, GL_FLOAT, std::move(texcoords));
 	attribute a2(3, GL_FLOAT, std::move(normals));
-	auto mesh = mesh::create(true, a0, a1, a2);
-	mesh->set_indices(indices);
+	auto mesh = mesh::create_indexed(true, std::move(indices), mesh_optimization::MO_ALL, a0, a1, a2);
 	mesh->calculate_bounding_box(a0.data);
 	return mesh;
 }
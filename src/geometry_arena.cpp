@@ -0,0 +1,261 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/geometry_arena.h>
+#include <glm/glm.hpp>
+#include <iterator>
+
+namespace setsuna {
+
+range_allocator::range_allocator(uint32_t capacity) :
+    m_capacity{capacity}, m_used{0} {
+	reset(0);
+}
+
+std::optional<uint32_t> range_allocator::allocate(uint32_t size) {
+	if (size == 0) return 0;
+
+	// the smallest free range that fits
+	auto it = m_free_by_size.lower_bound(size);
+	if (it == m_free_by_size.end()) return std::nullopt;
+
+	auto [free_size, offset] = *it;
+	m_free_by_size.erase(it);
+	m_free_by_offset.erase(offset);
+	if (free_size > size) {
+		m_free_by_offset.emplace(offset + size, free_size - size);
+		m_free_by_size.emplace(free_size - size, offset + size);
+	}
+
+	m_used += size;
+	return offset;
+}
+
+void range_allocator::release(uint32_t offset, uint32_t size) {
+	if (size == 0) return;
+
+	auto erase_free = [this](std::map<uint32_t, uint32_t>::iterator it) {
+		auto [first, last] = m_free_by_size.equal_range(it->second);
+		for (auto s = first; s != last; ++s) {
+			if (s->second == it->first) {
+				m_free_by_size.erase(s);
+				break;
+			}
+		}
+		return m_free_by_offset.erase(it);
+	};
+
+	m_used -= size;
+
+	// merge with the neighbors
+	auto next = m_free_by_offset.lower_bound(offset);
+	if (next != m_free_by_offset.end() && offset + size == next->first) {
+		size += next->second;
+		next = erase_free(next);
+	}
+	if (next != m_free_by_offset.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset) {
+			offset = prev->first;
+			size += prev->second;
+			erase_free(prev);
+		}
+	}
+
+	m_free_by_offset.emplace(offset, size);
+	m_free_by_size.emplace(size, offset);
+}
+
+void range_allocator::reset(uint32_t used) {
+	m_used = used;
+	m_free_by_offset.clear();
+	m_free_by_size.clear();
+	if (used < m_capacity) {
+		m_free_by_offset.emplace(used, m_capacity - used);
+		m_free_by_size.emplace(m_capacity - used, used);
+	}
+}
+
+uint32_t range_allocator::largest_free() const {
+	return m_free_by_size.empty() ? 0 : m_free_by_size.rbegin()->first;
+}
+
+float range_allocator::fragmentation() const {
+	auto free = m_capacity - m_used;
+	return free == 0 ? 0.0f : 1.0f - static_cast<float>(largest_free()) / free;
+}
+
+geometry_arena::geometry_arena(const vertex_layout& layout,
+                               uint32_t vertices_capacity, uint32_t indices_capacity) :
+    m_layout(layout), m_instancing{false},
+    m_vertices{vertices_capacity}, m_indices{indices_capacity},
+    m_compactions_count{0}, m_indirect_capacity{0} {
+	m_vertex_buffer.create<uint8_t>(std::size_t(m_layout.stride) * vertices_capacity);
+	m_index_buffer.create<uint32_t>(indices_capacity);
+
+	glCreateVertexArrays(1, &m_vao);
+	m_layout.apply(m_vao, m_vertex_buffer.name());
+	glVertexArrayElementBuffer(m_vao, m_index_buffer.name());
+
+	// per-instance world matrix, see mesh::instance_attribindex
+	for (uint32_t col = 0; col < 4; ++col) {
+		glVertexArrayAttribFormat(m_vao, mesh::instance_attribindex + col,
+		                          4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * col);
+		glVertexArrayAttribBinding(m_vao, mesh::instance_attribindex + col, mesh::instance_attribindex);
+	}
+	glVertexArrayBindingDivisor(m_vao, mesh::instance_attribindex, 1);
+}
+
+geometry_arena::~geometry_arena() {
+	// only at shutdown, the meshes must not touch the arena afterwards
+	auto detach = [](std::map<uint32_t, allocation>& allocations) {
+		for (auto& [offset, a] : allocations) {
+			a.owner->m_arena = nullptr;
+			a.owner->m_vertices_count = 0;
+			a.owner->m_indices_count = 0;
+			a.owner->m_lods.clear();
+		}
+	};
+	detach(m_vertex_allocations);
+	detach(m_index_allocations);
+
+	gl_state::instance().on_delete_vertex_array(m_vao);
+	glDeleteVertexArrays(1, &m_vao);
+}
+
+std::optional<GLint> geometry_arena::allocate_vertices(uint32_t count, mesh* owner) {
+	auto base_vertex = m_vertices.allocate(count);
+	if (!base_vertex) return std::nullopt;
+
+	if (count > 0) {
+		m_vertex_allocations.emplace(base_vertex.value(), allocation{count, owner});
+	}
+	return static_cast<GLint>(base_vertex.value());
+}
+
+std::optional<uint32_t> geometry_arena::allocate_indices(uint32_t count, mesh* owner) {
+	auto first_index = m_indices.allocate(count);
+	if (!first_index) return std::nullopt;
+
+	if (count > 0) {
+		m_index_allocations.emplace(first_index.value(), allocation{count, owner});
+	}
+	return first_index;
+}
+
+void geometry_arena::write_vertices(GLint base_vertex, const std::vector<uint8_t>& data) {
+	m_vertex_buffer.set_data(data, GLintptr(base_vertex) * m_layout.stride);
+}
+
+void geometry_arena::write_indices(uint32_t first_index, const std::vector<uint32_t>& indices) {
+	m_index_buffer.set_data(indices, GLintptr(first_index) * sizeof(uint32_t));
+}
+
+void geometry_arena::release_vertices(GLint base_vertex, const mesh* owner) {
+	auto it = m_vertex_allocations.find(static_cast<uint32_t>(base_vertex));
+	if (it == m_vertex_allocations.end() || it->second.owner != owner) return;
+
+	m_vertices.release(it->first, it->second.size);
+	m_vertex_allocations.erase(it);
+}
+
+void geometry_arena::release_indices(uint32_t first_index, const mesh* owner) {
+	auto it = m_index_allocations.find(first_index);
+	if (it == m_index_allocations.end() || it->second.owner != owner) return;
+
+	m_indices.release(it->first, it->second.size);
+	m_index_allocations.erase(it);
+}
+
+void geometry_arena::compact() {
+	if (m_vertices.fragmentation() > 0.0f) {
+		m_vertex_buffer = compact(m_vertex_buffer, m_vertex_allocations, m_vertices, m_layout.stride, true);
+		m_layout.apply(m_vao, m_vertex_buffer.name());
+	}
+	if (m_indices.fragmentation() > 0.0f) {
+		m_index_buffer = compact(m_index_buffer, m_index_allocations, m_indices, sizeof(uint32_t), false);
+		glVertexArrayElementBuffer(m_vao, m_index_buffer.name());
+	}
+	++m_compactions_count;
+}
+
+buffer<buffer_usage::BU_DYNAMIC> geometry_arena::compact(const buffer<buffer_usage::BU_DYNAMIC>& old_buffer,
+                                                         std::map<uint32_t, allocation>& allocations,
+                                                         range_allocator& allocator,
+                                                         std::size_t element_size,
+                                                         bool patch_base_vertex) {
+	// copying into a new buffer avoids overlapping source and destination ranges
+	buffer<buffer_usage::BU_DYNAMIC> new_buffer;
+	new_buffer.create<uint8_t>(element_size * allocator.capacity());
+
+	std::map<uint32_t, allocation> moved;
+	uint32_t next = 0;
+	for (auto& [offset, a] : allocations) {
+		glCopyNamedBufferSubData(old_buffer.name(), new_buffer.name(),
+		                         GLintptr(offset) * element_size, GLintptr(next) * element_size,
+		                         GLsizeiptr(a.size) * element_size);
+		if (patch_base_vertex) {
+			a.owner->m_base_vertex = static_cast<GLint>(next);
+		}
+		else {
+			a.owner->m_first_index = next;
+		}
+		moved.emplace(next, a);
+		next += a.size;
+	}
+
+	allocations.swap(moved);
+	allocator.reset(next);
+	return new_buffer;
+}
+
+void geometry_arena::draw(const draw_elements_indirect_command& cmd) {
+	m_commands.push_back(cmd);
+}
+
+void geometry_arena::draw(const draw_arrays_indirect_command& cmd) {
+	m_array_commands.push_back(cmd);
+}
+
+void geometry_arena::bind_instance_buffer(GLuint instance_buffer) {
+	if (!m_instancing) {
+		for (uint32_t col = 0; col < 4; ++col) {
+			glEnableVertexArrayAttrib(m_vao, mesh::instance_attribindex + col);
+		}
+		m_instancing = true;
+	}
+	glVertexArrayVertexBuffer(m_vao, mesh::instance_attribindex, instance_buffer, 0, sizeof(glm::mat4));
+}
+
+void geometry_arena::submit(GLuint instance_buffer) {
+	if (m_commands.empty() && m_array_commands.empty()) return;
+
+	auto elements_size = sizeof(draw_elements_indirect_command) * m_commands.size();
+	auto size = elements_size + sizeof(draw_arrays_indirect_command) * m_array_commands.size();
+	if (size > m_indirect_capacity) {
+		auto capacity = std::max<std::size_t>(m_indirect_capacity, 1024);
+		while (capacity < size) capacity *= 2;
+
+		buffer<buffer_usage::BU_DYNAMIC> new_buffer;
+		new_buffer.create<uint8_t>(capacity);
+		m_indirect_buffer = std::move(new_buffer);
+		m_indirect_capacity = capacity;
+	}
+	m_indirect_buffer.set_data(m_commands, 0);
+	m_indirect_buffer.set_data(m_array_commands, static_cast<GLintptr>(elements_size));
+
+	bind_instance_buffer(instance_buffer);
+	gl_state::instance().bind_vertex_array(m_vao);
+	gl_state::instance().bind_buffer(GL_DRAW_INDIRECT_BUFFER, m_indirect_buffer.name());
+	if (!m_commands.empty()) {
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+		                            static_cast<GLsizei>(m_commands.size()), 0);
+	}
+	if (!m_array_commands.empty()) {
+		glMultiDrawArraysIndirect(GL_TRIANGLES, reinterpret_cast<const void*>(elements_size),
+		                          static_cast<GLsizei>(m_array_commands.size()), 0);
+	}
+
+	m_commands.clear();
+	m_array_commands.clear();
+}
+
+}  // namespace setsuna
@@ -0,0 +1,108 @@
+#include <setsuna/geometry_manager.h>
+#include <setsuna/geometry_arena.h>
+#include <setsuna/logger.h>
+
+namespace setsuna {
+
+geometry_manager::geometry_manager() :
+    m_option{1 << 20, 6 << 20, 0.5f} {}
+
+geometry_manager::~geometry_manager() {
+	release();
+}
+
+void geometry_manager::release() {
+	for (auto it = m_arenas.begin(); it != m_arenas.end(); ++it) {
+		for (auto& arena : it->second) {
+			delete arena;
+		}
+	}
+	m_arenas.clear();
+}
+
+geometry_arena* geometry_manager::allocate(const vertex_layout& layout, uint32_t vertices_count, uint32_t indices_count,
+                                           mesh* owner, GLint& base_vertex, uint32_t& first_index) {
+	if (vertices_count > m_option.vertices_per_arena || indices_count > m_option.indices_per_arena) {
+		LOG_WARNING("Too much geometry to fit in a geometry arena: %u vertices, %u indices",
+		            vertices_count, indices_count);
+		return nullptr;
+	}
+
+	// both ranges or none
+	auto try_allocate = [&](geometry_arena* arena) {
+		auto base = arena->allocate_vertices(vertices_count, owner);
+		if (!base) return false;
+
+		auto first = arena->allocate_indices(indices_count, owner);
+		if (!first) {
+			if (vertices_count > 0) arena->release_vertices(base.value(), owner);
+			return false;
+		}
+
+		base_vertex = base.value();
+		first_index = first.value();
+		return true;
+	};
+
+	auto [it, _] = m_arenas.try_emplace(layout);
+
+	for (auto& arena : it->second) {
+		if (try_allocate(arena)) return arena;
+	}
+
+	// free space may be enough but scattered
+	for (auto& arena : it->second) {
+		auto& vertices = arena->vertices();
+		auto& indices = arena->indices();
+		if (vertices_count <= vertices.capacity() - vertices.used() &&
+		    indices_count <= indices.capacity() - indices.used()) {
+			LOG_DEBUG("Compacting a geometry arena, fragmentation %.2f of vertices, %.2f of indices",
+			          vertices.fragmentation(), indices.fragmentation());
+			arena->compact();
+			if (try_allocate(arena)) return arena;
+		}
+	}
+
+	// if no arenas have enough space, create a new one
+	auto& new_arena = it->second.emplace_back(
+	  new geometry_arena(layout, m_option.vertices_per_arena, m_option.indices_per_arena));
+	try_allocate(new_arena);
+	return new_arena;
+}
+
+void geometry_manager::compact() {
+	for (auto it = m_arenas.begin(); it != m_arenas.end(); ++it) {
+		for (auto& arena : it->second) {
+			if (arena->vertices().fragmentation() > m_option.compaction_threshold ||
+			    arena->indices().fragmentation() > m_option.compaction_threshold) {
+				arena->compact();
+			}
+		}
+	}
+}
+
+std::vector<geometry_arena_statistics> geometry_manager::statistics() const {
+	std::vector<geometry_arena_statistics> result;
+	for (auto it = m_arenas.begin(); it != m_arenas.end(); ++it) {
+		for (auto& arena : it->second) {
+			auto& vertices = arena->vertices();
+			auto& indices = arena->indices();
+			result.push_back(geometry_arena_statistics{
+			  arena->layout().stride,
+			  vertices.capacity(), vertices.used(), vertices.fragmentation(),
+			  indices.capacity(), indices.used(), indices.fragmentation(),
+			  arena->compactions_count()});
+		}
+	}
+	return result;
+}
+
+void geometry_manager::submit(GLuint instance_buffer) {
+	for (auto it = m_arenas.begin(); it != m_arenas.end(); ++it) {
+		for (auto& arena : it->second) {
+			arena->submit(instance_buffer);
+		}
+	}
+}
+
+}  // namespace setsuna
@@ -0,0 +1,162 @@
+#include <setsuna/gl_state.h>
+
+namespace setsuna {
+
+gl_state::gl_state() :
+    m_default_framebuffer{0}, m_stats{0, 0} {
+	invalidate();
+}
+
+bool gl_state::update(GLuint& cached, GLuint value) {
+	if (cached == value) {
+		++m_stats.elided;
+		return false;
+	}
+	cached = value;
+	++m_stats.issued;
+	return true;
+}
+
+void gl_state::use_program(GLuint program) {
+	if (update(m_program, program)) {
+		glUseProgram(program);
+	}
+}
+
+void gl_state::bind_vertex_array(GLuint vao) {
+	if (update(m_vertex_array, vao)) {
+		glBindVertexArray(vao);
+	}
+}
+
+void gl_state::bind_buffer(GLenum target, GLuint buffer) {
+	auto [it, _] = m_buffers.try_emplace(target, unknown);
+	if (update(it->second, buffer)) {
+		glBindBuffer(target, buffer);
+	}
+}
+
+void gl_state::bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+                                 GLintptr offset, GLsizeiptr size) {
+	auto [it, inserted] = m_buffer_ranges.try_emplace({target, index}, buffer_range{buffer, offset, size});
+	auto& range = it->second;
+	if (!inserted && range.buffer == buffer && range.offset == offset && range.size == size) {
+		++m_stats.elided;
+		return;
+	}
+	range = buffer_range{buffer, offset, size};
+	++m_stats.issued;
+
+	glBindBufferRange(target, index, buffer, offset, size);
+	// the generic binding point is changed as well
+	m_buffers[target] = buffer;
+}
+
+void gl_state::bind_texture_unit(GLuint unit, GLuint texture) {
+	auto [it, _] = m_texture_units.try_emplace(unit, unknown);
+	if (update(it->second, texture)) {
+		glBindTextureUnit(unit, texture);
+	}
+}
+
+void gl_state::bind_texture(GLenum target, GLuint texture) {
+	auto [it, _] = m_texture_units.try_emplace(0, unknown);
+	if (update(it->second, texture)) {
+		glBindTexture(target, texture);
+	}
+}
+
+void gl_state::bind_framebuffer(GLenum target, GLuint framebuffer) {
+	if (framebuffer == 0) framebuffer = m_default_framebuffer;
+
+	switch (target) {
+	case GL_DRAW_FRAMEBUFFER:
+		if (update(m_draw_framebuffer, framebuffer)) {
+			glBindFramebuffer(target, framebuffer);
+		}
+		break;
+	case GL_READ_FRAMEBUFFER:
+		if (update(m_read_framebuffer, framebuffer)) {
+			glBindFramebuffer(target, framebuffer);
+		}
+		break;
+	default:
+		if (m_draw_framebuffer == framebuffer && m_read_framebuffer == framebuffer) {
+			++m_stats.elided;
+		}
+		else {
+			m_draw_framebuffer = m_read_framebuffer = framebuffer;
+			++m_stats.issued;
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		}
+		break;
+	}
+}
+
+void gl_state::pixel_store(GLenum pname, GLint value) {
+	auto [it, inserted] = m_pixel_store.try_emplace(pname, value);
+	if (!inserted && it->second == value) {
+		++m_stats.elided;
+		return;
+	}
+	it->second = value;
+	++m_stats.issued;
+	glPixelStorei(pname, value);
+}
+
+void gl_state::invalidate() {
+	m_program = unknown;
+	m_vertex_array = unknown;
+	m_draw_framebuffer = unknown;
+	m_read_framebuffer = unknown;
+	m_buffers.clear();
+	m_buffer_ranges.clear();
+	m_texture_units.clear();
+	m_pixel_store.clear();
+}
+
+/*
+Deleting a bound object reverts the binding to zero, however the name
+may be reused later, so just forget it.
+*/
+
+void gl_state::on_delete_program(GLuint program) {
+	if (m_program == program) m_program = unknown;
+}
+
+void gl_state::on_delete_vertex_array(GLuint vao) {
+	if (m_vertex_array == vao) m_vertex_array = unknown;
+}
+
+void gl_state::on_delete_buffer(GLuint buffer) {
+	for (auto& [target, name] : m_buffers) {
+		if (name == buffer) name = unknown;
+	}
+	for (auto it = m_buffer_ranges.begin(); it != m_buffer_ranges.end();) {
+		if (it->second.buffer == buffer) {
+			it = m_buffer_ranges.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void gl_state::on_delete_texture(GLuint texture) {
+	for (auto& [unit, name] : m_texture_units) {
+		if (name == texture) name = unknown;
+	}
+}
+
+void gl_state::set_default_framebuffer(GLuint framebuffer) {
+	m_default_framebuffer = framebuffer;
+	bind_framebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void gl_state::on_delete_framebuffer(GLuint framebuffer) {
+	if (m_default_framebuffer == framebuffer) m_default_framebuffer = 0;
+	if (m_draw_framebuffer == framebuffer) m_draw_framebuffer = unknown;
+	if (m_read_framebuffer == framebuffer) m_read_framebuffer = unknown;
+}
+
+}  // namespace setsuna
@@ -68,6 +68,31 @@ struct aabb {
 		max = glm::max(max, p);
 	}
 
+	/**
+	@brief Get the box transformed by an affine matrix @p m
+
+	Rather than transforming all the corners, the center is transformed as a point
+	and the extent is transformed by the absolute value of the upper 3x3 part of @p m
+	(J. Arvo, "Transforming Axis-Aligned Bounding Boxes", Graphics Gems, 1990).
+	The result is the tightest box that contains the transformed box.
+
+	Only available if @p dimensions is 3.
+	*/
+	aabb transformed(const glm::mat4& m) const {
+		static_assert(dimensions == 3, "transformed() requires a 3D box");
+
+		glm::mat3 abs_m(glm::abs(glm::vec3(m[0])),
+		                glm::abs(glm::vec3(m[1])),
+		                glm::abs(glm::vec3(m[2])));
+		auto ctr = glm::vec3(m * glm::vec4(center(), 1.0f));
+		auto ext = abs_m * extent();
+
+		aabb result;
+		result.min = ctr - ext;
+		result.max = ctr + ext;
+		return result;
+	}
+
 	/**
 	@brief Set the box to an invalid status
 
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <setsuna/aabb.h>
+#include <setsuna/sphere.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::bounds_calculator
+*/
+
+namespace setsuna {
+
+class thread_pool;
+struct meshlet;
+
+/**
+@brief Bounding volumes of large position streams
+
+The positions are read twice in total, four at a time with SSE where
+available, and split across a @ref setsuna::thread_pool above
+@ref parallel_threshold positions:
+- the first pass reduces the minimum and the maximum;
+- the second pass measures the exact radius around two candidate centers,
+  the box center and the center of Ritter's sphere of a subsample.
+
+The smaller of the two candidate spheres is chosen. Since its radius is exact
+for its center, it is never larger than Ritter's sphere of the subsample.
+
+The bounding spheres of meshlets go through the same reductions, over the
+positions gathered by the indices of every meshlet.
+*/
+class bounds_calculator {
+
+public:
+	/**
+	@brief Number of positions below which everything runs on the calling thread
+	*/
+	static constexpr std::size_t parallel_threshold = 1 << 16;
+
+	/**
+	@brief Number of positions sampled for the center of Ritter's sphere
+	*/
+	static constexpr std::size_t ritter_samples = 1 << 14;
+
+	/**
+	@brief Calculate the bounding box and the bounding sphere of @p positions
+
+	@param positions		Positions
+	@param box				Receives the bounding box, invalid if @p positions is empty
+	@param bounding_sphere	Receives the bounding sphere
+	@param pool				Threads to split large streams across, or nullptr
+	*/
+	static void calculate(const std::vector<glm::vec3>& positions,
+	                      aabb<3>& box,
+	                      sphere& bounding_sphere,
+	                      thread_pool* pool = nullptr);
+
+	/**
+	@brief Calculate the bounding sphere of every meshlet
+
+	@param meshlets		Meshlets whose @p bounds are set
+	@param indices		The indices rewritten by @ref setsuna::meshlet_builder::build()
+	@param positions	Vertex positions
+	@param pool			Threads to split the meshlets across, or nullptr
+
+	Every sphere is the smaller of the exact spheres around the box center and
+	the Ritter center of the meshlet, so it is never larger than Ritter's sphere.
+	*/
+	static void calculate(std::vector<meshlet>& meshlets,
+	                      const std::vector<uint32_t>& indices,
+	                      const std::vector<glm::vec3>& positions,
+	                      thread_pool* pool = nullptr);
+
+	/**
+	@brief Number of meshlets per task
+	*/
+	static constexpr std::size_t meshlets_per_chunk = 256;
+};
+
+}  // namespace setsuna
@@ -2,6 +2,7 @@
 
 #include <glad/glad.h>
 #include <setsuna/logger.h>
+#include <setsuna/gl_state.h>
 #include <vector>
 
 /** @file
@@ -30,11 +31,12 @@ class buffer {
 public:
 	/**
 	@brief Default constructor
+
+	The buffer object is not generated until the data store is created,
+	so @ref name() returns 0 before that.
 	*/
 	buffer() :
-	    m_created{false}, m_data{nullptr} {
-		glCreateBuffers(1, &m_name);
-	}
+	    m_name{0}, m_created{false}, m_data{nullptr} {}
 
 	/**
 	@brief Destructor
@@ -46,6 +48,7 @@ public:
 			glUnmapNamedBuffer(m_name);
 			m_data = nullptr;
 		}
+		gl_state::instance().on_delete_buffer(m_name);
 		glDeleteBuffers(1, &m_name);
 	}
 
@@ -76,6 +79,7 @@ public:
 					glUnmapNamedBuffer(m_name);
 					m_data = nullptr;
 				}
+				gl_state::instance().on_delete_buffer(m_name);
 				glDeleteBuffers(1, &m_name);
 			}
 
@@ -104,6 +108,19 @@ public:
 		}
 	}
 
+	/**
+	@brief Create the buffer from @p count elements at @p data
+
+	Same as @ref create(const std::vector<T>&) but without owning the data,
+	e.g. to upload straight from a memory-mapped file.
+	*/
+	template<typename T>
+	void create(const T* data, std::size_t count) {
+		if (!m_created && count > 0) {
+			create(sizeof(T) * count, data);
+		}
+	}
+
 	/**
 	@brief Create the buffer with uninitialized data store
 
@@ -121,6 +138,77 @@ public:
 		}
 	}
 
+	/**
+	@brief Create the buffer as a copy of @p size bytes of another buffer
+
+	@param source	Name of the buffer to copy from
+	@param offset	Offset in bytes in @p source
+	@param size		Number of bytes to copy
+
+	The data is copied on the GPU. The buffer will not be created if @p size is zero.
+	*/
+	void create_copy(GLuint source, GLintptr offset, std::size_t size) {
+		if (!m_created && size > 0) {
+			create(static_cast<GLsizeiptr>(size), nullptr);
+			glCopyNamedBufferSubData(source, m_name, offset, 0, static_cast<GLsizeiptr>(size));
+		}
+	}
+
+	/**
+	@brief Create the buffer and write its initial data in place
+
+	@param size		Size of the data store in bytes
+	@param write	Called once with the mapped data store, must fill all @p size bytes
+
+	The data is produced straight into mapped memory the driver uploads from,
+	without an intermediate copy or zero-fill on the CPU. Static buffers are never
+	mappable, which would keep their storage in memory visible to the CPU, so the
+	data is written into a temporary staging buffer and copied on the GPU instead.
+
+	The buffer will not be created if @p size is zero.
+	*/
+	template<typename F>
+	void create_mapped(std::size_t size, F&& write) {
+		if (m_created || size == 0) return;
+
+		if constexpr (usage == buffer_usage::BU_PERSISTENT) {
+			create(static_cast<GLsizeiptr>(size), nullptr);
+			if (m_data != nullptr) write(m_data);
+		}
+		else if constexpr (usage == buffer_usage::BU_STATIC) {
+			GLuint staging;
+			glCreateBuffers(1, &staging);
+			glNamedBufferStorage(staging, static_cast<GLsizeiptr>(size), nullptr, GL_MAP_WRITE_BIT);
+
+			auto data = glMapNamedBufferRange(staging, 0, static_cast<GLsizeiptr>(size),
+			                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (data == nullptr) {
+				LOG_ERROR("Map buffer failed");
+			}
+			else {
+				write(static_cast<uint8_t*>(data));
+				glUnmapNamedBuffer(staging);
+				create_copy(staging, 0, size);
+			}
+			// the driver keeps it alive until the copy is done
+			glDeleteBuffers(1, &staging);
+		}
+		else {
+			if (m_name == 0) glCreateBuffers(1, &m_name);
+			glNamedBufferStorage(m_name, static_cast<GLsizeiptr>(size), nullptr, storage_flags() | GL_MAP_WRITE_BIT);
+			m_created = true;
+
+			auto data = glMapNamedBufferRange(m_name, 0, static_cast<GLsizeiptr>(size),
+			                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (data == nullptr) {
+				LOG_ERROR("Map buffer failed");
+				return;
+			}
+			write(static_cast<uint8_t*>(data));
+			glUnmapNamedBuffer(m_name);
+		}
+	}
+
 	/**
 	@brief Set buffer data
 
@@ -152,23 +240,28 @@ public:
 	*/
 	GLuint name() const { return m_name; }
 
+	/**
+	@brief Get the persistently mapped data store
+
+	Writes are coherent, but it is up to you to avoid overwriting data
+	the GPU may still be reading, see @ref setsuna::stream_buffer .
+
+	This function is only available if @p usage is @ref setsuna::buffer_usage::BU_PERSISTENT .
+	*/
+	uint8_t* data() const {
+		static_assert(usage == buffer_usage::BU_PERSISTENT, "Only persistent buffers are mapped");
+		return m_data;
+	}
+
 private:
 	void create(GLsizeiptr size, const void* data) {
-		// re-create if moved-out
+		// generate lazily, or again if moved-out
 		if (m_name == 0) glCreateBuffers(1, &m_name);
 
-		if constexpr (usage == buffer_usage::BU_STATIC) {
-			glNamedBufferStorage(m_name, size, data, 0);
-		}
-		else if constexpr (usage == buffer_usage::BU_DYNAMIC) {
-			glNamedBufferStorage(m_name, size, data, GL_DYNAMIC_STORAGE_BIT);
-		}
-		else if constexpr (usage == buffer_usage::BU_PERSISTENT) {
-			// map for writing only and implies coherent (for now)
-			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
-			glNamedBufferStorage(m_name, size, data, flags);
+		glNamedBufferStorage(m_name, size, data, storage_flags());
+		if constexpr (usage == buffer_usage::BU_PERSISTENT) {
 			// map only once
-			m_data = reinterpret_cast<uint8_t*>(glMapNamedBufferRange(m_name, 0, size, flags));
+			m_data = reinterpret_cast<uint8_t*>(glMapNamedBufferRange(m_name, 0, size, storage_flags()));
 			if (m_data == nullptr) {
 				LOG_ERROR("Map buffer failed");
 			}
@@ -176,6 +269,19 @@ private:
 		m_created = true;
 	}
 
+	static constexpr GLbitfield storage_flags() {
+		if constexpr (usage == buffer_usage::BU_STATIC) {
+			return 0;
+		}
+		else if constexpr (usage == buffer_usage::BU_DYNAMIC) {
+			return GL_DYNAMIC_STORAGE_BIT;
+		}
+		else {
+			// map for writing only and implies coherent (for now)
+			return GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		}
+	}
+
 	void update(GLsizeiptr size, GLintptr offset, const void* data) {
 		if constexpr (usage == buffer_usage::BU_DYNAMIC) {
 			glNamedBufferSubData(m_name, offset, size, data);
@@ -63,6 +63,16 @@ public:
 	*/
 	const frustum& frustum() const { return m_frustum; }
 
+	/**
+	@brief Get the distance to the near plane
+	*/
+	float near_plane() const { return m_near_plane; }
+
+	/**
+	@brief Get the distance to the far plane
+	*/
+	float far_plane() const { return m_far_plane; }
+
 	/**
 	@brief Set the aspect ratio
 
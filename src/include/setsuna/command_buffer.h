@@ -0,0 +1,175 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::command_buffer
+*/
+
+namespace setsuna {
+
+/**
+@brief Type of a recorded command
+*/
+enum class command_type : uint32_t {
+	CT_USE_PROGRAM,       /**< @brief @p glUseProgram */
+	CT_BIND_VERTEX_ARRAY, /**< @brief @p glBindVertexArray */
+	CT_BIND_BUFFER_RANGE, /**< @brief @p glBindBufferRange */
+	CT_BIND_TEXTURE_UNIT, /**< @brief @p glBindTextureUnit */
+	CT_UNIFORM_INT,       /**< @brief @p glUniform1i */
+	CT_UNIFORM_FLOAT,     /**< @brief @p glUniform1f */
+	CT_UNIFORM_VEC4,      /**< @brief @p glUniform4fv */
+	CT_UNIFORM_MAT4,      /**< @brief @p glUniformMatrix4fv */
+	CT_DRAW_ARRAYS,       /**< @brief @p glDrawArraysInstancedBaseInstance */
+	CT_DRAW_ELEMENTS      /**< @brief @p glDrawElementsInstancedBaseVertexBaseInstance */
+};
+
+/**
+@brief Compact stream of OpenGL commands recorded on any thread
+
+Only the thread owning the OpenGL context may call OpenGL, but deciding what
+to draw does not have to. A command buffer packs binds, uniform uploads and
+draws into a flat byte stream without touching OpenGL, so that several worker
+threads could each record one buffer in parallel, while the OpenGL thread
+@ref replay() s them in order afterwards. Usage example:
+
+@code{.cpp}
+std::vector<command_buffer> chunks(pool.chunks_count(items.size(), 256));
+pool.run(chunks.size(), [&](std::size_t chunk) {
+	auto& cmds = chunks[chunk];
+	cmds.clear();
+	for (auto& item : items_of(chunk)) {
+		cmds.uniform(world_location, item.world);
+		item.mesh->record(cmds);
+	}
+});
+for (auto& cmds : chunks) {
+	cmds.replay();
+}
+@endcode
+
+Binds are replayed through @ref setsuna::gl_state . Uniforms are uploaded to
+the program in use at replay time by location, bypassing the value cache of
+@ref setsuna::shader_program , so do not upload the same uniform both ways.
+*/
+class command_buffer {
+
+public:
+	/**
+	@brief Default constructor
+	*/
+	command_buffer();
+
+	/**
+	@brief Record @p glUseProgram
+	*/
+	void use_program(GLuint program);
+
+	/**
+	@brief Record @p glBindVertexArray
+	*/
+	void bind_vertex_array(GLuint vao);
+
+	/**
+	@brief Record @p glBindBufferRange
+	*/
+	void bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+	                       GLintptr offset, GLsizeiptr size);
+
+	/**
+	@brief Record @p glBindTextureUnit
+	*/
+	void bind_texture_unit(GLuint unit, GLuint texture);
+
+	/**
+	@brief Record a uniform upload to @p location of the program in use
+	*/
+	void uniform(GLint location, int value);
+
+	/**
+	@brief Record a uniform upload to @p location of the program in use
+	*/
+	void uniform(GLint location, float value);
+
+	/**
+	@brief Record a uniform upload to @p location of the program in use
+	*/
+	void uniform(GLint location, const glm::vec4& value);
+
+	/**
+	@brief Record a uniform upload to @p location of the program in use
+	*/
+	void uniform(GLint location, const glm::mat4& value);
+
+	/**
+	@brief Record a non-indexed draw of triangles
+	*/
+	void draw_arrays(GLint first, GLsizei count,
+	                 GLsizei instance_count = 1, GLuint base_instance = 0);
+
+	/**
+	@brief Record an indexed draw of triangles
+
+	@param count			Number of indices
+	@param type				Type of the indices, e.g. @p GL_UNSIGNED_INT
+	@param offset			Offset in bytes of the first index in the element buffer
+	@param base_vertex		Value added to every index
+	@param instance_count	Number of instances
+	@param base_instance	Value added to the instance index when fetching instance attributes
+	*/
+	void draw_elements(GLsizei count, GLenum type, uint32_t offset, GLint base_vertex = 0,
+	                   GLsizei instance_count = 1, GLuint base_instance = 0);
+
+	/**
+	@brief Execute the recorded commands, only call this on the OpenGL thread
+
+	The commands are kept, so a buffer could be replayed more than once.
+	*/
+	void replay() const;
+
+	/**
+	@brief Remove all commands, keeping the storage
+	*/
+	void clear();
+
+	/**
+	@brief Reserve storage for @p bytes bytes of commands
+	*/
+	void reserve(std::size_t bytes) { m_data.reserve(bytes); }
+
+	/**
+	@brief Get the number of recorded commands
+	*/
+	std::size_t size() const { return m_count; }
+
+	/**
+	@brief Test if no command is recorded
+	*/
+	bool empty() const { return m_count == 0; }
+
+	/**
+	@brief Get the size of the recorded commands in bytes
+	*/
+	std::size_t size_bytes() const { return m_data.size(); }
+
+private:
+	// a command is a 4-byte type followed by its payload, which is trivially copyable
+	template<typename T>
+	void push(command_type type, const T& payload) {
+		auto offset = m_data.size();
+		m_data.resize(offset + sizeof(command_type) + sizeof(T));
+		std::memcpy(m_data.data() + offset, &type, sizeof(command_type));
+		std::memcpy(m_data.data() + offset + sizeof(command_type), &payload, sizeof(T));
+		++m_count;
+	}
+
+private:
+	std::vector<uint8_t> m_data;
+	std::size_t m_count;
+};
+
+}  // namespace setsuna
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <setsuna/resource.h>
+#include <setsuna/ref.h>
+#include <setsuna/aabb.h>
+#include <setsuna/sphere.h>
+#include <setsuna/stream_buffer.h>
+#include <setsuna/vertex_layout.h>
+
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::dynamic_mesh
+*/
+
+namespace setsuna {
+
+class command_buffer;
+
+/**
+@brief Mesh whose vertices and indices are updated by the CPU every frame
+
+The vertices and 32-bit indices live in a @ref setsuna::stream_buffer , one
+persistently mapped copy per region, so updates are plain writes into mapped
+memory and never wait for the GPU to finish drawing the previous frames.
+Because the copies of the other regions miss an update, every update is also
+kept in a copy on the CPU, and the updated ranges are replayed into a region
+when it comes around again. Meshes updated in small ranges therefore stream
+only a few times the bytes they change.
+
+Usage example, e.g. for cloth simulated on the CPU:
+
+@code{.cpp}
+auto cloth = dynamic_mesh::create(layout, max_vertices, max_indices);
+cloth->update_indices(0, indices.data(), indices_count);
+cloth->set_counts(vertices_count, indices_count);
+
+// every frame
+cloth->begin_frame();
+cloth->update_vertices(0, vertices.data(), vertices_count);
+cloth->render();
+@endcode
+
+The number of bytes written into mapped memory every frame is reported by
+@ref streamed_bytes() , and @ref stalls() tells how often the GPU was so far
+behind that a region was still in use.
+*/
+class dynamic_mesh : public resource {
+
+	RTTI_ENABLE(dynamic_mesh, resource)
+
+public:
+	/**
+	@brief Construct a new dynamic mesh
+
+	@param layout			Layout of the interleaved vertices
+	@param max_vertices		Capacity of vertices
+	@param max_indices		Capacity of indices
+	@param regions_count	Number of copies, i.e. frames the GPU may lag behind plus one
+
+	The contents are undefined until updated, and nothing is drawn until
+	@ref set_counts() is called.
+	*/
+	static setsuna::ref<dynamic_mesh> create(const vertex_layout& layout,
+	                                         uint32_t max_vertices,
+	                                         uint32_t max_indices,
+	                                         uint32_t regions_count = 3);
+
+	/**
+	@brief Destructor
+	*/
+	~dynamic_mesh();
+
+	/**
+	@brief Move on to the next copy and bring it up to date
+
+	Call this once per frame before any update. Waits only if the GPU has not
+	finished the frame that last used the next copy, see @ref stalls() .
+
+	@param rewritten_vertices	Number of leading vertices that will be updated
+								entirely in this frame, e.g. all of them for
+								skinning, whose missed updates are not replayed
+	*/
+	void begin_frame(uint32_t rewritten_vertices = 0);
+
+	/**
+	@brief Update @p count vertices starting at @p first
+
+	@param first	Index of the first vertex to update
+	@param vertices	Interleaved vertices as described by the layout
+	@param count	Number of vertices
+	*/
+	void update_vertices(uint32_t first, const void* vertices, uint32_t count);
+
+	/**
+	@brief Update @p count indices starting at @p first
+
+	@param first	Offset of the first index to update
+	@param indices	Indices referring to vertices from 0
+	@param count	Number of indices
+	*/
+	void update_indices(uint32_t first, const uint32_t* indices, uint32_t count);
+
+	/**
+	@brief Set the number of vertices and indices to draw
+
+	If @p indices_count is zero, the vertices are drawn as a triangle list
+	without indices.
+	*/
+	void set_counts(uint32_t vertices_count, uint32_t indices_count);
+
+	/**
+	@brief Render the mesh from the current copy
+
+	If the vertex shader reads the instance attribute, the mesh must have been
+	drawn by @ref render_instanced() at least once.
+	*/
+	void render();
+
+	/**
+	@brief Render @p count instances of the mesh from the current copy
+
+	@param instance_buffer	Buffer of per-instance world matrices (@p glm::mat4 )
+	@param base_instance	Index of the first matrix to use in @p instance_buffer
+	@param count			Number of instances
+
+	The matrices are fed to the vertex shader the same way as by
+	@ref setsuna::mesh::render_instanced() , at location
+	@ref setsuna::mesh::instance_attribindex , so the same shaders draw both.
+	*/
+	void render_instanced(GLuint instance_buffer, GLuint base_instance, GLsizei count);
+
+	/**
+	@brief Record the commands of @ref render() into @p cmds
+
+	Does not call OpenGL. The commands refer to the current copy, so they
+	must be executed before the next @ref begin_frame() .
+	*/
+	void record(command_buffer& cmds) const;
+
+	/**
+	@brief Set the bounding box and the bounding sphere in model space
+
+	They are not derived from the updates, keep them conservative.
+	*/
+	void set_bounds(const aabb<3>& box, const sphere& bounding_sphere);
+
+	/**
+	@brief Get the bounding box in model space
+	*/
+	const aabb<3>& bounding_box() const { return m_aabb; }
+
+	/**
+	@brief Get the bounding sphere in model space
+	*/
+	const sphere& bounding_sphere() const { return m_bounding_sphere; }
+
+	/**
+	@brief Get the number of bytes written into mapped memory since the last @ref begin_frame()
+
+	Includes the updates of the earlier frames replayed by @ref begin_frame() .
+	*/
+	std::size_t streamed_bytes() const { return m_streamed_bytes; }
+
+	/**
+	@brief Get the number of times @ref begin_frame() had to wait for the GPU
+	*/
+	uint32_t stalls() const { return m_stream.stalls(); }
+
+	/**
+	@brief Get the layout of the vertices
+	*/
+	const vertex_layout& layout() const { return m_layout; }
+
+private:
+	dynamic_mesh(const vertex_layout& layout, uint32_t max_vertices, uint32_t max_indices, uint32_t regions_count);
+
+	// bytes [begin, end) relative to the start of a copy
+	struct byte_range {
+		std::size_t begin;
+		std::size_t end;
+	};
+
+	void write(std::size_t offset, const void* data, std::size_t size);
+
+	vertex_layout m_layout;
+	uint32_t m_max_vertices;
+	uint32_t m_max_indices;
+
+	// a copy holds the vertices first, then the indices at this offset
+	std::size_t m_indices_offset;
+	std::size_t m_copy_size;
+
+	stream_buffer m_stream;
+	GLuint m_vao;
+	bool m_instancing;
+
+	// offset of the current copy in the stream buffer and its region
+	GLintptr m_base;
+	uint32_t m_region;
+
+	// latest contents, and the ranges every region has missed since it was current
+	std::vector<uint8_t> m_shadow;
+	std::vector<std::vector<byte_range>> m_pending;
+
+	uint32_t m_vertices_count;
+	uint32_t m_indices_count;
+	std::size_t m_streamed_bytes;
+
+	aabb<3> m_aabb;
+	sphere m_bounding_sphere;
+};
+
+}  // namespace setsuna
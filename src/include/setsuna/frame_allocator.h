@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+/** @file
+@brief Header for @ref setsuna::frame_allocator
+*/
+
+namespace setsuna {
+
+/**
+@brief Linear allocator for frame-scoped data
+
+Memory is handed out by bumping an offset inside one big block, and nothing is
+freed individually. Everything is released at once by @ref reset() , typically at
+the beginning of a frame, which costs O(1).
+
+If a frame needs more than the block holds, extra blocks are allocated on the fly
+and the block is enlarged on the next @ref reset() , so that steady state frames
+never touch the heap.
+
+@attention Destructors of objects living in the allocator are never called,
+only store trivially destructible data, or containers using
+@ref setsuna::frame_allocator_adaptor , in it.
+
+@see @ref setsuna::frame_vector
+*/
+class frame_allocator {
+
+public:
+	/**
+	@brief Constructor
+
+	@param block_size Initial size of the block in bytes
+	*/
+	explicit frame_allocator(std::size_t block_size = 1 << 20);
+
+	/**
+	@brief Copying is not allowed
+	*/
+	frame_allocator(const frame_allocator&) = delete;
+
+	frame_allocator& operator=(const frame_allocator&) = delete;
+
+	/**
+	@brief Allocate @p size bytes aligned to @p alignment
+	*/
+	void* allocate(std::size_t size, std::size_t alignment) {
+		auto base = reinterpret_cast<std::uintptr_t>(m_block.get());
+		auto aligned = (base + m_head + alignment - 1) & ~(std::uintptr_t(alignment) - 1);
+		if (aligned + size <= base + m_block_size) {
+			m_head = aligned + size - base;
+			return reinterpret_cast<void*>(aligned);
+		}
+		return allocate_overflow(size, alignment);
+	}
+
+	/**
+	@brief Construct an object of type @p T in the allocator
+	*/
+	template<typename T, typename... args>
+	T* create(args&&... params) {
+		static_assert(std::is_trivially_destructible_v<T>, "Destructors are never called");
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<args>(params)...);
+	}
+
+	/**
+	@brief Release everything allocated so far
+	*/
+	void reset();
+
+	/**
+	@brief Get the number of bytes allocated since the last @ref reset()
+	*/
+	std::size_t used() const { return m_head + m_overflow_used; }
+
+	/**
+	@brief Get the size of the block in bytes
+	*/
+	std::size_t capacity() const { return m_block_size; }
+
+private:
+	void* allocate_overflow(std::size_t size, std::size_t alignment);
+
+private:
+	std::unique_ptr<uint8_t[]> m_block;
+	std::size_t m_block_size;
+	std::size_t m_head;
+
+	// blocks allocated when m_block is exhausted, freed by reset()
+	std::vector<std::unique_ptr<uint8_t[]>> m_overflow_blocks;
+	std::size_t m_overflow_size;
+	std::size_t m_overflow_head;
+	std::size_t m_overflow_used;
+};
+
+/**
+@brief Standard allocator adaptor of @ref setsuna::frame_allocator
+
+Deallocation does nothing, so a container using this adaptor must not be used
+after the @ref setsuna::frame_allocator is reset.
+*/
+template<typename T>
+class frame_allocator_adaptor {
+
+	template<typename U>
+	friend class frame_allocator_adaptor;
+
+public:
+	using value_type = T;
+
+	/**
+	@brief Construct from a @ref setsuna::frame_allocator
+	*/
+	frame_allocator_adaptor(frame_allocator& allocator) noexcept :
+	    m_allocator{&allocator} {}
+
+	/**
+	@brief Rebinding constructor
+	*/
+	template<typename U>
+	frame_allocator_adaptor(const frame_allocator_adaptor<U>& other) noexcept :
+	    m_allocator{other.m_allocator} {}
+
+	T* allocate(std::size_t n) {
+		return static_cast<T*>(m_allocator->allocate(sizeof(T) * n, alignof(T)));
+	}
+
+	void deallocate(T*, std::size_t) noexcept {}
+
+	template<typename U>
+	bool operator==(const frame_allocator_adaptor<U>& other) const noexcept {
+		return m_allocator == other.m_allocator;
+	}
+
+	template<typename U>
+	bool operator!=(const frame_allocator_adaptor<U>& other) const noexcept {
+		return !(*this == other);
+	}
+
+private:
+	frame_allocator* m_allocator;
+};
+
+/**
+@brief @p std::vector whose storage comes from a @ref setsuna::frame_allocator
+*/
+template<typename T>
+using frame_vector = std::vector<T, frame_allocator_adaptor<T>>;
+
+}  // namespace setsuna
@@ -3,6 +3,7 @@
 #include <glad/glad.h>
 #include <setsuna/texture.h>
 #include <setsuna/ref.h>
+#include <setsuna/readback_manager.h>
 #include <vector>
 
 /** @file
@@ -65,6 +66,28 @@ public:
 	*/
 	bool is_complete() const;
 
+	/**
+	@brief Read the color attachment indexed by @p index without stalling
+
+	The pixels are delivered as @p GL_RGBA / @p GL_UNSIGNED_BYTE by
+	@ref setsuna::readback_manager::update() a few frames later.
+
+	Leaves this framebuffer bound for reading and @p GL_PACK_ALIGNMENT at 1,
+	see @ref setsuna::readback_manager::request() . The read buffer of the
+	framebuffer is switched to the attachment for the copy and then restored.
+	*/
+	void read_color_async(std::size_t index, readback_manager::callback_t callback) const;
+
+	/**
+	@brief Read the depth attachment without stalling
+
+	The pixels are delivered as @p GL_DEPTH_COMPONENT / @p GL_FLOAT by
+	@ref setsuna::readback_manager::update() a few frames later.
+
+	Leaves this framebuffer bound for reading and @p GL_PACK_ALIGNMENT at 1.
+	*/
+	void read_depth_async(readback_manager::callback_t callback) const;
+
 private:
 	void add_attachment(ref<texture>&);
 
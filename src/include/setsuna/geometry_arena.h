@@ -0,0 +1,163 @@
+#pragma once
+
+#include <setsuna/vertex_layout.h>
+#include <setsuna/buffer.h>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace setsuna {
+
+class mesh;
+
+/*
+Layout of a command consumed by glMultiDrawElementsIndirect.
+*/
+struct draw_elements_indirect_command {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+
+/*
+Layout of a command consumed by glMultiDrawArraysIndirect.
+*/
+struct draw_arrays_indirect_command {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first;
+	GLuint base_instance;
+};
+
+/*
+Best-fit allocator of ranges in [0, capacity), free ranges are coalesced on release.
+Ranges of size zero are never tracked.
+*/
+class range_allocator {
+
+public:
+	explicit range_allocator(uint32_t capacity);
+
+	std::optional<uint32_t> allocate(uint32_t size);
+
+	void release(uint32_t offset, uint32_t size);
+
+	// everything below used is allocated, everything above is free
+	void reset(uint32_t used);
+
+	uint32_t capacity() const { return m_capacity; }
+	uint32_t used() const { return m_used; }
+	uint32_t largest_free() const;
+
+	// 0 if all free space is contiguous, close to 1 if it is scattered in small ranges
+	float fragmentation() const;
+
+private:
+	uint32_t m_capacity;
+	uint32_t m_used;
+
+	std::map<uint32_t, uint32_t> m_free_by_offset;
+	std::multimap<uint32_t, uint32_t> m_free_by_size;
+};
+
+/*
+This class stores the vertices and indices of meshes with the same vertex_layout.
+
+Vertices are sub-allocated from one big vertex buffer and indices from one big
+index buffer, so all meshes in the arena share one vertex array object.
+Draws recorded by draw() are gathered into an indirect buffer and issued by
+a single glMultiDrawElementsIndirect in submit(), followed by a single
+glMultiDrawArraysIndirect for the meshes without indices.
+
+Ranges are released when their meshes die, and meshes still holding ranges
+when the arena is destroyed are left empty. compact() moves all live ranges to
+the front of new buffers by GPU copies and patches the base vertex and first
+index of the owners, so it must not run between draw() and submit().
+*/
+class geometry_arena {
+
+	friend class geometry_manager;
+
+public:
+	~geometry_arena();
+
+	geometry_arena(const geometry_arena&) = delete;
+	geometry_arena& operator=(const geometry_arena&) = delete;
+
+	// return the base vertex of the allocated range, the data is written separately
+	std::optional<GLint> allocate_vertices(uint32_t count, mesh* owner);
+
+	// return the first index of the allocated range, the data is written separately
+	std::optional<uint32_t> allocate_indices(uint32_t count, mesh* owner);
+
+	void write_vertices(GLint base_vertex, const std::vector<uint8_t>& data);
+	void write_indices(uint32_t first_index, const std::vector<uint32_t>& indices);
+
+	// nothing happens unless owner owns the range
+	void release_vertices(GLint base_vertex, const mesh* owner);
+	void release_indices(uint32_t first_index, const mesh* owner);
+
+	void compact();
+
+	const range_allocator& vertices() const { return m_vertices; }
+	const range_allocator& indices() const { return m_indices; }
+	uint32_t compactions_count() const { return m_compactions_count; }
+
+	// record a draw for the next submit()
+	void draw(const draw_elements_indirect_command&);
+	void draw(const draw_arrays_indirect_command&);
+
+	// issue all recorded draws, instance attributes are sourced from instance_buffer
+	void submit(GLuint instance_buffer);
+
+	// set up the per-instance world matrix of the vertex array
+	void bind_instance_buffer(GLuint instance_buffer);
+
+	const vertex_layout& layout() const { return m_layout; }
+
+	GLuint vertex_array() const { return m_vao; }
+
+	GLuint vertex_buffer() const { return m_vertex_buffer.name(); }
+
+private:
+	// only called by geometry_manager
+	geometry_arena(const vertex_layout&, uint32_t vertices_capacity, uint32_t indices_capacity);
+
+	struct allocation {
+		uint32_t size;
+		mesh* owner;
+	};
+
+	// move the live ranges to the front of a new buffer, return the new buffer
+	buffer<buffer_usage::BU_DYNAMIC> compact(const buffer<buffer_usage::BU_DYNAMIC>& old_buffer,
+	                                         std::map<uint32_t, allocation>& allocations,
+	                                         range_allocator& allocator,
+	                                         std::size_t element_size,
+	                                         bool patch_base_vertex);
+
+private:
+	GLuint m_vao;
+	vertex_layout m_layout;
+	bool m_instancing;
+
+	buffer<buffer_usage::BU_DYNAMIC> m_vertex_buffer;
+	range_allocator m_vertices;
+	std::map<uint32_t, allocation> m_vertex_allocations;
+
+	buffer<buffer_usage::BU_DYNAMIC> m_index_buffer;
+	range_allocator m_indices;
+	std::map<uint32_t, allocation> m_index_allocations;
+
+	uint32_t m_compactions_count;
+
+	std::vector<draw_elements_indirect_command> m_commands;
+	std::vector<draw_arrays_indirect_command> m_array_commands;
+
+	// the array commands follow the element commands, capacity in bytes
+	buffer<buffer_usage::BU_DYNAMIC> m_indirect_buffer;
+	std::size_t m_indirect_capacity;
+};
+
+}  // namespace setsuna
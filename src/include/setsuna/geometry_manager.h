@@ -0,0 +1,150 @@
+#pragma once
+
+#include <setsuna/vertex_layout.h>
+#include <map>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::geometry_manager
+*/
+
+namespace setsuna {
+
+class geometry_arena;
+class mesh;
+
+/**
+@brief Utilization of one geometry arena
+
+Fragmentation is 0 if all free space is one contiguous range, and approaches 1
+as the free space is scattered into many small ranges.
+*/
+struct geometry_arena_statistics {
+	uint32_t vertex_stride;          /**< @brief Size of a vertex in bytes */
+	uint32_t vertices_capacity;      /**< @brief Max number of vertices */
+	uint32_t vertices_used;          /**< @brief Number of allocated vertices */
+	float vertices_fragmentation;    /**< @brief Fragmentation of the free vertices */
+	uint32_t indices_capacity;       /**< @brief Max number of indices */
+	uint32_t indices_used;           /**< @brief Number of allocated indices */
+	float indices_fragmentation;     /**< @brief Fragmentation of the free indices */
+	uint32_t compactions_count;      /**< @brief Number of compactions so far */
+};
+
+/**
+@brief Manager of the shared geometry arenas
+
+Meshes created by @ref setsuna::mesh::create_shared() do not own any buffers.
+Instead their vertices and indices are sub-allocated from a few big buffers
+shared by all meshes of the same @ref setsuna::vertex_layout . Drawing such
+meshes by @ref setsuna::mesh::render_indirect() only records a command, and
+@ref submit() then costs one API call per arena.
+
+Ranges are managed by best-fit free lists and returned when their meshes are
+destroyed. Once freed ranges are too scattered to hold a new mesh, the arena is
+compacted: the live ranges are moved to the front by GPU-side copies, so a
+compaction never happens between recording draws and @ref submit() as long as
+meshes are not created meanwhile. Call @ref compact() at a frame boundary to
+compact proactively.
+
+The default arena holds six indices per vertex, a typical ratio for closed
+triangle meshes, so that meshes rarely run out of index space before vertex
+space.
+*/
+class geometry_manager {
+
+public:
+	/**
+	@brief Geometry manager option
+
+	Default values: @p vertices_per_arena=1M , @p indices_per_arena=6M ,
+	@p compaction_threshold=0.5
+	*/
+	struct option {
+		uint32_t vertices_per_arena; /**< @brief Max number of vertices per arena */
+		uint32_t indices_per_arena;  /**< @brief Max number of indices per arena */
+		float compaction_threshold;  /**< @brief Fragmentation above which @ref compact() compacts an arena */
+	};
+
+public:
+	/**
+	@brief Get the geometry manager singleton
+	*/
+	static geometry_manager& instance() {
+		static geometry_manager _instance;
+		return _instance;
+	}
+
+	/**
+	@brief Destructor
+	*/
+	~geometry_manager();
+
+	geometry_manager(const geometry_manager&) = delete;
+	geometry_manager& operator=(const geometry_manager&) = delete;
+
+	/**
+	@brief Allocate vertices and indices of @p layout in the same arena
+
+	@param layout			Layout of the vertices
+	@param vertices_count	Number of vertices
+	@param indices_count	Number of indices
+	@param owner			The mesh whose base vertex and first index are patched if the ranges move
+	@param base_vertex		Receive the base vertex of the allocated vertices
+	@param first_index		Receive the first index of the allocated indices
+
+	Either both ranges are allocated or none. An arena with enough free but
+	fragmented space is compacted before a new arena is created. The data is
+	not written, the caller uploads it into the returned arena.
+
+	@return The arena where the ranges are allocated, or nullptr if they could
+	never fit in an arena
+	*/
+	geometry_arena* allocate(const vertex_layout& layout, uint32_t vertices_count, uint32_t indices_count,
+	                         mesh* owner, GLint& base_vertex, uint32_t& first_index);
+
+	/**
+	@brief Compact the arenas fragmented above @ref option::compaction_threshold
+
+	Must not be called between recording draws and @ref submit() .
+	*/
+	void compact();
+
+	/**
+	@brief Get the utilization of every arena
+	*/
+	std::vector<geometry_arena_statistics> statistics() const;
+
+	/**
+	@brief Issue the draws recorded in all arenas
+
+	@param instance_buffer Buffer of per-instance world matrices
+	*/
+	void submit(GLuint instance_buffer);
+
+	/**
+	@brief Delete all arenas and their buffers
+
+	Must be called while the OpenGL context is still current, e.g. before the
+	window is destroyed, since the singleton itself is destroyed too late.
+	Meshes still living in the arenas are left empty.
+	*/
+	void release();
+
+	/**
+	@brief Set the option
+
+	The new setting will take effect next time the manager creates a new arena.
+	*/
+	void set_option(const option& opt) {
+		m_option = opt;
+	}
+
+private:
+	geometry_manager();
+
+	std::map<vertex_layout, std::vector<geometry_arena*>> m_arenas;
+
+	option m_option;
+};
+
+}  // namespace setsuna
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <map>
+
+/** @file
+@brief Header for @ref setsuna::gl_state
+*/
+
+namespace setsuna {
+
+/**
+@brief Cache of the OpenGL binding state
+
+All binding calls of the engine pass through this tracker, which filters out
+the ones that would not change the current state. It assumes nobody else
+changes the bindings behind its back, call @ref invalidate() if that happens.
+
+When an OpenGL object is deleted, notify the tracker by the corresponding
+@p on_delete_xxx() function since a deleted name could be reused by a new object.
+*/
+class gl_state {
+
+public:
+	/**
+	@brief Counters of the state changing calls
+	*/
+	struct statistics {
+		uint64_t issued; /**< @brief Number of calls that reached OpenGL */
+		uint64_t elided; /**< @brief Number of calls filtered out as redundant */
+	};
+
+public:
+	/**
+	@brief Get the state tracker singleton
+	*/
+	static gl_state& instance() {
+		static gl_state _instance;
+		return _instance;
+	}
+
+	gl_state(const gl_state&) = delete;
+	gl_state& operator=(const gl_state&) = delete;
+
+	/**
+	@brief Use a program, i.e. @p glUseProgram
+	*/
+	void use_program(GLuint program);
+
+	/**
+	@brief Bind a vertex array, i.e. @p glBindVertexArray
+	*/
+	void bind_vertex_array(GLuint vao);
+
+	/**
+	@brief Bind a buffer to a non-indexed target, i.e. @p glBindBuffer
+	*/
+	void bind_buffer(GLenum target, GLuint buffer);
+
+	/**
+	@brief Bind a range of a buffer to an indexed target, i.e. @p glBindBufferRange
+	*/
+	void bind_buffer_range(GLenum target, GLuint index, GLuint buffer,
+	                       GLintptr offset, GLsizeiptr size);
+
+	/**
+	@brief Bind a texture to a texture unit, i.e. @p glBindTextureUnit
+	*/
+	void bind_texture_unit(GLuint unit, GLuint texture);
+
+	/**
+	@brief Bind a texture to the active texture unit, i.e. @p glBindTexture
+
+	Only needed by calls that do not support DSA yet. The engine never changes
+	the active texture unit, so it is always unit 0.
+	*/
+	void bind_texture(GLenum target, GLuint texture);
+
+	/**
+	@brief Bind a framebuffer, i.e. @p glBindFramebuffer
+
+	@p GL_FRAMEBUFFER sets both the draw and the read framebuffer.
+	Binding 0 binds the default framebuffer, see @ref set_default_framebuffer() .
+	*/
+	void bind_framebuffer(GLenum target, GLuint framebuffer);
+
+	/**
+	@brief Redirect the default framebuffer to @p framebuffer and bind it
+
+	For contexts without a window surface, e.g. headless rendering, where
+	framebuffer 0 is not renderable. Pass 0 to restore the real default.
+	*/
+	void set_default_framebuffer(GLuint framebuffer);
+
+	/**
+	@brief Set a pixel storage mode, i.e. @p glPixelStorei
+
+	E.g. @p GL_PACK_ALIGNMENT , used by @ref setsuna::readback_manager .
+	*/
+	void pixel_store(GLenum pname, GLint value);
+
+	/**
+	@brief Forget all cached bindings
+
+	The next binding call of every kind will always be issued.
+	*/
+	void invalidate();
+
+	/**
+	@brief Notify that a program is deleted
+	*/
+	void on_delete_program(GLuint program);
+
+	/**
+	@brief Notify that a vertex array is deleted
+	*/
+	void on_delete_vertex_array(GLuint vao);
+
+	/**
+	@brief Notify that a buffer is deleted
+	*/
+	void on_delete_buffer(GLuint buffer);
+
+	/**
+	@brief Notify that a texture is deleted
+	*/
+	void on_delete_texture(GLuint texture);
+
+	/**
+	@brief Notify that a framebuffer is deleted
+	*/
+	void on_delete_framebuffer(GLuint framebuffer);
+
+	/**
+	@brief Count a state changing call that is issued
+
+	For state cached elsewhere, e.g. uniform values in @ref setsuna::shader_program .
+	*/
+	void count_issued() { ++m_stats.issued; }
+
+	/**
+	@brief Count a state changing call that is elided
+
+	For state cached elsewhere, e.g. uniform values in @ref setsuna::shader_program .
+	*/
+	void count_elided() { ++m_stats.elided; }
+
+	/**
+	@brief Get the counters
+	*/
+	const statistics& stats() const { return m_stats; }
+
+	/**
+	@brief Reset the counters, e.g. at the beginning of a frame
+	*/
+	void reset_stats() { m_stats = statistics{0, 0}; }
+
+private:
+	gl_state();
+
+	// return true if the call should be issued
+	bool update(GLuint& cached, GLuint value);
+
+private:
+	// 0 is a valid binding, so use a name that is never generated
+	static constexpr GLuint unknown = 0xFFFFFFFF;
+
+	GLuint m_program;
+	GLuint m_vertex_array;
+	GLuint m_draw_framebuffer;
+	GLuint m_read_framebuffer;
+	GLuint m_default_framebuffer;
+
+	std::map<GLenum, GLuint> m_buffers;
+
+	struct buffer_range {
+		GLuint buffer;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+	std::map<std::pair<GLenum, GLuint>, buffer_range> m_buffer_ranges;
+	std::map<GLuint, GLuint> m_texture_units;
+	std::map<GLenum, GLint> m_pixel_store;
+
+	statistics m_stats;
+};
+
+}  // namespace setsuna
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <setsuna/render_queue.h>
+#include <setsuna/stream_buffer.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::instance_batcher
+*/
+
+namespace setsuna {
+
+/**
+@brief Batching stage that collapses identical draws into instanced draws
+
+Consecutive items of a sorted @ref setsuna::render_queue that share the same mesh
+and the same material instance are grouped into one batch, so each batch is drawn
+by a single instanced draw call, see @ref setsuna::mesh::render_instanced() .
+Items of a @ref setsuna::dynamic_mesh , such as skinned characters, are batched
+the same way and drawn by @ref setsuna::dynamic_mesh::render_instanced() .
+
+Given a @ref lod_selection , the level of detail of every item is selected by
+@ref setsuna::mesh::select_lod() and a batch is split where the level changes.
+Since the items of a mesh are sorted front to back, the levels only grow along
+a run and the splits are few.
+
+All per-draw data is streamed through a triple-buffered @ref setsuna::stream_buffer
+instead of uniforms:
+- the world matrices of all items are written as per-instance attributes,
+  each batch picks its range by the base instance, the dequantization of
+  quantized meshes (see @ref setsuna::mesh::dequantization()) is folded in;
+- the property block of every material (see @ref setsuna::material_instance::write_block())
+  is written once per frame and bound to the shader storage binding point
+  @ref #material_binding by range.
+
+Batches of meshes living in the shared geometry arenas are not drawn immediately
+but recorded as indirect commands, which are issued by @ref flush() with one
+multi-draw call per arena. The batcher flushes by itself whenever the material
+changes, so @ref flush() only needs to be called after the last batch, or before
+any other state that the recorded draws depend on changes.
+
+Usage example:
+
+@code{.cpp}
+instance_batcher::lod_selection lods{camera_position, projection_scale, 1.0f};
+queue.sort();
+batcher.build(queue, &lods);
+for (auto& b : batcher.batches()) {
+	batcher.render(b);
+}
+batcher.flush();
+@endcode
+*/
+class instance_batcher {
+
+public:
+	/**
+	@brief A group of items drawn by one instanced draw call
+	*/
+	struct batch {
+		render_item* item;         /**< @brief The first item of the group */
+		uint32_t base_instance;    /**< @brief Index of the first world matrix in the instance buffer */
+		uint32_t count;            /**< @brief Number of instances */
+		uint32_t lod;              /**< @brief Level of detail of all instances */
+		GLintptr material_offset;  /**< @brief Offset of the material block in the stream buffer */
+		GLsizeiptr material_size;  /**< @brief Size of the material block */
+	};
+
+	/**
+	@brief Level of detail selection of a frame
+
+	@see @ref setsuna::mesh::select_lod()
+	*/
+	struct lod_selection {
+		glm::vec3 camera_position; /**< @brief Position of the camera in world space */
+		float projection_scale;    /**< @brief Pixels per unit at distance 1 */
+		float max_pixels;          /**< @brief Tolerated deviation on screen in pixels */
+	};
+
+	/**
+	@brief Shader storage binding point of the material block
+	*/
+	static constexpr GLuint material_binding = 0;
+
+	/**
+	@brief Constructor
+
+	@param region_size Bytes of per-frame data, grows automatically if exceeded
+	*/
+	explicit instance_batcher(std::size_t region_size = 1 << 20);
+
+	/**
+	@brief Copying is not allowed
+	*/
+	instance_batcher(const instance_batcher&) = delete;
+
+	instance_batcher& operator=(const instance_batcher&) = delete;
+
+	/**
+	@brief Group the items of @p queue and stream their per-draw data
+
+	@p queue should be sorted so that items sharing states are adjacent.
+	The batches refer to the items of @p queue , so @p queue must stay
+	untouched until rendering is done.
+
+	Each call moves on to the next region of the stream buffer, so call it
+	once per frame. Meshes with levels of detail are drawn at level 0 if
+	@p lods is nullptr.
+	*/
+	void build(render_queue& queue, const lod_selection* lods = nullptr);
+
+	/**
+	@brief Draw a batch
+	*/
+	void render(const batch& b);
+
+	/**
+	@brief Issue the indirect draws recorded by @ref render()
+
+	@see @ref setsuna::geometry_manager::submit()
+	*/
+	void flush();
+
+	/**
+	@brief Get the batches built by the last @ref build()
+	*/
+	const std::vector<batch>& batches() const { return m_batches; }
+
+	/**
+	@brief Get the number of draw calls saved by the last @ref build()
+
+	That is the number of items minus the number of batches.
+	*/
+	uint32_t collapsed_draws() const { return m_collapsed_draws; }
+
+	/**
+	@brief Get the stream buffer holding the per-draw data
+	*/
+	const stream_buffer& stream() const { return *m_stream; }
+
+private:
+	// return false if the region is too small
+	bool build_impl(render_queue& queue, const lod_selection* lods);
+
+private:
+	std::vector<batch> m_batches;
+
+	std::unique_ptr<stream_buffer> m_stream;
+
+	GLint m_storage_alignment;
+
+	// the material block bound by render()
+	GLintptr m_bound_material;
+
+	uint32_t m_collapsed_draws;
+};
+
+}  // namespace setsuna
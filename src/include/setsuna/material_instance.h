@@ -79,6 +79,34 @@ public:
 	*/
 	void set_property(std::string_view name, setsuna::ref<texture> value);
 
+	/**
+	@brief Get the size of the property block in bytes
+
+	@see @ref write_block()
+	*/
+	std::size_t block_size() const;
+
+	/**
+	@brief Write all property values into @p dst as a std430 block
+
+	The block contains every color property as a @p vec4 , followed by every
+	texture property as a @p ivec4 (see @ref setsuna::texture_address ), followed by
+	every scalar property as a @p float . Properties of the same type are in order
+	of definition. For the material in @ref setsuna::material the shader side is:
+
+	@code{.glsl}
+	layout(std430, binding = 0) readonly buffer material_block {
+		vec4 albedo;
+		ivec4 normal_map;  // unit, layer
+		float roughness;
+		float metallic;
+	};
+	@endcode
+
+	Texture properties are bound to their texture units while writing.
+	*/
+	void write_block(uint8_t* dst) const;
+
 private:
 	// only called by material
 	material_instance(const material& prototype);
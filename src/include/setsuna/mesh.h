@@ -6,9 +6,16 @@
 #include <setsuna/ref.h>
 #include <setsuna/buffer.h>
 #include <setsuna/aabb.h>
+#include <setsuna/sphere.h>
+#include <setsuna/vertex_layout.h>
+#include <setsuna/mesh_optimizer.h>
+#include <setsuna/meshlet_builder.h>
+#include <setsuna/mesh_simplifier.h>
 
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <type_traits>
 
 /** @file
 @brief Header for @ref setsuna::mesh
@@ -16,6 +23,10 @@
 
 namespace setsuna {
 
+class geometry_arena;
+class command_buffer;
+class thread_pool;
+
 /**
 @brief Mesh attribute
 
@@ -24,12 +35,15 @@ namespace setsuna {
 template<typename T>
 struct attribute {
 
+	using value_type = T;
+
 	static constexpr auto size_bytes = sizeof(T);
 
 	// TODO replace GLenum with enum class
 	GLenum type;         /**< @brief Type of the elementary data, e.g. @p GL_FLOAT */
 	uint32_t components; /**< @brief Number of elementary data per attribute */
 	std::vector<T> data; /**< @brief Data of the attribute */
+	bool normalized;     /**< @brief Whether integer data is mapped to [0, 1] or [-1, 1] in the shader */
 
 	/**
 	@brief Constructor
@@ -45,9 +59,12 @@ struct attribute {
 	};
 	attribute attr(3, GL_FLOAT, std::move(positions));
 	@endcode
+
+	Integer data is converted to float as is unless @p normalized is true,
+	see @ref setsuna::vertex_quantizer for compressed formats.
 	*/
-	attribute(uint32_t components, GLenum type, std::vector<T> data) :
-	    type{type}, components{components}, data(std::move(data)) {}
+	attribute(uint32_t components, GLenum type, std::vector<T> data, bool normalized = false) :
+	    type{type}, components{components}, data(std::move(data)), normalized{normalized} {}
 };
 
 /*
@@ -72,11 +89,22 @@ std::size_t attributes_stride(std::size_t& min_count,
 
 /**
 @brief Static mesh
+
+The world matrix of a draw is always supplied by the caller, either as a
+uniform or in an instance buffer. If the positions are quantized (see
+@ref quantized()), every such matrix must include @ref dequantization() ,
+which @ref instance_matrix() does. @ref setsuna::instance_batcher takes care
+of it, callers of @ref render() , @ref render_instanced() , @ref render_ranges()
+and @ref record() have to do it themselves, or the mesh is drawn at the scale
+of the quantized integers, see @ref setsuna::meshlet_culler for an example.
 */
 class mesh : public resource {
 
 	RTTI_ENABLE(mesh, resource)
 
+	// patches the ranges when compacting
+	friend class geometry_arena;
+
 public:
 	/**
 	@brief Construct a new mesh
@@ -95,70 +123,283 @@ public:
 		auto stride = attributes_stride(count, attr, attrs...);
 
 		auto new_mesh = new mesh();
-		std::vector<uint8_t> data(stride * count);
-		uint32_t offset = 0;
+		new_mesh->create_vertex_array();
+		// the vertices are written straight into mapped staging memory
 		if (interleaved) {
-			create_interleaved_impl<0>(*new_mesh, data, offset, count, stride, attr, attrs...);
+			vertex_layout layout;
+			layout.stride = static_cast<uint32_t>(stride);
+			describe_impl<0>(layout, 0, attr, attrs...);
+			new_mesh->m_vertex_buffer.create_mapped(stride * count, [&](uint8_t* data) {
+				interleave_data(data, count, stride, attr, attrs...);
+			});
+			layout.apply(new_mesh->m_vao, new_mesh->m_vertex_buffer.name());
 		}
 		else {
-			create_impl<0>(*new_mesh, data, offset, count, attr, attrs...);
+			new_mesh->m_vertex_buffer.create_mapped(stride * count, [&](uint8_t* data) {
+				create_impl(data, count, attr, attrs...);
+			});
+			bind_impl<0>(*new_mesh, 0, count, attr, attrs...);
+		}
+
+		new_mesh->m_vertices_count = count;
+		return new_mesh;
+	}
+
+	/**
+	@brief Construct a new indexed mesh, optionally reordering its triangles and vertices
+
+	@param interleaved	Whether the attributes are interleaved
+	@param indices		Indices of the triangle list
+	@param opt			Optimizations to apply, @ref setsuna::mesh_optimization::MO_OVERDRAW
+						only takes effect if the first attribute holds @p glm::vec3 positions
+	@param attr			The first attribute
+	@param attrs		The remaining attributes
+
+	With @ref setsuna::mesh_optimization::MO_VERTEX_FETCH unreferenced vertices are dropped.
+	With @ref setsuna::mesh_optimization::MO_MESHLETS the triangles are regrouped into
+	meshlets after the other optimizations, see @ref meshlets() , which also requires
+	@p glm::vec3 positions. The vertex cache efficiency before and after is logged as
+	debug messages.
+
+	@see @ref setsuna::mesh_optimizer
+	*/
+	template<typename Attribute, typename... Attributes>
+	static setsuna::ref<mesh> create_indexed(bool interleaved,
+	                                         std::vector<uint32_t> indices,
+	                                         mesh_optimization opt,
+	                                         const Attribute& attr,
+	                                         const Attributes&... attrs) {
+		auto count = std::numeric_limits<std::size_t>::max();
+		attributes_stride(count, attr, attrs...);
+
+		const std::vector<glm::vec3>* positions = nullptr;
+		if constexpr (std::is_same_v<typename decltype(attr.data)::value_type, glm::vec3>) {
+			positions = &attr.data;
 		}
+		optimize_indices(indices, count, positions, opt);
 
-		new_mesh->m_vertex_buffer.create(data);
+		std::vector<meshlet> meshlets;
+		if ((opt & mesh_optimization::MO_MESHLETS) && positions != nullptr) {
+			meshlets = meshlet_builder::build(indices, *positions);
+		}
+
+		setsuna::ref<mesh> new_mesh;
+		if (opt & mesh_optimization::MO_VERTEX_FETCH) {
+			std::size_t unique_count;
+			auto remap = mesh_optimizer::optimize_vertex_fetch(indices, count, unique_count);
+			new_mesh = create(interleaved,
+			                  remap_attribute(attr, remap, unique_count),
+			                  remap_attribute(attrs, remap, unique_count)...);
+		}
+		else {
+			new_mesh = create(interleaved, attr, attrs...);
+		}
+		new_mesh->set_indices(indices);
+		new_mesh->m_meshlets = std::move(meshlets);
+		return new_mesh;
+	}
+
+	/**
+	@brief Construct a new mesh in the shared geometry arenas
+
+	The attributes are always interleaved and sub-allocated from the buffers
+	shared by all meshes of the same layout. Such a mesh could be drawn by
+	@ref render_indirect() in addition to @ref render() and @ref render_instanced() .
+
+	@see @ref setsuna::geometry_manager
+	*/
+	template<typename Attribute, typename... Attributes>
+	static setsuna::ref<mesh> create_shared(const Attribute& attr,
+	                                        const Attributes&... attrs) {
+		return create_shared_indexed({}, attr, attrs...);
+	}
+
+	/**
+	@brief Construct a new indexed mesh in the shared geometry arenas
+
+	Same as @ref create_shared() , but the vertices and @p indices are placed
+	in the same arena at once, which never moves the vertices unlike
+	@ref set_indices() afterwards.
+	*/
+	template<typename Attribute, typename... Attributes>
+	static setsuna::ref<mesh> create_shared_indexed(const std::vector<uint32_t>& indices,
+	                                                const Attribute& attr,
+	                                                const Attributes&... attrs) {
+		vertex_layout layout;
+		uint32_t count;
+		auto data = interleave(layout, count, attr, attrs...);
+
+		auto new_mesh = new mesh();
 		new_mesh->m_vertices_count = count;
+		new_mesh->allocate_shared(layout, data, indices);
 		return new_mesh;
 	}
 
+	/**
+	@brief Interleave attributes the same way as @ref create() does
+
+	@param layout	Receives the layout of the vertices
+	@param count	Receives the number of vertices
+	@param attr		The first attribute
+	@param attrs	The remaining attributes
+
+	@return The interleaved vertex data
+	*/
+	template<typename Attribute, typename... Attributes>
+	static std::vector<uint8_t> interleave(vertex_layout& layout,
+	                                       uint32_t& count,
+	                                       const Attribute& attr,
+	                                       const Attributes&... attrs) {
+		auto min_count = std::numeric_limits<std::size_t>::max();
+		auto stride = attributes_stride(min_count, attr, attrs...);
+
+		std::vector<uint8_t> data(stride * min_count);
+		layout.attributes.clear();
+		layout.stride = static_cast<uint32_t>(stride);
+		describe_impl<0>(layout, 0, attr, attrs...);
+		interleave_data(data.data(), min_count, stride, attr, attrs...);
+		count = static_cast<uint32_t>(min_count);
+		return data;
+	}
+
+	/**
+	@brief Construct a new mesh from vertices already interleaved as @p layout
+
+	@param layout			Layout of the vertices
+	@param vertices			Interleaved vertex data, @p layout.stride * @p vertices_count bytes
+	@param vertices_count	Number of vertices
+
+	The data is uploaded as is without any copy on the CPU, e.g. straight from
+	a memory-mapped file. The mesh always owns its buffers.
+	*/
+	static setsuna::ref<mesh> create_interleaved(const vertex_layout& layout,
+	                                             const void* vertices,
+	                                             uint32_t vertices_count);
+
 private:
-	template<uint32_t attribindex, typename Attribute, typename... Attributes>
-	static void create_impl(mesh& mesh,
-	                        std::vector<uint8_t>& data,
-	                        uint32_t& offset,
+	// attributes one after another, each in a single block copy
+	template<typename Attribute, typename... Attributes>
+	static void create_impl(uint8_t* data,
 	                        std::size_t count,
 	                        const Attribute& attr,
 	                        const Attributes&... attrs) {
 		if (!attr.data.empty()) {  // skip empty attributes
-			auto src = reinterpret_cast<const uint8_t*>(attr.data.data());
-			std::copy(src, src + Attribute::size_bytes * count, data.begin() + offset);
-			glVertexArrayAttribFormat(mesh.m_vao, attribindex,
-			                          attr.components, attr.type, GL_FALSE, offset);
+			std::memcpy(data, attr.data.data(), Attribute::size_bytes * count);
+			data += Attribute::size_bytes * count;
+		}
+		if constexpr (sizeof...(Attributes) != 0) {
+			create_impl(data, count, attrs...);
+		}
+	}
+
+	// the buffer object exists only once its data store is created, so bind afterwards
+	template<uint32_t attribindex, typename Attribute, typename... Attributes>
+	static void bind_impl(mesh& mesh,
+	                      GLintptr offset,
+	                      std::size_t count,
+	                      const Attribute& attr,
+	                      const Attributes&... attrs) {
+		if (!attr.data.empty()) {
+			glVertexArrayAttribFormat(mesh.m_vao, attribindex, attr.components, attr.type,
+			                          attr.normalized ? GL_TRUE : GL_FALSE, 0);
 			glEnableVertexArrayAttrib(mesh.m_vao, attribindex);
-			glVertexArrayVertexBuffer(mesh.m_vao, attribindex,
-			                          mesh.m_vertex_buffer.name(), 0, Attribute::size_bytes);
+			glVertexArrayVertexBuffer(mesh.m_vao, attribindex, mesh.m_vertex_buffer.name(),
+			                          offset, Attribute::size_bytes);
 			offset += Attribute::size_bytes * count;
 		}
 		if constexpr (sizeof...(Attributes) != 0) {
-			create_impl<attribindex + 1>(mesh, data, offset, count, attrs...);
+			bind_impl<attribindex + 1>(mesh, offset, count, attrs...);
 		}
 	}
 
+	// fill the formats of layout, the offsets are packed in order of location
 	template<uint32_t attribindex, typename Attribute, typename... Attributes>
-	static void create_interleaved_impl(mesh& mesh,
-	                                    std::vector<uint8_t>& data,
-	                                    uint32_t& offset,
-	                                    std::size_t count,
-	                                    std::size_t stride,
-	                                    const Attribute& attr,
-	                                    const Attributes&... attrs) {
+	static void describe_impl(vertex_layout& layout,
+	                          uint32_t offset,
+	                          const Attribute& attr,
+	                          const Attributes&... attrs) {
 		if (!attr.data.empty()) {  // skip empty attributes
-			for (uint32_t i = 0; i < count; ++i) {
-				auto src = reinterpret_cast<const uint8_t*>(attr.data.data()) +
-				           i * Attribute::size_bytes;
-				std::copy(src, src + Attribute::size_bytes,
-				          data.begin() + offset + i * stride);
+			layout.attributes.push_back(
+			  vertex_attribute_format{attribindex, attr.components, attr.type, offset, attr.normalized});
+			offset += Attribute::size_bytes;
+		}
+		if constexpr (sizeof...(Attributes) != 0) {
+			describe_impl<attribindex + 1>(layout, offset, attrs...);
+		}
+	}
+
+	/*
+	With every attribute present the layout is known at compile time and all
+	attributes are written in one fused pass, otherwise every present attribute
+	is copied in a strided pass of its own.
+	*/
+	template<typename Attribute, typename... Attributes>
+	static void interleave_data(uint8_t* data,
+	                            std::size_t count,
+	                            std::size_t stride,
+	                            const Attribute& attr,
+	                            const Attributes&... attrs) {
+		if (!attr.data.empty() && (!attrs.data.empty() && ...)) {
+			using layout_type = static_vertex_layout<typename Attribute::value_type,
+			                                         typename Attributes::value_type...>;
+			layout_type::interleave(data, 0, count, attr.data.data(), attrs.data.data()...);
+		}
+		else {
+			interleave_impl(data, 0, count, stride, attr, attrs...);
+		}
+	}
+
+	template<typename Attribute, typename... Attributes>
+	static void interleave_impl(uint8_t* data,
+	                            uint32_t offset,
+	                            std::size_t count,
+	                            std::size_t stride,
+	                            const Attribute& attr,
+	                            const Attributes&... attrs) {
+		if (!attr.data.empty()) {  // skip empty attributes
+			auto src = attr.data.data();
+			for (std::size_t i = 0; i < count; ++i) {
+				std::memcpy(data + offset + i * stride, src + i, Attribute::size_bytes);
 			}
-			glVertexArrayAttribFormat(mesh.m_vao, attribindex,
-			                          attr.components, attr.type, GL_FALSE, offset);
-			glEnableVertexArrayAttrib(mesh.m_vao, attribindex);
-			glVertexArrayVertexBuffer(mesh.m_vao, attribindex,
-			                          mesh.m_vertex_buffer.name(), 0, stride);
 			offset += Attribute::size_bytes;
 		}
 		if constexpr (sizeof...(Attributes) != 0) {
-			create_interleaved_impl<attribindex + 1>(mesh, data, offset, count, stride, attrs...);
+			interleave_impl(data, offset, count, stride, attrs...);
 		}
 	}
 
+	template<typename T>
+	static attribute<T> remap_attribute(const attribute<T>& attr,
+	                                    const std::vector<uint32_t>& remap,
+	                                    std::size_t unique_count) {
+		if (attr.data.empty()) return attr;
+		return attribute<T>(attr.components, attr.type,
+		                    mesh_optimizer::remap_vertices(attr.data, remap, unique_count),
+		                    attr.normalized);
+	}
+
+	// reorder triangles for the vertex cache and overdraw, positions could be nullptr
+	static void optimize_indices(std::vector<uint32_t>& indices,
+	                             std::size_t vertices_count,
+	                             const std::vector<glm::vec3>* positions,
+	                             mesh_optimization opt);
+
+	void allocate_shared(const vertex_layout& layout,
+	                     const std::vector<uint8_t>& data,
+	                     const std::vector<uint32_t>& indices);
+
+	// move the vertices out of a full arena together with the new indices
+	void reallocate_shared(const std::vector<uint32_t>& indices);
+
+	// meshes in the shared geometry arenas never own a vertex array
+	void create_vertex_array();
+
+	// source the instance attributes from instance_buffer, return the vertex array to draw with
+	GLuint bind_instance_buffer(GLuint instance_buffer);
+
+	// indices of a level of detail, level 0 if out of range
+	index_range lod_indices(uint32_t lod) const;
+
 public:
 	/**
 	@brief Destructor
@@ -176,29 +417,226 @@ public:
 
 	/**
 	@brief Render the mesh
+
+	If the vertex shader reads the instance attribute (see @ref #instance_attribindex),
+	the mesh must have been drawn by @ref render_instanced() at least once.
+	The world matrix uniform must come from @ref instance_matrix() for quantized meshes.
 	*/
 	void render();
 
+	/**
+	@brief Render @p count instances of the mesh
+
+	@param instance_buffer	Buffer of per-instance world matrices (@p glm::mat4 )
+	@param base_instance	Index of the first matrix to use in @p instance_buffer
+	@param count			Number of instances
+
+	The world matrix of every instance is fed to the vertex shader as a @p mat4
+	attribute at location @ref #instance_attribindex , for example:
+
+	@code{.glsl}
+	layout(location = 12) in mat4 instance_world;
+	@endcode
+
+	The matrices must come from @ref instance_matrix() for quantized meshes.
+	Only the indices of level of detail @p lod are drawn, see @ref set_lods() ,
+	a level out of range draws level 0.
+	*/
+	void render_instanced(GLuint instance_buffer, GLuint base_instance, GLsizei count, uint32_t lod = 0);
+
+	/**
+	@brief Record an indirect draw of @p count instances of the mesh
+
+	Only meshes created by @ref create_shared() could be drawn this way, otherwise
+	this function does nothing. The draw is actually issued by
+	@ref setsuna::geometry_manager::submit() .
+
+	@param base_instance	Index of the first world matrix in the instance buffer
+	@param count			Number of instances
+	@param lod				Level of detail, see @ref render_instanced()
+	*/
+	void render_indirect(GLuint base_instance, GLuint count, uint32_t lod = 0);
+
+	/**
+	@brief Render only the given ranges of the indices for one instance
+
+	@param ranges			Ranges relative to the indices of the mesh
+	@param instance_buffer	Buffer of per-instance world matrices, see @ref render_instanced()
+	@param base_instance	Index of the world matrix to use in @p instance_buffer
+
+	Typically the ranges are the visible meshlets found by @ref setsuna::meshlet_culler ,
+	or a level of detail. Every range is drawn by its own call, so adjacent ranges
+	should be merged. Does nothing if the mesh has no indices.
+	*/
+	void render_ranges(const std::vector<index_range>& ranges, GLuint instance_buffer, GLuint base_instance);
+
+	/**
+	@brief Record the commands of @ref render() into @p cmds
+
+	Same as @ref render() , the world matrix uniform recorded before must come
+	from @ref instance_matrix() for quantized meshes.
+
+	Does not call OpenGL, so it is safe to call from any thread as long as
+	the mesh is not modified meanwhile.
+	*/
+	void record(command_buffer& cmds) const;
+
+	/**
+	@brief Test if the mesh lives in a shared geometry arena
+	*/
+	bool shared() const { return m_arena != nullptr; }
+
+	/**
+	@brief First attribute location of the per-instance world matrix
+
+	A @p mat4 attribute takes up four consecutive locations.
+	*/
+	static constexpr uint32_t instance_attribindex = 12;
+
 	/**
 	@brief Set mesh indices
 
 	If @p indices is empty, then the previously set indices will be canceled
 	and the mesh will not use indices while rendering.
 
-	Currently only support 32-bit integer as index type.
+	The indices are stored as 8-bit, 16-bit or 32-bit integers, whichever is the
+	narrowest to address all vertices. Meshes in shared geometry arenas always
+	use 32-bit indices, since one indirect draw covers the whole arena. If the
+	indices do not fit in the arena of such a mesh, the vertices are copied
+	into another arena together with the indices, or into buffers of the mesh
+	itself if they could never fit in an arena.
+
+	Only @ref setsuna::mesh_optimization::MO_VERTEX_CACHE of @p opt takes effect,
+	since the mesh keeps no vertex data on the CPU, use @ref create_indexed() for
+	the other optimizations.
 	*/
-	void set_indices(const std::vector<uint32_t>& indices);
+	void set_indices(const std::vector<uint32_t>& indices,
+	                 mesh_optimization opt = mesh_optimization::MO_NONE);
 
 	/**
-	@brief Calculate the bounding box in model space
+	@brief Set mesh indices of type @p type
+
+	@param indices	Indices of type @p type , uploaded as is
+	@param count	Number of indices
+	@param type		@p GL_UNSIGNED_BYTE , @p GL_UNSIGNED_SHORT or @p GL_UNSIGNED_INT
+
+	The indices are widened to 32-bit integers if the mesh lives in a shared geometry arena.
+	*/
+	void set_indices(const void* indices, uint32_t count, GLenum type);
+
+	/**
+	@brief Set the levels of detail
+
+	All levels are stored in one index buffer, level 0 first, and they refer to
+	the same vertices, see @ref setsuna::mesh_simplifier::build_lods() . @ref render()
+	and @ref record() use level 0, @ref render_instanced() and @ref render_indirect()
+	draw the given level, which @ref setsuna::instance_batcher selects per instance:
+
+	@code{.cpp}
+	auto level = mesh->select_lod(world, camera_position, projection_scale, 1.0f);
+	mesh->render_instanced(instance_buffer, base_instance, 1, level);
+	@endcode
+
+	Only @ref setsuna::mesh_optimization::MO_VERTEX_CACHE of @p opt takes effect,
+	and it is applied to every level separately. The levels are canceled by
+	@ref set_indices() .
 	*/
-	void calculate_bounding_box(const std::vector<glm::vec3>& vertices);
+	void set_lods(const std::vector<mesh_lod>& lods,
+	              mesh_optimization opt = mesh_optimization::MO_NONE);
+
+	/**
+	@brief Get the levels of detail, empty unless set by @ref set_lods()
+	*/
+	const std::vector<lod_range>& lods() const { return m_lods; }
+
+	/**
+	@brief Select the coarsest level of detail whose error stays within @p max_pixels on screen
+
+	@param world			World matrix of the mesh
+	@param camera_position	Position of the camera in world space
+	@param projection_scale	Pixels per unit at distance 1, i.e.
+							`camera.projection_matrix()[1][1] * framebuffer_height * 0.5f`
+							for a perspective camera
+	@param max_pixels		Tolerated deviation on screen in pixels
+
+	The error is projected at the point of the bounding sphere closest to the camera,
+	which only overestimates its size on screen, the error itself is an estimate
+	though, see @ref setsuna::mesh_simplifier . Return 0 if the mesh has no levels
+	of detail.
+	*/
+	uint32_t select_lod(const glm::mat4& world,
+	                    const glm::vec3& camera_position,
+	                    float projection_scale,
+	                    float max_pixels) const;
+
+	/**
+	@brief Calculate the bounding box and the bounding sphere in model space
+
+	The bounding sphere is the tighter of the sphere centered at the box center
+	and the one centered at Ritter's sphere of a subsample, both with exact radii.
+	Large position streams are split across @p pool if not nullptr.
+
+	@see @ref setsuna::bounds_calculator
+	*/
+	void calculate_bounding_box(const std::vector<glm::vec3>& vertices, thread_pool* pool = nullptr);
+
+	/**
+	@brief Set the bounding box and the bounding sphere in model space computed elsewhere
+	*/
+	void set_bounds(const aabb<3>& box, const sphere& bounding_sphere);
 
 	/**
 	@brief Get the bounding box in model space
 	*/
 	const aabb<3>& bounding_box() const { return m_aabb; }
 
+	/**
+	@brief Get the bounding sphere in model space
+	*/
+	const sphere& bounding_sphere() const { return m_bounding_sphere; }
+
+	/**
+	@brief Get the meshlets in model space
+
+	Empty unless the mesh was created by @ref create_indexed() with
+	@ref setsuna::mesh_optimization::MO_MESHLETS , and cleared by @ref set_indices() .
+	*/
+	const std::vector<meshlet>& meshlets() const { return m_meshlets; }
+
+	/**
+	@brief Set the transform from quantized positions back to model space
+
+	Model space positions are @p offset + @p scale * the decoded positions. The
+	bounding volumes should still be calculated from the original positions.
+
+	@see @ref setsuna::vertex_quantizer::quantize_positions()
+	*/
+	void set_dequantization(const glm::vec3& offset, float scale);
+
+	/**
+	@brief Get the transform from quantized positions back to model space
+
+	The identity unless @ref set_dequantization() has been called. Since the scale
+	is uniform, it could be folded into the world matrix without affecting the
+	directions of normals, see @ref instance_matrix() .
+	*/
+	const glm::mat4& dequantization() const { return m_dequantization; }
+
+	/**
+	@brief Test if the positions are quantized
+	*/
+	bool quantized() const { return m_quantized; }
+
+	/**
+	@brief Get the matrix to draw the mesh with at @p world
+
+	@p world times @ref dequantization() if the positions are quantized,
+	otherwise @p world as is.
+	*/
+	glm::mat4 instance_matrix(const glm::mat4& world) const {
+		return m_quantized ? world * m_dequantization : world;
+	}
+
 private:
 	mesh();
 
@@ -209,7 +647,24 @@ private:
 	uint32_t m_vertices_count;
 	uint32_t m_indices_count;
 
+	// GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, always the last one in an arena
+	GLenum m_index_type;
+
+	// whether the instance attribute has been enabled
+	bool m_instancing;
+
+	// the arena holding the vertices and indices if created by create_shared()
+	geometry_arena* m_arena;
+	GLint m_base_vertex;
+	uint32_t m_first_index;
+
 	aabb<3> m_aabb;
+	sphere m_bounding_sphere;
+	std::vector<meshlet> m_meshlets;
+	std::vector<lod_range> m_lods;
+
+	glm::mat4 m_dequantization;
+	bool m_quantized;
 };
 
 }  // namespace setsuna
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::mesh_optimizer
+*/
+
+namespace setsuna {
+
+/**
+@brief Optimizations applied to a triangle list, could be combined by @p |
+*/
+enum class mesh_optimization : uint32_t {
+	MO_NONE = 0,            /**< @brief Keep the triangles as they are */
+	MO_VERTEX_CACHE = 1,    /**< @brief Reorder triangles for the post-transform vertex cache */
+	MO_OVERDRAW = 2,        /**< @brief Reorder clusters of triangles to reduce overdraw, implies @ref MO_VERTEX_CACHE */
+	MO_VERTEX_FETCH = 4,    /**< @brief Reorder vertices in order of first use */
+	MO_ALL = 7,             /**< @brief All of the above */
+	MO_MESHLETS = 8         /**< @brief Split into meshlets for cluster culling, see @ref setsuna::meshlet_builder */
+};
+
+constexpr mesh_optimization operator|(mesh_optimization lhs, mesh_optimization rhs) {
+	return static_cast<mesh_optimization>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
+}
+
+constexpr bool operator&(mesh_optimization lhs, mesh_optimization rhs) {
+	return (static_cast<uint32_t>(lhs) & static_cast<uint32_t>(rhs)) != 0;
+}
+
+/**
+@brief Efficiency of a triangle list on a FIFO post-transform vertex cache
+*/
+struct vertex_cache_statistics {
+	float acmr; /**< @brief Average cache miss ratio, i.e. transformed vertices per triangle, 0.5 at best */
+	float atvr; /**< @brief Average transformed vertex ratio, i.e. transformed per referenced vertex, 1 at best */
+};
+
+/**
+@brief Index and vertex reordering for triangle lists
+
+All functions work on triangle lists, i.e. three indices per triangle.
+*/
+class mesh_optimizer {
+
+public:
+	/**
+	@brief Simulate a FIFO vertex cache of @p cache_size entries
+	*/
+	static vertex_cache_statistics analyze_vertex_cache(const std::vector<uint32_t>& indices,
+	                                                    std::size_t vertices_count,
+	                                                    uint32_t cache_size = 16);
+
+	/**
+	@brief Reorder triangles by Forsyth's linear-speed vertex cache optimization
+
+	@return The reordered indices
+	*/
+	static std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t>& indices,
+	                                                   std::size_t vertices_count);
+
+	/**
+	@brief Reorder clusters of triangles so that outer-facing ones come first
+
+	@p indices should be optimized by @ref optimize_vertex_cache() first. The list is
+	split into clusters wherever the vertex cache would be cold anyway, or wherever the
+	cache efficiency so far is within @p threshold times the one of the whole list,
+	so the vertex cache efficiency degrades by at most about that ratio.
+
+	@return The reordered indices
+	*/
+	static std::vector<uint32_t> optimize_overdraw(const std::vector<uint32_t>& indices,
+	                                               const std::vector<glm::vec3>& positions,
+	                                               float threshold = 1.05f);
+
+	/**
+	@brief Renumber the vertices in order of first use
+
+	@param indices			Rewritten to refer to the new vertex order
+	@param vertices_count	Number of vertices
+	@param unique_count		Receive the number of referenced vertices
+
+	@return The table mapping an old vertex index to the new one, unreferenced
+	vertices map to @p 0xFFFFFFFF and are dropped
+	*/
+	static std::vector<uint32_t> optimize_vertex_fetch(std::vector<uint32_t>& indices,
+	                                                   std::size_t vertices_count,
+	                                                   std::size_t& unique_count);
+
+	/**
+	@brief Reorder per-vertex @p data by a table from @ref optimize_vertex_fetch()
+	*/
+	template<typename T>
+	static std::vector<T> remap_vertices(const std::vector<T>& data,
+	                                     const std::vector<uint32_t>& remap,
+	                                     std::size_t unique_count) {
+		std::vector<T> result(unique_count);
+		for (std::size_t i = 0; i < remap.size() && i < data.size(); ++i) {
+			if (remap[i] != unused) result[remap[i]] = data[i];
+		}
+		return result;
+	}
+
+	/**
+	@brief Mark of unreferenced vertices in a remap table
+	*/
+	static constexpr uint32_t unused = 0xFFFFFFFF;
+};
+
+}  // namespace setsuna
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <setsuna/meshlet_builder.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::mesh_simplifier
+*/
+
+namespace setsuna {
+
+/**
+@brief A simplified triangle list of a level of detail
+*/
+struct mesh_lod {
+	std::vector<uint32_t> indices; /**< @brief Triangle list referring to the original vertices */
+	float error;                   /**< @brief Estimated deviation from the full detail, in model space units, see @ref setsuna::mesh_simplifier */
+};
+
+/**
+@brief A level of detail stored in the index buffer of a mesh
+
+@see @ref setsuna::mesh::set_lods()
+*/
+struct lod_range {
+	index_range range; /**< @brief Indices of the level */
+	float error;       /**< @brief Estimated deviation from the full detail, in model space units */
+};
+
+/**
+@brief Simplification of triangle lists by quadric error metrics
+
+Edges are collapsed in order of the quadric error of Garland and Heckbert, always
+onto one of their end points, so a simplified list refers to a subset of the
+original vertices and all levels of detail could share one vertex buffer.
+
+To keep the silhouette and the attributes intact, vertices on open borders and
+vertices split by attribute seams (several vertices at the same position) are
+never removed, and collapses that flip a triangle or make the surface
+non-manifold are rejected.
+
+The error of a collapse is the root of the area-weighted mean squared distance
+from the remaining vertex to the planes of the original triangles around both
+end points. It estimates the typical deviation of the surface, but it is not
+an upper bound: a small triangle could deviate further than the error.
+*/
+class mesh_simplifier {
+
+public:
+	/**
+	@brief Simplify a triangle list
+
+	@param indices				Triangle list
+	@param positions			Vertex positions in model space
+	@param target_indices_count	Stop once there are no more indices than this
+	@param target_error			Never collapse an edge with a larger error, in model space units
+	@param result_error			Receives the error of the result if not nullptr
+
+	Fewer indices than requested may be removed if the error limit is reached,
+	or if no edge could be collapsed any more.
+
+	@return The simplified indices
+	*/
+	static std::vector<uint32_t> simplify(const std::vector<uint32_t>& indices,
+	                                      const std::vector<glm::vec3>& positions,
+	                                      std::size_t target_indices_count,
+	                                      float target_error,
+	                                      float* result_error = nullptr);
+
+	/**
+	@brief Build a chain of levels of detail
+
+	@param indices		Triangle list of the full detail
+	@param positions	Vertex positions in model space
+	@param max_levels	Maximum number of levels, including the full detail
+	@param reduction	Ratio of the triangles of a level to the previous one
+	@param max_error	Levels with a larger error are not generated, in model space units
+
+	Level 0 is @p indices itself with no error. Every next level is simplified
+	from the previous one, and its error is accumulated, so the errors never
+	decrease. The chain stops early once a level could not be reduced by at
+	least 10%.
+	*/
+	static std::vector<mesh_lod> build_lods(const std::vector<uint32_t>& indices,
+	                                        const std::vector<glm::vec3>& positions,
+	                                        uint32_t max_levels = 5,
+	                                        float reduction = 0.5f,
+	                                        float max_error = 1e30f);
+};
+
+}  // namespace setsuna
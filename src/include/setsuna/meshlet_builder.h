@@ -0,0 +1,101 @@
+#pragma once
+
+#include <setsuna/sphere.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::meshlet_builder
+*/
+
+namespace setsuna {
+
+class thread_pool;
+
+/**
+@brief A small cluster of triangles with its culling bounds
+
+The triangles of a meshlet are contiguous in the index buffer of its mesh.
+*/
+struct meshlet {
+	uint32_t first_index;    /**< @brief Offset of the first index relative to the indices of the mesh */
+	uint32_t indices_count;  /**< @brief Number of indices, three per triangle */
+	uint32_t vertices_count; /**< @brief Number of unique vertices referenced */
+	sphere bounds;           /**< @brief Bounding sphere in model space */
+
+	/**
+	@brief Average normal of the triangles in model space, zero if degenerate
+	*/
+	glm::vec3 cone_axis;
+
+	/**
+	@brief Sine of the half angle of the normal cone, 1 if the cone is wider than a half space
+
+	Every triangle faces away from a camera at @p p if
+	`dot(center - p, cone_axis) >= cone_cutoff * length(center - p) + radius`.
+	*/
+	float cone_cutoff;
+};
+
+/**
+@brief A range of indices of a mesh
+*/
+struct index_range {
+	uint32_t first_index; /**< @brief Offset of the first index relative to the indices of the mesh */
+	uint32_t count;       /**< @brief Number of indices */
+};
+
+/**
+@brief Splitting of triangle lists into meshlets
+
+@see @ref setsuna::meshlet_culler
+*/
+class meshlet_builder {
+
+public:
+	/**
+	@brief Default maximum number of unique vertices of a meshlet
+	*/
+	static constexpr uint32_t max_vertices = 64;
+
+	/**
+	@brief Default maximum number of triangles of a meshlet
+	*/
+	static constexpr uint32_t max_triangles = 124;
+
+	/**
+	@brief Split a triangle list into meshlets
+
+	@param indices				Triangle list, rewritten so that the triangles of every meshlet are contiguous
+	@param positions			Vertex positions in model space
+	@param vertices_limit		Maximum number of unique vertices of a meshlet, at least 3
+	@param triangles_limit		Maximum number of triangles of a meshlet, at least 1
+
+	Meshlets are grown greedily from a seed triangle by adding the neighboring
+	triangle that brings the fewest new vertices, ties broken by the distance to
+	the meshlet center, so meshlets tend to be compact and flat, which keeps the
+	bounding spheres small and the normal cones narrow. The seed of the next
+	meshlet is a neighbor of the previous one whenever possible, so the vertex
+	cache order of @p indices is mostly kept.
+
+	The bounding spheres are calculated by @ref setsuna::bounds_calculator at
+	the end, on @p pool if not nullptr.
+	*/
+	static std::vector<meshlet> build(std::vector<uint32_t>& indices,
+	                                  const std::vector<glm::vec3>& positions,
+	                                  uint32_t vertices_limit = max_vertices,
+	                                  uint32_t triangles_limit = max_triangles,
+	                                  thread_pool* pool = nullptr);
+
+	/**
+	@brief Compute the normal cone of @p m from its triangles
+
+	The bounding sphere is calculated by @ref setsuna::bounds_calculator::calculate() .
+	*/
+	static void compute_cone(meshlet& m,
+	                         const std::vector<uint32_t>& indices,
+	                         const std::vector<glm::vec3>& positions);
+};
+
+}  // namespace setsuna
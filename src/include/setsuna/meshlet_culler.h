@@ -0,0 +1,87 @@
+#pragma once
+
+#include <setsuna/meshlet_builder.h>
+#include <setsuna/frustum.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::meshlet_culler
+*/
+
+namespace setsuna {
+
+class camera;
+class mesh;
+
+/**
+@brief CPU culling of the meshlets of huge meshes
+
+A meshlet is dropped if its bounding sphere is outside the view frustum, or if
+its normal cone shows that all of its triangles face away from the camera.
+The surviving meshlets are merged into as few index ranges as possible and
+drawn by @ref setsuna::mesh::render_ranges() with the same world matrix, which
+includes the dequantization of quantized meshes, for example:
+
+@code{.cpp}
+meshlet_culler culler(cam);
+std::vector<index_range> ranges;
+if (culler.cull(*mesh, world, ranges) > 0) {
+	auto offset = stream.allocate(sizeof(glm::mat4), sizeof(glm::mat4));
+	if (offset) {
+		auto matrix = mesh->instance_matrix(world);
+		std::memcpy(stream.data(offset.value()), &matrix, sizeof(glm::mat4));
+		mesh->render_ranges(ranges, stream.name(), static_cast<GLuint>(offset.value() / sizeof(glm::mat4)));
+	}
+}
+@endcode
+
+Here @p stream is a @ref setsuna::stream_buffer whose region began this frame.
+
+Culling only reads the meshes, so one culler per thread could cull different
+meshes concurrently.
+*/
+class meshlet_culler {
+
+public:
+	/**
+	@brief Cull against the view frustum and the position of @p cam
+
+	The camera must have been updated for the frame.
+	*/
+	explicit meshlet_culler(const camera& cam);
+
+	/**
+	@brief Cull the meshlets of @p m placed by @p world
+
+	@param m		The mesh, see @ref setsuna::mesh::meshlets()
+	@param world	World matrix of the mesh
+	@param visible	Receives the index ranges of the visible meshlets, adjacent ones merged
+
+	The backface test is skipped if @p world scales non-uniformly, since the normal
+	cones would not be preserved. Meshes without meshlets yield no ranges, draw them
+	as usual.
+
+	@return Number of visible meshlets
+	*/
+	uint32_t cull(const mesh& m, const glm::mat4& world, std::vector<index_range>& visible);
+
+	/**
+	@brief Number of meshlets culled by the view frustum so far
+	*/
+	uint32_t frustum_culled() const { return m_frustum_culled; }
+
+	/**
+	@brief Number of meshlets culled by their normal cones so far
+	*/
+	uint32_t backface_culled() const { return m_backface_culled; }
+
+private:
+	frustum m_frustum;
+	glm::vec3 m_camera_position;
+
+	uint32_t m_frustum_culled;
+	uint32_t m_backface_culled;
+};
+
+}  // namespace setsuna
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::readback_manager
+*/
+
+namespace setsuna {
+
+/**
+@brief Pixels delivered by an asynchronous readback
+*/
+struct readback_result {
+	GLsizei width;               /**< @brief Width in pixels */
+	GLsizei height;              /**< @brief Height in pixels */
+	GLenum format;               /**< @brief Pixel format, e.g. @p GL_RGBA */
+	GLenum type;                 /**< @brief Type of a component, e.g. @p GL_UNSIGNED_BYTE */
+	std::vector<uint8_t> pixels; /**< @brief Rows from bottom to top, tightly packed */
+};
+
+/**
+@brief Asynchronous pixel readback manager
+
+A synchronous @p glReadPixels waits for the GPU to finish everything queued
+before it. Instead the pixels are copied into a pixel buffer object and a
+fence is placed, and @ref update() , polled on the main thread like
+@ref setsuna::resource_manager::update() , hands the pixels to the callback
+once the fence is signaled, usually a few frames later.
+
+The buffers form a ring. If all of them are still in flight, the oldest one
+is waited for, see @ref stalls() , and its pixels are handed to the callback
+by the next @ref update() . Callbacks are never called from within a request,
+so they are free to request again, e.g. to read every frame.
+
+@see @ref setsuna::framebuffer::read_color_async() @ref setsuna::framebuffer::read_depth_async()
+*/
+class readback_manager {
+
+public:
+	/**
+	@brief Callback receiving the pixels, called on the main thread
+	*/
+	using callback_t = std::function<void(const readback_result&)>;
+
+	/**
+	@brief Readback manager option
+
+	Default values: @p ring_size=3
+	*/
+	struct option {
+		uint32_t ring_size; /**< @brief Max number of readbacks in flight */
+	};
+
+public:
+	/**
+	@brief Get the readback manager singleton
+	*/
+	static readback_manager& instance() {
+		static readback_manager _instance;
+		return _instance;
+	}
+
+	/**
+	@brief Destructor
+	*/
+	~readback_manager();
+
+	readback_manager(const readback_manager&) = delete;
+	readback_manager& operator=(const readback_manager&) = delete;
+
+	/**
+	@brief Start reading a rectangle of a framebuffer
+
+	@param framebuffer	Name of the framebuffer, 0 for the default one
+	@param read_buffer	Color attachment to read, e.g. @p GL_COLOR_ATTACHMENT0 , or
+						@p GL_NONE to use the read buffer of the framebuffer as is
+	@param width		Width of the rectangle starting at the origin
+	@param height		Height of the rectangle starting at the origin
+	@param format		Pixel format, e.g. @p GL_RGBA or @p GL_DEPTH_COMPONENT
+	@param type			Type of a component, e.g. @p GL_UNSIGNED_BYTE
+	@param callback		Receive the pixels
+
+	Leaves @p framebuffer bound for reading and @p GL_PACK_ALIGNMENT at 1, both
+	tracked by @ref setsuna::gl_state . The read buffer of @p framebuffer is
+	restored after the copy.
+	*/
+	void request(GLuint framebuffer, GLenum read_buffer, GLsizei width, GLsizei height,
+	             GLenum format, GLenum type, callback_t callback);
+
+	/**
+	@brief Start reading the color of the default framebuffer
+	*/
+	void read_screen(GLsizei width, GLsizei height, callback_t callback) {
+		request(0, GL_NONE, width, height, GL_RGBA, GL_UNSIGNED_BYTE, std::move(callback));
+	}
+
+	/**
+	@brief Deliver the readbacks that are done
+
+	Call this once per frame on the main thread.
+	*/
+	void update();
+
+	/**
+	@brief Wait for and deliver all pending readbacks
+	*/
+	void flush();
+
+	/**
+	@brief Delete the buffers and the fences of the ring
+
+	Must be called while the OpenGL context is still current, e.g. before the
+	window is destroyed, since the singleton itself is destroyed too late.
+	Readbacks still in flight are dropped without calling their callbacks.
+	*/
+	void release();
+
+	/**
+	@brief Get the number of readbacks in flight
+	*/
+	uint32_t pending() const;
+
+	/**
+	@brief Get the number of times a request had to wait for an earlier readback
+	*/
+	uint32_t stalls() const { return m_stalls; }
+
+	/**
+	@brief Set the option
+
+	The new setting will take effect after all pending readbacks are delivered.
+	*/
+	void set_option(const option& opt) {
+		m_option = opt;
+	}
+
+private:
+	readback_manager();
+
+	struct slot {
+		GLuint pbo;
+		GLsizeiptr capacity;
+		GLsync fence;
+		readback_result result;
+		callback_t callback;
+	};
+
+	// pixels of a finished readback waiting for the callback
+	struct delivery {
+		readback_result result;
+		callback_t callback;
+	};
+
+	// wait for the slot, copy its pixels into m_ready and free the slot
+	void take(slot& s);
+
+	// call the callbacks of m_ready, which may issue new requests meanwhile
+	void deliver_ready();
+
+private:
+	std::vector<slot> m_slots;
+	std::vector<delivery> m_ready;
+
+	// the slot of the next request, slots are used and delivered in ring order
+	uint32_t m_next;
+
+	uint32_t m_stalls;
+
+	option m_option;
+};
+
+}  // namespace setsuna
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/** @file
+@brief Header for @ref setsuna::render_item
+*/
+
+namespace setsuna {
+
+class mesh;
+class dynamic_mesh;
+class material_instance;
+
+/**
+@brief Everything needed to draw one mesh
+
+A render item only holds non-owning handles, so it is cheap to copy and
+involves no reference counting. It is valid as long as the referenced
+object3d, mesh and material instance are alive and untouched, which is
+the case during the frame it is created for.
+
+An item draws either @ref mesh or, if not nullptr, @ref dynamic_mesh , e.g.
+the target of a @ref setsuna::skinned_mesh .
+
+@see @ref setsuna::render_queue
+*/
+struct render_item {
+
+	const glm::mat4* world_matrix;       /**< @brief The global transform matrix */
+	setsuna::mesh* mesh;                 /**< @brief The mesh to draw */
+	setsuna::material_instance* material; /**< @brief The material to draw with */
+	setsuna::dynamic_mesh* dynamic_mesh; /**< @brief The dynamic mesh to draw instead of @ref mesh , or nullptr */
+};
+
+}  // namespace setsuna
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <setsuna/texture_property.h>
+#include <string>
+#include <string_view>
+
+/** @file
+@brief Header for @ref setsuna::render_pass
+*/
+
+namespace setsuna {
+
+class render_system;
+
+/**
+@brief Handle of an attachment in a @ref setsuna::render_system
+*/
+using attachment_handle = uint32_t;
+
+/**
+@brief Declaration interface given to @ref setsuna::render_pass::setup()
+
+Attachments are identified by name. A transient attachment is created by the
+pass that first declares it, and its texture is only valid while the passes
+using it execute, so the texture may be shared with other transient attachments.
+*/
+class render_pass_builder {
+
+	friend class render_system;
+
+public:
+	/**
+	@brief Declare a transient attachment written by this pass
+	*/
+	attachment_handle create(std::string_view name, const texture_description& desc);
+
+	/**
+	@brief Declare that this pass reads the attachment @p name
+	*/
+	attachment_handle read(std::string_view name);
+
+	/**
+	@brief Declare that this pass writes the attachment @p name
+
+	Written attachments make up the framebuffer the pass renders to, color
+	attachments in order of declaration.
+	*/
+	attachment_handle write(std::string_view name);
+
+	/**
+	@brief Never cull this pass, e.g. it renders to the default framebuffer
+	*/
+	void set_side_effect();
+
+private:
+	render_pass_builder(render_system& system, uint32_t pass);
+
+	render_system* m_system;
+	uint32_t m_pass;
+};
+
+/**
+@brief A node of the frame graph
+
+Subclass it and add an instance to a @ref setsuna::render_system by
+@ref setsuna::render_system::add_pass() .
+*/
+class render_pass {
+
+	friend class render_system;
+
+public:
+	/**
+	@brief Constructor
+	*/
+	explicit render_pass(std::string_view name) :
+	    m_name(name) {}
+
+	/**
+	@brief Destructor
+	*/
+	virtual ~render_pass() = default;
+
+	/**
+	@brief Copying is not allowed
+	*/
+	render_pass(const render_pass&) = delete;
+
+	render_pass& operator=(const render_pass&) = delete;
+
+	/**
+	@brief Get the name of the pass
+	*/
+	const std::string& name() const { return m_name; }
+
+protected:
+	/**
+	@brief Declare the attachments read and written by the pass
+
+	Called by @ref setsuna::render_system::compile() . Keep the returned handles
+	to look up the textures in @ref execute() .
+	*/
+	virtual void setup(render_pass_builder& builder) = 0;
+
+	/**
+	@brief Record the rendering commands of the pass
+
+	The framebuffer made of the written attachments is already bound, or the
+	default framebuffer if the pass writes none.
+	*/
+	virtual void execute(const render_system& system) = 0;
+
+private:
+	std::string m_name;
+};
+
+}  // namespace setsuna
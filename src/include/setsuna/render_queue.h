@@ -0,0 +1,136 @@
+#pragma once
+
+#include <setsuna/render_item.h>
+#include <setsuna/frame_allocator.h>
+#include <glm/glm.hpp>
+
+/** @file
+@brief Header for @ref setsuna::render_queue
+*/
+
+namespace setsuna {
+
+class camera;
+
+/**
+@brief Queue of render items ordered by a packed 64-bit sort key
+
+Every item pushed is assigned a sort key, from the most significant bits to
+the least:
+
+| Pass        | Layout                                                                 |
+| ----------- | ---------------------------------------------------------------------- |
+| opaque      | pass(2) shader(12) material(16) mesh(16) depth(18)                     |
+| transparent | pass(2) inverted depth(18) shader(12) material(16) mesh(16)            |
+
+So opaque items are grouped by state and then drawn front to back, while
+transparent items are strictly drawn back to front.
+
+Sorting is a LSD radix sort over the keys and the item indices, the items
+themselves are never moved.
+
+All storage comes from a @ref setsuna::frame_allocator , so a queue must not be
+used after the allocator is reset. Usage example:
+
+@code{.cpp}
+render_queue queue(allocator);
+queue.begin(cam);
+queue.push(item, render_queue::pass::RP_OPAQUE, program.name());
+queue.sort();
+for (std::size_t i = 0; i < queue.size(); ++i) {
+	draw(queue[i]);
+}
+@endcode
+*/
+class render_queue {
+
+public:
+	/**
+	@brief Render pass an item belongs to
+
+	Passes are drawn in the order they are declared.
+	*/
+	enum class pass : uint32_t {
+		RP_OPAQUE,     /**< @brief Opaque pass, sorted by state then front to back */
+		RP_TRANSPARENT /**< @brief Transparent pass, sorted back to front */
+	};
+
+	/**
+	@brief Sort key type
+	*/
+	using key_t = uint64_t;
+
+	/**
+	@brief Constructor
+
+	@param allocator The allocator of the storage of the frame
+	*/
+	explicit render_queue(frame_allocator& allocator);
+
+	/**
+	@brief Clear the queue and prepare for a new frame
+
+	Depth of the items is measured in the view space of @p cam and quantized
+	between its near and far planes.
+	*/
+	void begin(const camera& cam);
+
+	/**
+	@brief Push an item into the queue
+
+	@param item		The item to render
+	@param p		The pass the item belongs to
+	@param shader	An id of the shader used to draw the item, e.g. @ref setsuna::shader_program::name()
+	*/
+	void push(const render_item& item, pass p, uint32_t shader = 0);
+
+	/**
+	@brief Sort the queued items by their keys
+	*/
+	void sort();
+
+	/**
+	@brief Get the number of queued items
+	*/
+	std::size_t size() const { return m_items.size(); }
+
+	/**
+	@brief Test if the queue is empty
+	*/
+	bool empty() const { return m_items.empty(); }
+
+	/**
+	@brief Get the @p i -th item in sorted order
+
+	Before @ref sort() is called, items are in the order they were pushed.
+	*/
+	render_item& operator[](std::size_t i) { return m_items[m_order[i]]; }
+
+	const render_item& operator[](std::size_t i) const { return m_items[m_order[i]]; }
+
+	/**
+	@brief Get the sort key of the @p i -th item in sorted order
+	*/
+	key_t key(std::size_t i) const { return m_keys[i]; }
+
+	/**
+	@brief Build a sort key
+	*/
+	static key_t make_key(pass p, uint32_t shader, uint32_t material, uint32_t mesh, float depth);
+
+private:
+	frame_vector<render_item> m_items;
+
+	// keys and item indices, sorted in pairs
+	frame_vector<key_t> m_keys;
+	frame_vector<uint32_t> m_order;
+
+	// ping-pong storage for sorting
+	frame_vector<key_t> m_keys_tmp;
+	frame_vector<uint32_t> m_order_tmp;
+
+	glm::mat4 m_view_matrix;
+	float m_near_plane, m_far_plane;
+};
+
+}  // namespace setsuna
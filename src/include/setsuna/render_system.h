@@ -0,0 +1,172 @@
+#pragma once
+
+#include <setsuna/render_pass.h>
+#include <setsuna/framebuffer.h>
+#include <setsuna/texture.h>
+#include <setsuna/ref.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::render_system
+*/
+
+namespace setsuna {
+
+/**
+@brief Frame graph of render passes
+
+Every pass declares the attachments it reads and writes. @ref compile() then
+
+- culls the passes whose outputs nobody reads,
+- orders the remaining passes so that every attachment is written before read,
+- assigns the transient attachments to textures, two attachments with the same
+  description share one texture if their lifetimes do not overlap.
+
+@ref execute() runs the passes in that order. Usage example:
+
+@code{.cpp}
+class blur_pass : public render_pass {
+	...
+	void setup(render_pass_builder& builder) override {
+		m_input = builder.read("hdr");
+		builder.create("blurred", desc);
+	}
+	void execute(const render_system& system) override {
+		auto input = system.attachment(m_input);
+		...
+	}
+};
+
+render_system system;
+system.add_pass<scene_pass>();
+system.add_pass<blur_pass>();
+system.add_pass<tonemap_pass>();
+system.compile();
+
+// every frame
+system.execute();
+@endcode
+
+Call @ref compile() again after adding passes or when the attachment
+descriptions change, e.g. on resizing.
+*/
+class render_system {
+
+	friend class render_pass_builder;
+
+public:
+	/**
+	@brief Default constructor
+	*/
+	render_system();
+
+	/**
+	@brief Copying is not allowed
+	*/
+	render_system(const render_system&) = delete;
+
+	render_system& operator=(const render_system&) = delete;
+
+	/**
+	@brief Add a pass of type @p T constructed from @p args
+	*/
+	template<typename T, typename... Args>
+	T& add_pass(Args&&... args) {
+		auto pass = new T(std::forward<Args>(args)...);
+		m_passes.emplace_back().pass.reset(pass);
+		m_compiled = false;
+		return *pass;
+	}
+
+	/**
+	@brief Make an external texture available to the passes as attachment @p name
+
+	Imported attachments are never aliased, and passes writing them are never culled.
+	*/
+	void import_attachment(std::string_view name, ref<texture> tex);
+
+	/**
+	@brief Build the execution order and allocate the attachments
+	*/
+	void compile();
+
+	/**
+	@brief Execute the passes, compiling first if needed
+	*/
+	void execute();
+
+	/**
+	@brief Get the texture of an attachment
+	*/
+	ref<texture> attachment(attachment_handle handle) const;
+
+	/**
+	@brief Get the number of passes culled by the last @ref compile()
+	*/
+	uint32_t culled_passes_count() const;
+
+	/**
+	@brief Get the number of transient attachments used by the executed passes
+	*/
+	uint32_t transient_attachments_count() const { return m_transient_count; }
+
+	/**
+	@brief Get the number of textures backing the transient attachments
+	*/
+	uint32_t transient_textures_count() const { return m_texture_count; }
+
+private:
+	struct pass_node {
+		std::unique_ptr<render_pass> pass;
+		std::vector<attachment_handle> reads;
+		std::vector<attachment_handle> writes;
+		bool side_effect;
+		uint32_t refs;
+		bool culled;
+		std::unique_ptr<framebuffer> target;
+	};
+
+	struct attachment_node {
+		std::string name;
+		texture_description description;
+		bool created;
+		bool imported;
+		ref<texture> tex;
+
+		// passes in order of declaration
+		std::vector<uint32_t> writers;
+		std::vector<uint32_t> readers;
+
+		uint32_t refs;
+
+		// positions in m_order of the first and the last pass using it
+		uint32_t first_use;
+		uint32_t last_use;
+	};
+
+	attachment_handle find_or_add(std::string_view name);
+
+	void cull();
+
+	bool sort();
+
+	void allocate();
+
+private:
+	std::vector<pass_node> m_passes;
+	std::vector<attachment_node> m_attachments;
+	std::map<std::string, attachment_handle, std::less<>> m_names;
+	std::map<std::string, ref<texture>, std::less<>> m_imports;
+
+	// indices of the passes to execute
+	std::vector<uint32_t> m_order;
+	bool m_compiled;
+
+	uint32_t m_transient_count;
+	uint32_t m_texture_count;
+};
+
+}  // namespace setsuna
@@ -58,8 +58,18 @@ public:
 	*/
 	void unref() const noexcept;
 
+	/**
+	@brief Get the unique id of the resource
+
+	Ids are assigned in creation order and never reused during the process,
+	making them suitable as compact keys, e.g. in @ref setsuna::render_queue .
+	*/
+	uint32_t id() const noexcept { return m_id; }
+
 private:
 	mutable uint32_t m_ref_count;
+
+	uint32_t m_id;
 };
 
 }  // namespace setsuna
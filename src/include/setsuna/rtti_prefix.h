@@ -11,9 +11,11 @@ For any cpp file that include header files below, include this prefix header ins
 #include <setsuna/camera.h>
 #include <setsuna/mesh_filter.h>
 #include <setsuna/mesh_renderer.h>
+#include <setsuna/skinned_mesh.h>
 
 #include <setsuna/resource.h>
 #include <setsuna/mesh.h>
+#include <setsuna/dynamic_mesh.h>
 #include <setsuna/texture.h>
 #include <setsuna/material_instance.h>
 
@@ -25,12 +25,14 @@ enum class shader_type {
 };
 
 /*
-A uniform variable of struct type can take up multiple locations
+A uniform variable of struct type can take up multiple locations.
+The last uploaded value is kept so that redundant uploads could be skipped.
 */
 struct uniform_info {
 
 	std::string type;
 	std::vector<GLint> locations;
+	std::vector<uint8_t> value;
 };
 
 /**
@@ -124,15 +126,35 @@ public:
 
 	/**
 	@brief Use the shader program
+
+	Uploading a uniform requires the program to be in use. Uploading the value
+	a uniform already holds is skipped, see @ref setsuna::gl_state::stats() .
 	*/
 	void apply();
 
+	/**
+	@brief Get the location of a uniform variable
+
+	Return -1 if the uniform does not exist. Useful for recording uploads into
+	a @ref setsuna::command_buffer .
+	*/
+	GLint uniform_location(std::string_view name) const;
+
+	/**
+	@brief Get the name of the program
+
+	Return 0 if the program has not been compiled successfully.
+	*/
+	GLuint name() const { return m_program; }
+
 private:
 	bool read_file(std::string_view filename, std::string& content);
 
 	GLuint create_shader(GLenum target, const std::string& source);
 
-	GLint* get_uniform_location(std::string_view& name);
+	// return nullptr if the uniform does not exist or already holds value
+	template<typename T>
+	GLint* prepare_upload(std::string_view& name, const T& value);
 
 private:
 	GLuint m_program;
@@ -0,0 +1,13 @@
+#pragma once
+
+/*
+SIMD instruction sets available to the implementation, not part of the API.
+
+SETSUNA_SSE2 is defined with the SSE2 intrinsics included if the target has
+them, which covers every x64 build. Code using them keeps a scalar fallback.
+*/
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SETSUNA_SSE2
+#include <emmintrin.h>
+#endif
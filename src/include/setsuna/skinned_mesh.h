@@ -0,0 +1,189 @@
+#pragma once
+
+#include <setsuna/component.h>
+#include <setsuna/dynamic_mesh.h>
+#include <setsuna/material_instance.h>
+#include <setsuna/vertex_layout.h>
+#include <setsuna/aabb.h>
+#include <setsuna/sphere.h>
+#include <setsuna/ref.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::skinned_mesh
+*/
+
+namespace setsuna {
+
+class skinning_pass;
+
+/**
+@brief Vertices in bind pose with their joints
+
+Every vertex is influenced by up to four joints, unused influences have a
+weight of zero. All vectors except @ref indices must have the same size.
+*/
+struct skin {
+	std::vector<glm::vec3> positions;  /**< @brief Positions in bind pose */
+	std::vector<glm::vec3> normals;    /**< @brief Normals in bind pose */
+	std::vector<glm::vec2> texcoords;  /**< @brief Texture coordinates, passed through */
+	std::vector<glm::u16vec4> joints;  /**< @brief Indices of the influencing joints */
+	std::vector<glm::vec4> weights;    /**< @brief Weights of the influencing joints */
+	std::vector<uint32_t> indices;     /**< @brief Triangle list */
+};
+
+/**
+@brief Skinned mesh component
+
+Deforms a @ref setsuna::skin on the CPU by blending the matrices of up to four
+joints per vertex, and writes the result into a @ref setsuna::dynamic_mesh
+to render, with the layout of @ref skinned_mesh::vertex . The skinning itself
+is done by a @ref setsuna::skinning_pass , which the component joins in
+@ref update() so that every character of the frame is skinned at once.
+
+The skinned vertices stay in model space, and the target is drawn like any
+other mesh: a culler tests the world space @ref bounding_box() refreshed by
+the pass, and queues the target as the @ref setsuna::render_item::dynamic_mesh
+of an item, which a @ref setsuna::instance_batcher draws instanced with the
+world matrix of the object. Usage example:
+
+@code{.cpp}
+thread_pool pool;
+skinning_pass skinning(pool);
+
+auto& character = obj.add_component<skinned_mesh>(skinning, std::move(bind_pose), joints_count);
+character.material = mi;
+
+// every frame
+animate(character.joint_matrices());
+scene->accept(update_visitor{});
+skinning.run();
+
+// queues render_item{&obj.world_matrix(), nullptr, character.material.get(), character.target().get()}
+scene->accept(culler);
+culler.render_queue.sort();
+batcher.build(culler.render_queue);
+for (auto& batch : batcher.batches()) {
+	batcher.render(batch);
+}
+batcher.flush();
+@endcode
+
+Normals are transformed by the blended matrix, which is exact for rotations
+and uniform scales. The time spent on each character is reported by
+@ref skinning_seconds() and @ref upload_seconds() , to budget crowds.
+*/
+class skinned_mesh : public component {
+
+	RTTI_ENABLE(skinned_mesh, component)
+
+	friend class skinning_pass;
+
+public:
+	/**
+	@brief Skinned vertex, in locations 0 to 2
+	*/
+	struct vertex {
+		glm::vec3 position; /**< @brief Position in model space */
+		glm::vec3 normal;   /**< @brief Normal in model space, normalized */
+		glm::vec2 texcoord; /**< @brief Texture coordinate */
+	};
+
+	/**
+	@brief Get the layout of @ref vertex
+	*/
+	static vertex_layout layout();
+
+	/**
+	@brief Constructor
+
+	@param o3d			The object3d
+	@param pass			The pass that skins this mesh, must outlive it
+	@param bind_pose	Vertices in bind pose, the missing normals and
+						texture coordinates are taken as zero
+	@param joints_count	Number of joints, greater than any joint index
+
+	Influences of out of range joints are dropped and the weights are normalized.
+	*/
+	skinned_mesh(object3d& o3d, skinning_pass& pass, skin bind_pose, uint32_t joints_count);
+
+	/**
+	@brief Queue the mesh into its skinning pass
+	*/
+	void update() override;
+
+	/**
+	@brief Get the skinning matrices, identity by default
+
+	The matrix of a joint transforms from bind pose to the current pose in
+	model space, i.e. the joint's transform relative to the mesh times its
+	inverse bind matrix. Set them before @ref setsuna::skinning_pass::run() .
+	*/
+	std::vector<glm::mat4>& joint_matrices() { return m_joint_matrices; }
+
+	/**
+	@brief Get the skinning matrices
+	*/
+	const std::vector<glm::mat4>& joint_matrices() const { return m_joint_matrices; }
+
+	/**
+	@brief Get the dynamic mesh holding the skinned vertices
+	*/
+	const ref<dynamic_mesh>& target() const { return m_target; }
+
+	/**
+	@brief Get the bounding box of the skinned vertices in world space
+
+	Refreshed by @ref setsuna::skinning_pass::run() , invalid until then.
+	*/
+	const aabb<3>& bounding_box() const { return m_aabb; }
+
+	/**
+	@brief Get the bounding sphere of the skinned vertices in world space
+	*/
+	const sphere& bounding_sphere() const { return m_bounding_sphere; }
+
+	/**
+	@brief Get the number of vertices
+	*/
+	uint32_t vertices_count() const { return static_cast<uint32_t>(m_bind_pose.positions.size()); }
+
+	/**
+	@brief Get the CPU time of the last skinning in seconds, summed over all threads
+	*/
+	double skinning_seconds() const { return m_skinning_seconds; }
+
+	/**
+	@brief Get the time of writing the last skinned vertices into the dynamic mesh in seconds
+	*/
+	double upload_seconds() const { return m_upload_seconds; }
+
+public:
+	/**
+	@brief The material to render
+	*/
+	ref<material_instance> material;
+
+private:
+	// skin the vertices [begin, end) into m_vertices and return their box
+	aabb<3> deform(uint32_t begin, uint32_t end);
+
+	skinning_pass* m_pass;
+	skin m_bind_pose;
+	std::vector<glm::mat4> m_joint_matrices;
+
+	// skinned vertices, the texture coordinates are written once
+	std::vector<vertex> m_vertices;
+	ref<dynamic_mesh> m_target;
+
+	// bounds in world space
+	aabb<3> m_aabb;
+	sphere m_bounding_sphere;
+
+	double m_skinning_seconds;
+	double m_upload_seconds;
+};
+
+}  // namespace setsuna
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <setsuna/aabb.h>
+#include <cstdint>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::skinning_pass
+*/
+
+namespace setsuna {
+
+class thread_pool;
+class skinned_mesh;
+
+/**
+@brief Skinning of every @ref setsuna::skinned_mesh of a frame on a thread pool
+
+Characters queue themselves during the scene update, then @ref run() splits
+all of their vertices into chunks of @ref chunk_vertices , so a crowd of
+small characters and a single huge one both keep every thread busy. Each
+vertex blends the matrices of its four joints with SSE where available, and
+the bounding box of the skinned vertices is reduced in the same loop.
+
+Once the chunks are done, the skinned vertices are written into the
+@ref setsuna::dynamic_mesh of each character on the calling thread, which
+begins a new frame of the dynamic mesh and updates its bounds, in model space
+on the dynamic mesh and in world space on the character for culling.
+*/
+class skinning_pass {
+
+public:
+	/**
+	@brief Number of vertices skinned per task
+	*/
+	static constexpr uint32_t chunk_vertices = 4096;
+
+	/**
+	@brief Constructor
+
+	@param pool	Threads to skin on, must outlive the pass
+	*/
+	explicit skinning_pass(thread_pool& pool);
+
+	skinning_pass(const skinning_pass&) = delete;
+	skinning_pass& operator=(const skinning_pass&) = delete;
+
+	/**
+	@brief Queue @p mesh to be skinned by the next @ref run()
+
+	Called by @ref setsuna::skinned_mesh::update() . The mesh must stay alive
+	until then.
+	*/
+	void add(skinned_mesh& mesh);
+
+	/**
+	@brief Skin the queued meshes and write them into their dynamic meshes
+
+	Call this on the main thread after updating the scene and before rendering.
+	*/
+	void run();
+
+	/**
+	@brief Get the number of meshes skinned by the last @ref run()
+	*/
+	uint32_t meshes_count() const { return m_meshes_count; }
+
+	/**
+	@brief Get the number of vertices skinned by the last @ref run()
+	*/
+	std::size_t vertices_count() const { return m_vertices_count; }
+
+	/**
+	@brief Get the wall time of the last @ref run() in seconds
+	*/
+	double seconds() const { return m_seconds; }
+
+private:
+	// a range of vertices of a queued mesh, and what skinning it yields
+	struct task {
+		skinned_mesh* mesh;
+		uint32_t begin;
+		uint32_t end;
+		double seconds;
+		aabb<3> box;
+	};
+
+	thread_pool* m_pool;
+	std::vector<skinned_mesh*> m_queue;
+	std::vector<task> m_tasks;
+
+	uint32_t m_meshes_count;
+	std::size_t m_vertices_count;
+	double m_seconds;
+};
+
+}  // namespace setsuna
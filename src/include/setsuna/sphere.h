@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <vector>
 
 /** @file
 @brief Header for @ref setsuna::sphere
@@ -27,6 +28,62 @@ struct sphere {
 	*/
 	sphere(const glm::vec3& c, float r) :
 	    center(c), radius{r} {}
+
+	/**
+	@brief Get the sphere transformed by an affine matrix @p m
+
+	The center is transformed as a point while the radius is scaled by the
+	largest axis scale of @p m , so the result still contains the transformed
+	sphere under non-uniform scaling.
+	*/
+	sphere transformed(const glm::mat4& m) const {
+		auto scale_sq = glm::max(glm::max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+		                                  glm::dot(glm::vec3(m[1]), glm::vec3(m[1]))),
+		                         glm::dot(glm::vec3(m[2]), glm::vec3(m[2])));
+		return sphere(glm::vec3(m * glm::vec4(center, 1.0f)), radius * glm::sqrt(scale_sq));
+	}
+
+	/**
+	@brief Get a sphere containing all of @p points by Ritter's method
+
+	Start with the sphere spanned by two far apart points, then grow it just enough
+	to cover every point lying outside. The result is within about 5% of the
+	minimal sphere in practice. Return an invalid sphere if @p points is empty.
+	*/
+	static sphere ritter(const std::vector<glm::vec3>& points) {
+		if (points.empty()) return sphere();
+
+		auto farthest = [&points](const glm::vec3& from) {
+			auto result = points.front();
+			auto max_dist_sq = 0.0f;
+			for (auto& p : points) {
+				auto d = p - from;
+				auto dist_sq = glm::dot(d, d);
+				if (dist_sq > max_dist_sq) {
+					max_dist_sq = dist_sq;
+					result = p;
+				}
+			}
+			return result;
+		};
+
+		auto p1 = farthest(points.front());
+		auto p2 = farthest(p1);
+
+		auto c = (p1 + p2) * 0.5f;
+		auto r = glm::length(p2 - p1) * 0.5f;
+		for (auto& p : points) {
+			auto dist = glm::length(p - c);
+			if (dist > r) {
+				// move the center towards p and enlarge the radius
+				auto new_r = (r + dist) * 0.5f;
+				c += (p - c) * ((new_r - r) / dist);
+				r = new_r;
+			}
+		}
+
+		return sphere(c, r);
+	}
 };
 
 }  // namespace setsuna
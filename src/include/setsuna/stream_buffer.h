@@ -0,0 +1,112 @@
+#pragma once
+
+#include <setsuna/buffer.h>
+#include <optional>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::stream_buffer
+*/
+
+namespace setsuna {
+
+/**
+@brief Ring of persistently mapped regions for streaming per-frame data
+
+The underlying @ref setsuna::buffer is split into a few equally sized regions
+(three by default). Data of one frame is sub-allocated from one region, and a
+fence is placed when the frame moves on to the next region. Before a region is
+reused its fence is waited on, so the CPU never overwrites data the GPU may
+still be reading, while in the common case the GPU is at most two frames behind
+and no waiting happens at all.
+
+Usage example:
+
+@code{.cpp}
+stream.begin_region();
+auto offset = stream.allocate(sizeof(glm::mat4), 64);
+if (offset) {
+	std::memcpy(stream.data(offset.value()), &world, sizeof(glm::mat4));
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, stream.name(), offset.value(), sizeof(glm::mat4));
+}
+@endcode
+*/
+class stream_buffer {
+
+public:
+	/**
+	@brief Constructor
+
+	@param region_size		Size of a region in bytes, rounded up to a multiple of 256
+	@param regions_count	Number of regions
+	*/
+	explicit stream_buffer(std::size_t region_size, uint32_t regions_count = 3);
+
+	/**
+	@brief Destructor
+	*/
+	~stream_buffer();
+
+	/**
+	@brief Copying is not allowed
+	*/
+	stream_buffer(const stream_buffer&) = delete;
+
+	stream_buffer& operator=(const stream_buffer&) = delete;
+
+	/**
+	@brief Fence the current region and move on to the next one
+
+	Block until the GPU finishes reading the next region if necessary.
+	Call this once per frame before any @ref allocate() .
+	*/
+	void begin_region();
+
+	/**
+	@brief Allocate @p size bytes in the current region
+
+	@param size			Size in bytes
+	@param alignment	Alignment of the returned offset, must be a power of two no greater than 256
+
+	@return Offset in bytes relative to the start of the buffer, or @p std::nullopt
+	if the current region has not enough space
+	*/
+	std::optional<GLintptr> allocate(std::size_t size, std::size_t alignment);
+
+	/**
+	@brief Get the mapped address at @p offset
+	*/
+	uint8_t* data(GLintptr offset) const { return m_buffer.data() + offset; }
+
+	/**
+	@brief Get the name of the buffer
+	*/
+	GLuint name() const { return m_buffer.name(); }
+
+	/**
+	@brief Get the size of a region in bytes
+	*/
+	std::size_t region_size() const { return m_region_size; }
+
+	/**
+	@brief Get the number of times @ref begin_region() had to wait for the GPU
+	*/
+	uint32_t stalls() const { return m_stalls; }
+
+private:
+	buffer<buffer_usage::BU_PERSISTENT> m_buffer;
+
+	std::vector<GLsync> m_fences;
+
+	std::size_t m_region_size;
+	uint32_t m_regions_count;
+
+	// current region and the allocated bytes in it
+	uint32_t m_region;
+	std::size_t m_head;
+	bool m_started;
+
+	uint32_t m_stalls;
+};
+
+}  // namespace setsuna
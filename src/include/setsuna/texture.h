@@ -53,6 +53,22 @@ public:
 	*/
 	void set_image(GLint mip_level, GLenum data_type, const void* data);
 
+	/**
+	@brief Set image data from a buffer object
+
+	@param mip_level	The mip level to set
+	@param data_type	The type of data, e.g. @p GL_UNSIGNED_BYTE
+	@param buffer		The buffer holding the image data
+	@param offset		Offset of the image data in @p buffer
+	@param size			Size of the image data in bytes
+
+	The copy is done by the GPU without touching client memory. If this is a
+	cubemap, the six faces are stored one after another, each @p size / 6 bytes.
+
+	@see @ref setsuna::upload_queue
+	*/
+	void set_image(GLint mip_level, GLenum data_type, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
 	/**
 	@brief Get the texture description
 	*/
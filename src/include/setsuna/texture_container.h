@@ -36,6 +36,10 @@ public:
 
 	void upload(GLint mip_level, texture_layer, GLenum data_type, const void* data);
 
+	// source the image from a pixel unpack buffer, the six faces of a cube map one after another
+	void upload(GLint mip_level, texture_layer, GLenum data_type,
+	            GLuint buffer, GLintptr offset, GLsizeiptr size);
+
 private:
 	// only called by texture_manager
 	texture_container(const texture_description&, uint32_t layers_count,
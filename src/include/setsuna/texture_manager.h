@@ -86,9 +86,6 @@ private:
 
 	std::map<texture_description, std::vector<texture_container*>> m_containers;
 
-	// keep track of which texture_container is using which texture_unit
-	std::map<texture_unit, texture_container*> m_units_assignments;
-
 	// keep a reference of default texture in case that it is automatically destroyed
 	ref<texture>* m_default_texture;
 
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+/** @file
+@brief Header for @ref setsuna::thread_pool
+*/
+
+namespace setsuna {
+
+/**
+@brief Fork-join pool of worker threads
+
+The pool runs one job at a time. A job is split into tasks that are grabbed by
+the workers and the calling thread alike, and @ref run() returns only after
+every task is done. Usage example:
+
+@code{.cpp}
+thread_pool pool;
+pool.parallel_for(items.size(), 1024, [&](std::size_t begin, std::size_t end) {
+	for (auto i = begin; i < end; ++i) {
+		process(items[i]);
+	}
+});
+@endcode
+
+Worker threads never own an OpenGL context, so tasks must not call OpenGL.
+*/
+class thread_pool {
+
+public:
+	/**
+	@brief Constructor
+
+	@param threads_count Number of worker threads, 0 means one less than
+	the number of hardware threads since the calling thread works too
+	*/
+	explicit thread_pool(uint32_t threads_count = 0);
+
+	/**
+	@brief Destructor, join all workers
+	*/
+	~thread_pool();
+
+	/**
+	@brief Copying is not allowed
+	*/
+	thread_pool(const thread_pool&) = delete;
+
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	/**
+	@brief Run @p task for every index in [0, @p tasks_count) and wait for all of them
+
+	Tasks may run in any order and on any thread, including the calling one.
+	*/
+	void run(std::size_t tasks_count, const std::function<void(std::size_t)>& task);
+
+	/**
+	@brief Split [0, @p count) into chunks of at least @p grain elements and process them in parallel
+
+	@p fn is called as @p fn(begin, end) once per chunk.
+	*/
+	template<typename F>
+	void parallel_for(std::size_t count, std::size_t grain, F&& fn) {
+		if (count == 0) return;
+
+		auto chunks = chunks_count(count, grain);
+		auto chunk_size = (count + chunks - 1) / chunks;
+		run(chunks, [&](std::size_t chunk) {
+			auto begin = chunk * chunk_size;
+			fn(begin, std::min(begin + chunk_size, count));
+		});
+	}
+
+	/**
+	@brief Number of chunks @ref parallel_for() splits @p count elements into
+	*/
+	std::size_t chunks_count(std::size_t count, std::size_t grain) const {
+		auto max_chunks = (count + std::max<std::size_t>(grain, 1) - 1) / std::max<std::size_t>(grain, 1);
+		return std::max<std::size_t>(std::min<std::size_t>(max_chunks, m_threads.size() + 1), 1);
+	}
+
+	/**
+	@brief Get the number of worker threads, not counting the calling thread
+	*/
+	uint32_t threads_count() const { return static_cast<uint32_t>(m_threads.size()); }
+
+private:
+	void work();
+
+	// grab and execute tasks of the current job until none is left
+	void drain(const std::function<void(std::size_t)>& task, std::size_t tasks_count);
+
+private:
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_job_cv;
+	std::condition_variable m_idle_cv;
+
+	// the current job, guarded by m_mutex
+	const std::function<void(std::size_t)>* m_task;
+	std::size_t m_tasks_count;
+	uint64_t m_generation;
+	uint32_t m_active;
+	bool m_stop;
+
+	std::atomic<std::size_t> m_next;
+};
+
+}  // namespace setsuna
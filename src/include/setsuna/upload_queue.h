@@ -0,0 +1,233 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <setsuna/buffer.h>
+#include <setsuna/ref.h>
+#include <setsuna/texture.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::upload_queue
+*/
+
+namespace setsuna {
+
+/**
+@brief Asynchronous upload queue for buffers and textures
+
+Uploading from client memory, e.g. by @p glNamedBufferStorage or
+@p glTextureSubImage3D , blocks the main thread while the driver copies the
+data. Instead, data is written into a persistently mapped staging ring by any
+thread, and @ref update() , called on the main thread once per frame, issues
+the copies from the ring into their destinations on the GPU, no more than
+@ref option::frame_budget bytes per frame. A fence placed after the copies of
+a frame tells when their staging memory could be reused and when the
+completion callbacks are called.
+
+Usage example, on a loading thread:
+
+@code{.cpp}
+auto region = upload_queue::instance().reserve(pixels_size);
+if (region) {
+	decode_image(region->data);
+}
+@endcode
+
+and later on the main thread:
+
+@code{.cpp}
+upload_queue::instance().upload_texture(region.value(), texture, 0, GL_UNSIGNED_BYTE);
+@endcode
+
+Uploads are issued in order of submission, and before the draws of the frame
+if @ref update() is called before rendering, so a destination could be used
+right after submission unless the budget is exhausted.
+
+@see @ref setsuna::readback_manager for the opposite direction
+*/
+class upload_queue {
+
+public:
+	/**
+	@brief Callback called on the main thread once an upload is complete on the GPU
+	*/
+	using callback_t = std::function<void()>;
+
+	/**
+	@brief Upload queue option
+
+	Default values: @p staging_size=64MiB, @p frame_budget=16MiB
+	*/
+	struct option {
+		std::size_t staging_size; /**< @brief Size of the staging ring in bytes */
+		std::size_t frame_budget; /**< @brief Max bytes issued per frame, at least one upload is always issued */
+	};
+
+	/**
+	@brief Memory reserved in the staging ring
+	*/
+	struct staging_region {
+		uint8_t* data;     /**< @brief Mapped address to write the data at */
+		std::size_t size;  /**< @brief Size in bytes */
+		GLintptr offset;   /**< @brief Offset in the staging buffer */
+		uint64_t sequence; /**< @brief Identifier of the reservation */
+	};
+
+public:
+	/**
+	@brief Get the upload queue singleton
+	*/
+	static upload_queue& instance() {
+		static upload_queue _instance;
+		return _instance;
+	}
+
+	/**
+	@brief Destructor
+	*/
+	~upload_queue();
+
+	upload_queue(const upload_queue&) = delete;
+	upload_queue& operator=(const upload_queue&) = delete;
+
+	/**
+	@brief Reserve @p size bytes in the staging ring, safe to call from any thread
+
+	The region must be passed to exactly one of @ref upload_buffer() ,
+	@ref upload_texture() or @ref release() , since the ring is recycled in
+	order of reservation.
+
+	@return The region, or @p std::nullopt if the ring is not created yet by
+	@ref update() or has not enough free space, then upload synchronously
+	*/
+	std::optional<staging_region> reserve(std::size_t size);
+
+	/**
+	@brief Give back a region without uploading it, safe to call from any thread
+	*/
+	void release(const staging_region& region);
+
+	/**
+	@brief Copy a region into @p buffer at @p offset , safe to call from any thread
+
+	The data store of @p buffer must exist and outlive the copy. Any buffer
+	usage works, since the copy does not need @p GL_DYNAMIC_STORAGE_BIT .
+	*/
+	void upload_buffer(const staging_region& region, GLuint buffer, GLintptr offset,
+	                   callback_t callback = nullptr);
+
+	/**
+	@brief Copy a region into a mip level of @p target , call on the main thread
+
+	@see @ref setsuna::texture::set_image(GLint, GLenum, GLuint, GLintptr, GLsizeiptr)
+	*/
+	void upload_texture(const staging_region& region, ref<texture> target, GLint mip_level,
+	                    GLenum data_type, callback_t callback = nullptr);
+
+	/**
+	@brief Issue the pending uploads within the budget and complete the finished ones
+
+	Call this once per frame on the main thread, before rendering.
+	*/
+	void update();
+
+	/**
+	@brief Issue all pending uploads and wait for them to complete
+	*/
+	void flush();
+
+	/**
+	@brief Delete the staging ring and the fences of the uploads in flight
+
+	Must be called while the OpenGL context is still current, e.g. before the
+	window is destroyed, since the singleton itself is destroyed too late.
+	Pending uploads are dropped without calling their callbacks, and regions
+	reserved before are ignored when given back.
+	*/
+	void release();
+
+	/**
+	@brief Get the number of bytes reserved and not yet complete
+	*/
+	std::size_t pending_bytes() const;
+
+	/**
+	@brief Get the number of bytes issued by the last @ref update()
+	*/
+	std::size_t issued_bytes() const { return m_issued_bytes; }
+
+	/**
+	@brief Get the number of reservations that failed for lack of space
+	*/
+	uint32_t rejected() const;
+
+	/**
+	@brief Set the option
+
+	A new staging size takes effect once all pending uploads are complete.
+	*/
+	void set_option(const option& opt) {
+		m_option = opt;
+	}
+
+private:
+	upload_queue();
+
+	struct reservation {
+		uint64_t end;  // position in the ring just past the region, counted from the creation
+		bool done;
+	};
+
+	struct request {
+		staging_region region;
+		GLuint buffer;  // 0 for textures
+		GLintptr offset;
+		ref<texture> target;
+		GLint mip_level;
+		GLenum data_type;
+		callback_t callback;
+	};
+
+	struct batch {
+		GLsync fence;
+		std::vector<uint64_t> sequences;
+		std::vector<callback_t> callbacks;
+		std::vector<ref<texture>> targets;  // kept alive until their copies are done
+	};
+
+	// issue up to budget bytes of requests, all of them if budget is zero
+	void issue(std::size_t budget);
+
+	// complete the batches whose fences are signaled, or all of them if wait
+	void complete(bool wait);
+
+	// recycle the ring up to the oldest reservation not done, with m_mutex locked
+	void mark_done(uint64_t sequence);
+
+private:
+	buffer<buffer_usage::BU_PERSISTENT> m_staging;
+
+	// guards everything below that worker threads touch
+	mutable std::mutex m_mutex;
+	uint8_t* m_data;
+	std::size_t m_capacity;
+	uint64_t m_head;
+	uint64_t m_tail;
+	std::deque<reservation> m_reservations;
+	uint64_t m_first_sequence;
+	std::deque<request> m_requests;
+	uint32_t m_rejected;
+
+	// main thread only
+	std::deque<batch> m_batches;
+	std::size_t m_issued_bytes;
+
+	option m_option;
+};
+
+}  // namespace setsuna
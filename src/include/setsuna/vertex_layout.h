@@ -0,0 +1,121 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <tuple>
+
+/** @file
+@brief Header for @ref setsuna::vertex_layout
+*/
+
+namespace setsuna {
+
+/**
+@brief Format of one interleaved vertex attribute
+*/
+struct vertex_attribute_format {
+	uint32_t attribindex; /**< @brief Attribute location in the vertex shader */
+	uint32_t components;  /**< @brief Number of elementary data per attribute */
+	GLenum type;          /**< @brief Type of the elementary data, e.g. @p GL_FLOAT */
+	uint32_t offset;      /**< @brief Offset in bytes relative to the start of a vertex */
+	bool normalized;      /**< @brief Whether integer data is mapped to [0, 1] or [-1, 1] instead of converted as is */
+};
+
+/**
+@brief Layout of an interleaved vertex
+
+Two meshes with equal layouts can share the same vertex array object and
+vertex buffer, see @ref setsuna::geometry_manager .
+*/
+struct vertex_layout {
+	std::vector<vertex_attribute_format> attributes; /**< @brief Attributes in order of location */
+	uint32_t stride;                                 /**< @brief Size of a vertex in bytes */
+
+	/**
+	@brief Set up the attribute formats of @p vao and source them from @p buffer
+
+	All attributes are sourced from binding index 0.
+	*/
+	void apply(GLuint vao, GLuint buffer) const {
+		for (auto& attr : attributes) {
+			glVertexArrayAttribFormat(vao, attr.attribindex,
+			                          attr.components, attr.type,
+			                          attr.normalized ? GL_TRUE : GL_FALSE, attr.offset);
+			glVertexArrayAttribBinding(vao, attr.attribindex, 0);
+			glEnableVertexArrayAttrib(vao, attr.attribindex);
+		}
+		glVertexArrayVertexBuffer(vao, 0, buffer, 0, stride);
+	}
+};
+
+/**
+@brief Layout of an interleaved vertex known at compile time
+
+@tparam Ts Types of the attributes in order of location, all present
+
+The offsets and the stride are constants, so interleaving is a single pass
+over the vertices writing every attribute with a fixed-size copy, which the
+compiler lowers to plain vector loads and stores instead of byte loops. Used
+by @ref setsuna::mesh::create() whenever no attribute is empty.
+*/
+template<typename... Ts>
+struct static_vertex_layout {
+	static_assert(sizeof...(Ts) > 0, "A vertex needs at least one attribute");
+	static_assert((std::is_trivially_copyable_v<Ts> && ...), "Attributes must be trivially copyable");
+
+	/**
+	@brief Size of a vertex in bytes
+	*/
+	static constexpr uint32_t stride = (0 + ... + static_cast<uint32_t>(sizeof(Ts)));
+
+	/**
+	@brief Offset in bytes of attribute @p I relative to the start of a vertex
+	*/
+	template<std::size_t I>
+	static constexpr uint32_t offset() {
+		constexpr uint32_t sizes[] = {static_cast<uint32_t>(sizeof(Ts))...};
+		uint32_t result = 0;
+		for (std::size_t k = 0; k < I; ++k) result += sizes[k];
+		return result;
+	}
+
+	/**
+	@brief Interleave the vertices [ @p begin , @p end ) of @p src into @p dst
+
+	@param dst		Start of the interleaved data, e.g. a mapped buffer
+	@param begin	First vertex
+	@param end		One past the last vertex
+	@param src		Start of the data of every attribute
+	*/
+	static void interleave(uint8_t* dst, std::size_t begin, std::size_t end, const Ts*... src) {
+		interleave(dst, begin, end, std::index_sequence_for<Ts...>{}, src...);
+	}
+
+private:
+	template<std::size_t... I>
+	static void interleave(uint8_t* dst,
+	                       std::size_t begin,
+	                       std::size_t end,
+	                       std::index_sequence<I...>,
+	                       const Ts*... src) {
+		for (auto i = begin; i < end; ++i) {
+			auto vertex = dst + i * stride;
+			(std::memcpy(vertex + offset<I>(), src + i, sizeof(Ts)), ...);
+		}
+	}
+};
+
+// for key comparison
+inline bool operator<(const vertex_attribute_format& lhs, const vertex_attribute_format& rhs) {
+	return std::tie(lhs.attribindex, lhs.components, lhs.type, lhs.offset, lhs.normalized) <
+	       std::tie(rhs.attribindex, rhs.components, rhs.type, rhs.offset, rhs.normalized);
+}
+
+inline bool operator<(const vertex_layout& lhs, const vertex_layout& rhs) {
+	return std::tie(lhs.stride, lhs.attributes) < std::tie(rhs.stride, rhs.attributes);
+}
+
+}  // namespace setsuna
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <setsuna/mesh.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <vector>
+
+/** @file
+@brief Header for @ref setsuna::vertex_quantizer
+*/
+
+namespace setsuna {
+
+/**
+@brief Compressed vertex attribute formats
+
+Every function returns an @ref setsuna::attribute ready to be passed to
+@ref setsuna::mesh::create() and the like. Compared to @p float attributes,
+a vertex of position, texture coordinate and normal takes 16 bytes instead of 32:
+
+@code{.cpp}
+glm::vec3 offset;
+float scale;
+auto mesh = mesh::create_indexed(true, std::move(indices), mesh_optimization::MO_ALL,
+                                 vertex_quantizer::quantize_positions(positions, offset, scale),
+                                 vertex_quantizer::quantize_texcoords(texcoords),
+                                 vertex_quantizer::encode_normals(normals));
+mesh->set_dequantization(offset, scale);
+mesh->calculate_bounding_box(positions);
+@endcode
+
+All components are 16-bit so that every attribute stays 4-byte aligned.
+*/
+class vertex_quantizer {
+
+public:
+	/**
+	@brief Quantize positions to normalized 16-bit integers relative to their bounds
+
+	@param positions	Positions in model space
+	@param offset		Receives the center of the bounding box
+	@param scale		Receives the largest half extent of the bounding box
+
+	The scale is uniform over all axes, so it could be folded into the world matrix
+	without distorting normals, see @ref setsuna::mesh::set_dequantization() . The
+	fourth component decodes to 1, the vertex shader may read a @p vec3 or a @p vec4 .
+	*/
+	static attribute<glm::i16vec4> quantize_positions(const std::vector<glm::vec3>& positions,
+	                                                  glm::vec3& offset,
+	                                                  float& scale);
+
+	/**
+	@brief Convert positions to half floats
+
+	No dequantization is needed, but the precision is relative to the magnitude,
+	so this suits meshes modeled around the origin. The fourth component is 1.
+	*/
+	static attribute<glm::u16vec4> half_positions(const std::vector<glm::vec3>& positions);
+
+	/**
+	@brief Encode unit normals by octahedral mapping into two normalized 16-bit integers
+
+	Decode in the vertex shader with:
+
+	@code{.glsl}
+	vec3 decode_normal(vec2 e) {
+		vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+		float t = max(-n.z, 0.0);
+		n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+		return normalize(n);
+	}
+	@endcode
+	*/
+	static attribute<glm::i16vec2> encode_normals(const std::vector<glm::vec3>& normals);
+
+	/**
+	@brief Decode a normal encoded by @ref encode_normals() , same as the shader does
+	*/
+	static glm::vec3 decode_normal(const glm::i16vec2& encoded);
+
+	/**
+	@brief Quantize texture coordinates to normalized unsigned 16-bit integers
+
+	Coordinates outside [0, 1] are clamped with a warning, use
+	@ref half_texcoords() for repeating textures.
+	*/
+	static attribute<glm::u16vec2> quantize_texcoords(const std::vector<glm::vec2>& texcoords);
+
+	/**
+	@brief Convert texture coordinates to half floats
+	*/
+	static attribute<glm::u16vec2> half_texcoords(const std::vector<glm::vec2>& texcoords);
+};
+
+}  // namespace setsuna
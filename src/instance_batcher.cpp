@@ -0,0 +1,119 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/instance_batcher.h>
+#include <setsuna/mesh.h>
+#include <setsuna/dynamic_mesh.h>
+#include <setsuna/material_instance.h>
+#include <setsuna/geometry_manager.h>
+#include <setsuna/gl_state.h>
+#include <cstring>
+
+namespace setsuna {
+
+instance_batcher::instance_batcher(std::size_t region_size) :
+    m_stream{std::make_unique<stream_buffer>(region_size)},
+    m_bound_material{-1}, m_collapsed_draws{0} {
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &m_storage_alignment);
+}
+
+void instance_batcher::build(render_queue& queue, const lod_selection* lods) {
+	m_stream->begin_region();
+	m_bound_material = -1;
+
+	while (!build_impl(queue, lods)) {
+		// a new buffer starts with all regions free, the old one is released
+		// by the driver once the GPU is done with it
+		auto region_size = m_stream->region_size() * 2;
+		LOG_DEBUG("Growing the stream buffer of instance_batcher to %zu bytes per region", region_size);
+		m_stream = std::make_unique<stream_buffer>(region_size);
+		m_stream->begin_region();
+	}
+
+	m_collapsed_draws = static_cast<uint32_t>(queue.size() - m_batches.size());
+}
+
+bool instance_batcher::build_impl(render_queue& queue, const lod_selection* lods) {
+	m_batches.clear();
+	if (queue.empty()) return true;
+
+	// every item contributes exactly one world matrix
+	auto matrices_offset = m_stream->allocate(sizeof(glm::mat4) * queue.size(), sizeof(glm::mat4));
+	if (!matrices_offset) return false;
+
+	// regions are multiples of 256 bytes, so the index is exact
+	auto base_instance = static_cast<uint32_t>(matrices_offset.value() / sizeof(glm::mat4));
+	auto matrices = m_stream->data(matrices_offset.value());
+
+	for (std::size_t i = 0; i < queue.size(); ++i) {
+		auto& item = queue[i];
+		// dynamic meshes are neither quantized nor have levels of detail
+		auto world = item.dynamic_mesh ? *item.world_matrix : item.mesh->instance_matrix(*item.world_matrix);
+		std::memcpy(matrices + sizeof(glm::mat4) * i, &world, sizeof(glm::mat4));
+
+		uint32_t lod = 0;
+		if (lods != nullptr && !item.dynamic_mesh) {
+			lod = item.mesh->select_lod(*item.world_matrix, lods->camera_position,
+			                            lods->projection_scale, lods->max_pixels);
+		}
+
+		if (!m_batches.empty()) {
+			auto& last = m_batches.back();
+			if (last.item->mesh == item.mesh && last.item->dynamic_mesh == item.dynamic_mesh &&
+			    last.item->material == item.material && last.lod == lod) {
+				++last.count;
+				continue;
+			}
+		}
+
+		batch b{&item, base_instance + static_cast<uint32_t>(i), 1, lod, 0, 0};
+
+		if (!m_batches.empty() && m_batches.back().item->material == item.material) {
+			// share the block written for the previous batch
+			b.material_offset = m_batches.back().material_offset;
+			b.material_size = m_batches.back().material_size;
+		}
+		else if (item.material) {
+			auto size = item.material->block_size();
+			if (size > 0) {
+				auto offset = m_stream->allocate(size, m_storage_alignment);
+				if (!offset) return false;
+
+				item.material->write_block(m_stream->data(offset.value()));
+				b.material_offset = offset.value();
+				b.material_size = static_cast<GLsizeiptr>(size);
+			}
+		}
+
+		m_batches.push_back(b);
+	}
+
+	return true;
+}
+
+void instance_batcher::render(const batch& b) {
+	if (b.material_size > 0 && b.material_offset != m_bound_material) {
+		// recorded indirect draws use the previous material
+		flush();
+		gl_state::instance().bind_buffer_range(GL_SHADER_STORAGE_BUFFER, material_binding, m_stream->name(),
+		                                       b.material_offset, b.material_size);
+		m_bound_material = b.material_offset;
+	}
+
+	if (b.item->dynamic_mesh) {
+		b.item->dynamic_mesh->render_instanced(m_stream->name(), b.base_instance, b.count);
+		return;
+	}
+
+	auto mesh = b.item->mesh;
+	if (mesh->shared()) {
+		mesh->render_indirect(b.base_instance, b.count, b.lod);
+	}
+	else {
+		mesh->render_instanced(m_stream->name(), b.base_instance, b.count, b.lod);
+	}
+}
+
+void instance_batcher::flush() {
+	geometry_manager::instance().submit(m_stream->name());
+}
+
+}  // namespace setsuna
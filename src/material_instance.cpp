@@ -1,6 +1,8 @@
 #include <setsuna/rtti_prefix.h>
 #include <setsuna/material_instance.h>
 #include <setsuna/material.h>
+#include <setsuna/texture_manager.h>
+#include <cstring>
 
 namespace setsuna {
 material_instance::material_instance(const material& prototype) :
@@ -99,4 +101,27 @@ void material_instance::set_property(std::string_view name, setsuna::ref<texture
 	return;
 }
 
+std::size_t material_instance::block_size() const {
+	return sizeof(glm::vec4) * m_colors.size() +
+	       sizeof(texture_address) * m_textures.size() +
+	       sizeof(float) * m_scalars.size();
+}
+
+void material_instance::write_block(uint8_t* dst) const {
+	for (auto& c : m_colors) {
+		glm::vec4 value = c;
+		std::memcpy(dst, &value, sizeof(value));
+		dst += sizeof(value);
+	}
+
+	for (auto& tex : m_textures) {
+		auto address = tex ? tex->address()
+		                   : texture_manager::instance().default_texture()->address();
+		std::memcpy(dst, &address, sizeof(address));
+		dst += sizeof(address);
+	}
+
+	std::memcpy(dst, m_scalars.data(), sizeof(float) * m_scalars.size());
+}
+
 }  // namespace setsuna
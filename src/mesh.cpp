@@ -1,21 +1,132 @@
 #include <setsuna/rtti_prefix.h>
+#include <setsuna/geometry_manager.h>
+#include <setsuna/geometry_arena.h>
+#include <setsuna/bounds_calculator.h>
+#include <setsuna/gl_state.h>
+#include <setsuna/command_buffer.h>
+#include <setsuna/logger.h>
+#include <glm/gtc/matrix_transform.hpp>
 
 namespace setsuna {
 
 mesh::mesh() :
-    m_vertices_count{0}, m_indices_count{0} {
+    m_vao{0}, m_vertices_count{0}, m_indices_count{0}, m_index_type{GL_UNSIGNED_INT}, m_instancing{false},
+    m_arena{nullptr}, m_base_vertex{0}, m_first_index{0},
+    m_dequantization{1.0f}, m_quantized{false} {}
+
+mesh::~mesh() {
+	if (m_arena != nullptr) {
+		m_arena->release_vertices(m_base_vertex, this);
+		if (m_indices_count > 0) m_arena->release_indices(m_first_index, this);
+	}
+
+	if (m_vao != 0) {
+		gl_state::instance().on_delete_vertex_array(m_vao);
+		glDeleteVertexArrays(1, &m_vao);
+	}
+}
+
+setsuna::ref<mesh> mesh::create_interleaved(const vertex_layout& layout,
+                                            const void* vertices,
+                                            uint32_t vertices_count) {
+	auto new_mesh = new mesh();
+	new_mesh->create_vertex_array();
+	new_mesh->m_vertex_buffer.create(static_cast<const uint8_t*>(vertices),
+	                                 std::size_t(layout.stride) * vertices_count);
+	layout.apply(new_mesh->m_vao, new_mesh->m_vertex_buffer.name());
+	new_mesh->m_vertices_count = vertices_count;
+	return new_mesh;
+}
+
+void mesh::create_vertex_array() {
 	glCreateVertexArrays(1, &m_vao);
+
+	// per-instance world matrix, one column per location, all sourced from one binding
+	for (uint32_t col = 0; col < 4; ++col) {
+		glVertexArrayAttribFormat(m_vao, instance_attribindex + col,
+		                          4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * col);
+		glVertexArrayAttribBinding(m_vao, instance_attribindex + col, instance_attribindex);
+	}
+	glVertexArrayBindingDivisor(m_vao, instance_attribindex, 1);
 }
 
-mesh::~mesh() {
-	glDeleteVertexArrays(1, &m_vao);
+void mesh::allocate_shared(const vertex_layout& layout,
+                           const std::vector<uint8_t>& data,
+                           const std::vector<uint32_t>& indices) {
+	auto indices_count = static_cast<uint32_t>(indices.size());
+	m_arena = geometry_manager::instance().allocate(layout, m_vertices_count, indices_count,
+	                                                this, m_base_vertex, m_first_index);
+	if (m_arena != nullptr) {
+		m_arena->write_vertices(m_base_vertex, data);
+		m_arena->write_indices(m_first_index, indices);
+		m_indices_count = indices_count;
+		return;
+	}
+
+	// fall back to private buffers
+	create_vertex_array();
+	m_vertex_buffer.create(data);
+	layout.apply(m_vao, m_vertex_buffer.name());
+	if (!indices.empty()) set_indices(indices);
+}
+
+void mesh::reallocate_shared(const std::vector<uint32_t>& indices) {
+	auto old_arena = m_arena;
+	auto old_base_vertex = m_base_vertex;
+	auto layout = old_arena->layout();
+	auto old_offset = GLintptr(old_base_vertex) * layout.stride;
+	auto vertices_size = GLsizeiptr(layout.stride) * m_vertices_count;
+	auto indices_count = static_cast<uint32_t>(indices.size());
+
+	// the old arena is never picked, since its free indices are too few even if compacted
+	GLint base_vertex;
+	uint32_t first_index;
+	auto arena = geometry_manager::instance().allocate(layout, m_vertices_count, indices_count,
+	                                                   this, base_vertex, first_index);
+	if (arena != nullptr) {
+		glCopyNamedBufferSubData(old_arena->vertex_buffer(), arena->vertex_buffer(),
+		                         old_offset, GLintptr(base_vertex) * layout.stride, vertices_size);
+		arena->write_indices(first_index, indices);
+		old_arena->release_vertices(old_base_vertex, this);
+
+		m_arena = arena;
+		m_base_vertex = base_vertex;
+		m_first_index = first_index;
+		m_indices_count = indices_count;
+		return;
+	}
+
+	// too big for any arena, fall back to private buffers
+	create_vertex_array();
+	m_vertex_buffer.create_copy(old_arena->vertex_buffer(), old_offset, vertices_size);
+	layout.apply(m_vao, m_vertex_buffer.name());
+	old_arena->release_vertices(old_base_vertex, this);
+
+	m_arena = nullptr;
+	m_base_vertex = 0;
+	m_first_index = 0;
+	set_indices(indices);
 }
 
 void mesh::render() {
-	glBindVertexArray(m_vao);
+	if (m_arena != nullptr) {
+		gl_state::instance().bind_vertex_array(m_arena->vertex_array());
+
+		if (m_indices_count > 0) {
+			glDrawElementsBaseVertex(GL_TRIANGLES, m_indices_count, GL_UNSIGNED_INT,
+			                         reinterpret_cast<void*>(sizeof(uint32_t) * m_first_index),
+			                         m_base_vertex);
+		}
+		else {
+			glDrawArrays(GL_TRIANGLES, m_base_vertex, m_vertices_count);
+		}
+		return;
+	}
+
+	gl_state::instance().bind_vertex_array(m_vao);
 
 	if (m_indices_count > 0) {
-		glDrawElements(GL_TRIANGLES, m_indices_count, GL_UNSIGNED_INT, 0);
+		glDrawElements(GL_TRIANGLES, m_indices_count, m_index_type, 0);
 	}
 	else {
 		glDrawArrays(GL_TRIANGLES, 0, m_vertices_count);
@@ -24,9 +135,191 @@ void mesh::render() {
 	// unbind in case that we delete these buffers later ?
 }
 
-void mesh::set_indices(const std::vector<uint32_t>& indices) {
+static std::size_t index_size(GLenum type) {
+	switch (type) {
+	case GL_UNSIGNED_BYTE:
+		return sizeof(uint8_t);
+	case GL_UNSIGNED_SHORT:
+		return sizeof(uint16_t);
+	default:
+		return sizeof(uint32_t);
+	}
+}
+
+GLuint mesh::bind_instance_buffer(GLuint instance_buffer) {
+	if (m_arena != nullptr) {
+		m_arena->bind_instance_buffer(instance_buffer);
+		return m_arena->vertex_array();
+	}
+
+	if (!m_instancing) {
+		// enable lazily so that plain meshes never read from an unbound buffer
+		for (uint32_t col = 0; col < 4; ++col) {
+			glEnableVertexArrayAttrib(m_vao, instance_attribindex + col);
+		}
+		m_instancing = true;
+	}
+	glVertexArrayVertexBuffer(m_vao, instance_attribindex, instance_buffer, 0, sizeof(glm::mat4));
+	return m_vao;
+}
+
+index_range mesh::lod_indices(uint32_t lod) const {
+	return lod < m_lods.size() ? m_lods[lod].range : index_range{0, m_indices_count};
+}
+
+void mesh::render_instanced(GLuint instance_buffer, GLuint base_instance, GLsizei count, uint32_t lod) {
+	gl_state::instance().bind_vertex_array(bind_instance_buffer(instance_buffer));
+
+	auto range = lod_indices(lod);
+	if (m_arena != nullptr) {
+		if (m_indices_count > 0) {
+			glDrawElementsInstancedBaseVertexBaseInstance(
+			  GL_TRIANGLES, range.count, GL_UNSIGNED_INT,
+			  reinterpret_cast<void*>(sizeof(uint32_t) * (m_first_index + range.first_index)),
+			  count, m_base_vertex, base_instance);
+		}
+		else {
+			glDrawArraysInstancedBaseInstance(GL_TRIANGLES, m_base_vertex, m_vertices_count,
+			                                  count, base_instance);
+		}
+		return;
+	}
+
+	if (m_indices_count > 0) {
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, range.count, m_index_type,
+		                                    reinterpret_cast<void*>(index_size(m_index_type) * range.first_index),
+		                                    count, base_instance);
+	}
+	else {
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, m_vertices_count, count, base_instance);
+	}
+}
+
+void mesh::render_indirect(GLuint base_instance, GLuint count, uint32_t lod) {
+	if (m_arena == nullptr) return;
+
+	if (m_indices_count > 0) {
+		auto range = lod_indices(lod);
+		m_arena->draw(draw_elements_indirect_command{
+		  range.count, count, m_first_index + range.first_index, m_base_vertex, base_instance});
+	}
+	else {
+		m_arena->draw(draw_arrays_indirect_command{
+		  m_vertices_count, count, static_cast<GLuint>(m_base_vertex), base_instance});
+	}
+}
+
+void mesh::render_ranges(const std::vector<index_range>& ranges, GLuint instance_buffer, GLuint base_instance) {
+	if (m_indices_count == 0 || ranges.empty()) return;
+
+	auto type = m_arena != nullptr ? GL_UNSIGNED_INT : m_index_type;
+	auto first_index = m_arena != nullptr ? m_first_index : 0;
+	gl_state::instance().bind_vertex_array(bind_instance_buffer(instance_buffer));
+
+	// adjacent ranges are merged by the callers, so the draws are few
+	for (auto& range : ranges) {
+		auto offset = index_size(type) * (first_index + range.first_index);
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, static_cast<GLsizei>(range.count), type,
+		                                              reinterpret_cast<const void*>(offset),
+		                                              1, m_base_vertex, base_instance);
+	}
+}
+
+void mesh::record(command_buffer& cmds) const {
+	if (m_arena != nullptr) {
+		cmds.bind_vertex_array(m_arena->vertex_array());
+		if (m_indices_count > 0) {
+			cmds.draw_elements(m_indices_count, GL_UNSIGNED_INT,
+			                   sizeof(uint32_t) * m_first_index, m_base_vertex);
+		}
+		else {
+			cmds.draw_arrays(m_base_vertex, m_vertices_count);
+		}
+		return;
+	}
+
+	cmds.bind_vertex_array(m_vao);
+	if (m_indices_count > 0) {
+		cmds.draw_elements(m_indices_count, m_index_type, 0);
+	}
+	else {
+		cmds.draw_arrays(0, m_vertices_count);
+	}
+}
+
+void mesh::optimize_indices(std::vector<uint32_t>& indices,
+                            std::size_t vertices_count,
+                            const std::vector<glm::vec3>* positions,
+                            mesh_optimization opt) {
+	if (!(opt & (mesh_optimization::MO_VERTEX_CACHE | mesh_optimization::MO_OVERDRAW))) return;
+
+	auto before = mesh_optimizer::analyze_vertex_cache(indices, vertices_count);
+	indices = mesh_optimizer::optimize_vertex_cache(indices, vertices_count);
+	if ((opt & mesh_optimization::MO_OVERDRAW) && positions != nullptr) {
+		indices = mesh_optimizer::optimize_overdraw(indices, *positions);
+	}
+	auto after = mesh_optimizer::analyze_vertex_cache(indices, vertices_count);
+
+	LOG_DEBUG("Vertex cache of %u triangles: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+	          static_cast<uint32_t>(indices.size() / 3), before.acmr, after.acmr, before.atvr, after.atvr);
+}
+
+template<typename T>
+static std::vector<T> narrow_indices(const std::vector<uint32_t>& indices) {
+	std::vector<T> result(indices.size());
+	std::transform(indices.begin(), indices.end(), result.begin(),
+	               [](uint32_t index) { return static_cast<T>(index); });
+	return result;
+}
+
+void mesh::set_indices(const std::vector<uint32_t>& indices, mesh_optimization opt) {
+	m_meshlets.clear();
+	m_lods.clear();
+
+	if (opt & mesh_optimization::MO_VERTEX_CACHE) {
+		auto optimized = indices;
+		optimize_indices(optimized, m_vertices_count, nullptr, mesh_optimization::MO_VERTEX_CACHE);
+		set_indices(optimized);
+		return;
+	}
+
+	if (m_arena != nullptr) {
+		if (m_indices_count > 0) m_arena->release_indices(m_first_index, this);
+		m_indices_count = 0;
+		if (indices.empty()) return;
+
+		auto count = static_cast<uint32_t>(indices.size());
+		auto first_index = m_arena->allocate_indices(count, this);
+		if (!first_index && count <= m_arena->indices().capacity() - m_arena->indices().used()) {
+			// also patches the base vertex of this mesh
+			m_arena->compact();
+			first_index = m_arena->allocate_indices(count, this);
+		}
+		if (!first_index) {
+			reallocate_shared(indices);
+			return;
+		}
+
+		m_first_index = first_index.value();
+		m_arena->write_indices(m_first_index, indices);
+		m_indices_count = count;
+		return;
+	}
+
+	// the narrowest type that could address every vertex
 	buffer<buffer_usage::BU_STATIC> new_index_buffer;
-	new_index_buffer.create(indices);
+	if (m_vertices_count <= 0x100) {
+		new_index_buffer.create(narrow_indices<uint8_t>(indices));
+		m_index_type = GL_UNSIGNED_BYTE;
+	}
+	else if (m_vertices_count <= 0x10000) {
+		new_index_buffer.create(narrow_indices<uint16_t>(indices));
+		m_index_type = GL_UNSIGNED_SHORT;
+	}
+	else {
+		new_index_buffer.create(indices);
+		m_index_type = GL_UNSIGNED_INT;
+	}
 	m_index_buffer = std::move(new_index_buffer);
 	if (m_index_buffer.empty()) {
 		glVertexArrayElementBuffer(m_vao, 0);
@@ -38,11 +331,92 @@ void mesh::set_indices(const std::vector<uint32_t>& indices) {
 	}
 }
 
-void mesh::calculate_bounding_box(const std::vector<glm::vec3>& vertices) {
-	m_aabb.reset();
-	for (auto& v : vertices) {
-		m_aabb.expand(v);
+void mesh::set_indices(const void* indices, uint32_t count, GLenum type) {
+	if (m_arena != nullptr) {
+		std::vector<uint32_t> widened(count);
+		if (type == GL_UNSIGNED_BYTE) {
+			auto src = static_cast<const uint8_t*>(indices);
+			std::copy(src, src + count, widened.begin());
+		}
+		else if (type == GL_UNSIGNED_SHORT) {
+			auto src = static_cast<const uint16_t*>(indices);
+			std::copy(src, src + count, widened.begin());
+		}
+		else {
+			auto src = static_cast<const uint32_t*>(indices);
+			std::copy(src, src + count, widened.begin());
+		}
+		set_indices(widened);
+		return;
 	}
+
+	m_meshlets.clear();
+	m_lods.clear();
+
+	buffer<buffer_usage::BU_STATIC> new_index_buffer;
+	new_index_buffer.create(static_cast<const uint8_t*>(indices), index_size(type) * count);
+	m_index_buffer = std::move(new_index_buffer);
+	m_index_type = type;
+	m_indices_count = m_index_buffer.empty() ? 0 : count;
+	glVertexArrayElementBuffer(m_vao, m_index_buffer.name());
+}
+
+void mesh::set_lods(const std::vector<mesh_lod>& lods, mesh_optimization opt) {
+	std::vector<uint32_t> indices;
+	std::vector<lod_range> ranges;
+	for (auto& lod : lods) {
+		ranges.push_back(lod_range{
+		  index_range{static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod.indices.size())},
+		  lod.error});
+
+		if (opt & mesh_optimization::MO_VERTEX_CACHE) {
+			auto optimized = lod.indices;
+			optimize_indices(optimized, m_vertices_count, nullptr, mesh_optimization::MO_VERTEX_CACHE);
+			indices.insert(indices.end(), optimized.begin(), optimized.end());
+		}
+		else {
+			indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+		}
+	}
+
+	set_indices(indices);
+	if (m_indices_count == 0 || ranges.empty()) return;
+
+	// plain draws only cover level 0
+	m_indices_count = ranges.front().range.count;
+	m_lods = std::move(ranges);
+}
+
+uint32_t mesh::select_lod(const glm::mat4& world,
+                          const glm::vec3& camera_position,
+                          float projection_scale,
+                          float max_pixels) const {
+	if (m_lods.empty()) return 0;
+
+	auto bounds = m_bounding_sphere.transformed(world);
+	auto distance = std::max(glm::length(bounds.center - camera_position) - bounds.radius,
+	                         std::numeric_limits<float>::epsilon());
+	// errors scale like the radius
+	auto scale = m_bounding_sphere.radius > 0.0f ? bounds.radius / m_bounding_sphere.radius : 1.0f;
+
+	for (auto level = static_cast<uint32_t>(m_lods.size()); level-- > 1;) {
+		if (m_lods[level].error * scale * projection_scale / distance <= max_pixels) return level;
+	}
+	return 0;
+}
+
+void mesh::calculate_bounding_box(const std::vector<glm::vec3>& vertices, thread_pool* pool) {
+	bounds_calculator::calculate(vertices, m_aabb, m_bounding_sphere, pool);
+}
+
+void mesh::set_bounds(const aabb<3>& box, const sphere& bounding_sphere) {
+	m_aabb = box;
+	m_bounding_sphere = bounding_sphere;
+}
+
+void mesh::set_dequantization(const glm::vec3& offset, float scale) {
+	m_dequantization = glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(scale));
+	m_quantized = true;
 }
 
 }  // namespace setsuna
@@ -0,0 +1,307 @@
+#include <setsuna/mesh_optimizer.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace setsuna {
+
+/*
+FIFO cache simulation shared by the analysis and the overdraw clustering.
+Timestamps avoid shifting entries: a vertex is cached if it was inserted
+less than cache_size insertions ago.
+*/
+class fifo_cache {
+
+public:
+	fifo_cache(std::size_t vertices_count, uint32_t cache_size) :
+	    m_timestamps(vertices_count, 0), m_time{cache_size + 1}, m_size{cache_size} {}
+
+	// return true on a miss
+	bool access(uint32_t vertex) {
+		if (m_time - m_timestamps[vertex] > m_size) {
+			m_timestamps[vertex] = m_time++;
+			return true;
+		}
+		return false;
+	}
+
+	void reset() { m_time += m_size + 1; }
+
+private:
+	std::vector<uint32_t> m_timestamps;
+	uint32_t m_time;
+	uint32_t m_size;
+};
+
+vertex_cache_statistics mesh_optimizer::analyze_vertex_cache(const std::vector<uint32_t>& indices,
+                                                             std::size_t vertices_count,
+                                                             uint32_t cache_size) {
+	if (indices.size() < 3 || vertices_count == 0) return vertex_cache_statistics{0.0f, 0.0f};
+
+	fifo_cache cache(vertices_count, cache_size);
+	std::vector<bool> referenced(vertices_count, false);
+	std::size_t misses = 0, unique = 0;
+	for (auto index : indices) {
+		misses += cache.access(index) ? 1 : 0;
+		if (!referenced[index]) {
+			referenced[index] = true;
+			++unique;
+		}
+	}
+
+	return vertex_cache_statistics{
+	  float(misses) / float(indices.size() / 3),
+	  float(misses) / float(unique)};
+}
+
+/*
+Forsyth, "Linear-Speed Vertex Cache Optimisation". Every vertex is scored by
+its position in a simulated LRU cache and by the number of triangles still
+using it, a triangle scores the sum of its vertices. The best triangle among
+those touching the cache is emitted greedily.
+*/
+namespace {
+
+constexpr uint32_t MAX_CACHE_SIZE = 32;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+float vertex_score(int32_t cache_position, uint32_t remaining) {
+	if (remaining == 0) return -1.0f;
+
+	auto score = 0.0f;
+	if (cache_position >= 0) {
+		if (cache_position < 3) {
+			// the vertices of the last triangle are penalized to avoid strips
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else {
+			auto scaler = 1.0f / (MAX_CACHE_SIZE - 3);
+			score = std::pow(1.0f - (cache_position - 3) * scaler, CACHE_DECAY_POWER);
+		}
+	}
+
+	// prefer vertices with few triangles left, so that they leave the working set
+	return score + VALENCE_BOOST_SCALE * std::pow(float(remaining), -VALENCE_BOOST_POWER);
+}
+
+}  // namespace
+
+std::vector<uint32_t> mesh_optimizer::optimize_vertex_cache(const std::vector<uint32_t>& indices,
+                                                            std::size_t vertices_count) {
+	auto triangles_count = indices.size() / 3;
+	if (triangles_count == 0) return indices;
+
+	// triangles adjacent to every vertex, in compressed rows
+	std::vector<uint32_t> remaining(vertices_count, 0);
+	for (std::size_t i = 0; i < triangles_count * 3; ++i) {
+		++remaining[indices[i]];
+	}
+	std::vector<uint32_t> offsets(vertices_count + 1, 0);
+	std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+	std::vector<uint32_t> adjacency(offsets.back());
+	{
+		auto fill = offsets;
+		for (std::size_t i = 0; i < triangles_count * 3; ++i) {
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<int32_t> cache_position(vertices_count, -1);
+	std::vector<float> score(vertices_count);
+	for (std::size_t v = 0; v < vertices_count; ++v) {
+		score[v] = vertex_score(-1, remaining[v]);
+	}
+
+	std::vector<float> triangle_score(triangles_count);
+	std::vector<bool> emitted(triangles_count, false);
+	for (std::size_t t = 0; t < triangles_count; ++t) {
+		triangle_score[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(triangles_count * 3);
+
+	// cache entries with room for the 3 vertices pushed in by a triangle
+	std::vector<uint32_t> cache, next_cache;
+	cache.reserve(MAX_CACHE_SIZE + 3);
+	next_cache.reserve(MAX_CACHE_SIZE + 3);
+
+	auto best = std::max_element(triangle_score.begin(), triangle_score.end()) - triangle_score.begin();
+	std::size_t cursor = 0;
+
+	for (std::size_t emitted_count = 0; emitted_count < triangles_count; ++emitted_count) {
+		if (best < 0) {
+			// the cache has nothing to offer, pick the next triangle in input order
+			while (emitted[cursor]) ++cursor;
+			best = cursor;
+		}
+
+		auto tri = &indices[best * 3];
+		result.insert(result.end(), tri, tri + 3);
+		emitted[best] = true;
+
+		// remove the triangle from the adjacency of its vertices
+		for (uint32_t k = 0; k < 3; ++k) {
+			auto v = tri[k];
+			auto begin = adjacency.begin() + offsets[v];
+			auto end = begin + remaining[v];
+			std::iter_swap(std::find(begin, end, uint32_t(best)), end - 1);
+			--remaining[v];
+		}
+
+		// move the vertices of the triangle to the front of the cache
+		next_cache.assign(tri, tri + 3);
+		for (auto v : cache) {
+			if (v != tri[0] && v != tri[1] && v != tri[2]) next_cache.push_back(v);
+		}
+		for (std::size_t i = MAX_CACHE_SIZE; i < next_cache.size(); ++i) {
+			cache_position[next_cache[i]] = -1;
+			score[next_cache[i]] = vertex_score(-1, remaining[next_cache[i]]);
+		}
+		next_cache.resize(std::min<std::size_t>(next_cache.size(), MAX_CACHE_SIZE));
+		cache.swap(next_cache);
+
+		for (std::size_t i = 0; i < cache.size(); ++i) {
+			cache_position[cache[i]] = static_cast<int32_t>(i);
+			score[cache[i]] = vertex_score(static_cast<int32_t>(i), remaining[cache[i]]);
+		}
+
+		// rescore the triangles touching the cache and find the best one
+		best = -1;
+		auto best_score = -1.0f;
+		for (auto v : cache) {
+			for (uint32_t j = offsets[v]; j < offsets[v] + remaining[v]; ++j) {
+				auto t = adjacency[j];
+				auto s = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+				triangle_score[t] = s;
+				if (s > best_score) {
+					best_score = s;
+					best = t;
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+std::vector<uint32_t> mesh_optimizer::optimize_overdraw(const std::vector<uint32_t>& indices,
+                                                        const std::vector<glm::vec3>& positions,
+                                                        float threshold) {
+	constexpr uint32_t CACHE_SIZE = 16;
+
+	auto triangles_count = indices.size() / 3;
+	if (triangles_count < 2) return indices;
+
+	auto misses_of = [&indices](fifo_cache& cache, std::size_t t) {
+		return (cache.access(indices[t * 3]) ? 1 : 0) +
+		       (cache.access(indices[t * 3 + 1]) ? 1 : 0) +
+		       (cache.access(indices[t * 3 + 2]) ? 1 : 0);
+	};
+
+	// hard boundaries, where all vertices of a triangle miss and the cache is cold anyway
+	std::vector<std::size_t> hard{0};
+	{
+		fifo_cache cache(positions.size(), CACHE_SIZE);
+		for (std::size_t t = 0; t < triangles_count; ++t) {
+			if (misses_of(cache, t) == 3 && t > 0) hard.push_back(t);
+		}
+		hard.push_back(triangles_count);
+	}
+
+	// soft boundaries, where the cache efficiency of the cluster so far is good enough
+	std::vector<std::size_t> clusters;
+	fifo_cache cache(positions.size(), CACHE_SIZE);
+	for (std::size_t h = 0; h + 1 < hard.size(); ++h) {
+		auto start = hard[h], end = hard[h + 1];
+
+		std::size_t misses = 0;
+		cache.reset();
+		for (auto t = start; t < end; ++t) {
+			misses += misses_of(cache, t);
+		}
+		auto cluster_acmr = float(misses) / float(end - start);
+
+		auto pos = start;
+		while (pos < end) {
+			clusters.push_back(pos);
+
+			misses = 0;
+			cache.reset();
+			auto next = end;
+			for (auto t = pos; t < end; ++t) {
+				misses += misses_of(cache, t);
+				if (t + 1 < end && float(misses) / float(t - pos + 1) <= threshold * cluster_acmr) {
+					next = t + 1;
+					break;
+				}
+			}
+			pos = next;
+		}
+	}
+	clusters.push_back(triangles_count);
+
+	// area weighted centroid and normal of the mesh and of every cluster
+	struct cluster_info {
+		glm::vec3 centroid;
+		glm::vec3 normal;
+		float area;
+	};
+	auto accumulate = [&](std::size_t begin, std::size_t end) {
+		cluster_info info{glm::vec3(0.0f), glm::vec3(0.0f), 0.0f};
+		for (auto t = begin; t < end; ++t) {
+			auto& p0 = positions[indices[t * 3]];
+			auto& p1 = positions[indices[t * 3 + 1]];
+			auto& p2 = positions[indices[t * 3 + 2]];
+			auto n = glm::cross(p1 - p0, p2 - p0);
+			auto area = glm::length(n);
+			info.centroid += (p0 + p1 + p2) * (area / 3.0f);
+			info.normal += n;
+			info.area += area;
+		}
+		if (info.area > 0.0f) info.centroid /= info.area;
+		auto len = glm::length(info.normal);
+		if (len > 0.0f) info.normal /= len;
+		return info;
+	};
+
+	auto mesh_centroid = accumulate(0, triangles_count).centroid;
+
+	auto clusters_count = clusters.size() - 1;
+	std::vector<float> keys(clusters_count);
+	for (std::size_t c = 0; c < clusters_count; ++c) {
+		auto info = accumulate(clusters[c], clusters[c + 1]);
+		keys[c] = glm::dot(info.centroid - mesh_centroid, info.normal);
+	}
+
+	// clusters facing away from the center are likely to occlude the others, draw them first
+	std::vector<std::size_t> order(clusters_count);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(),
+	                 [&keys](std::size_t lhs, std::size_t rhs) { return keys[lhs] > keys[rhs]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(triangles_count * 3);
+	for (auto c : order) {
+		result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+	return result;
+}
+
+std::vector<uint32_t> mesh_optimizer::optimize_vertex_fetch(std::vector<uint32_t>& indices,
+                                                            std::size_t vertices_count,
+                                                            std::size_t& unique_count) {
+	std::vector<uint32_t> remap(vertices_count, unused);
+	uint32_t next = 0;
+	for (auto& index : indices) {
+		if (remap[index] == unused) remap[index] = next++;
+		index = remap[index];
+	}
+	unique_count = next;
+	return remap;
+}
+
+}  // namespace setsuna
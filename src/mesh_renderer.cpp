@@ -13,16 +13,10 @@ void mesh_renderer::update() {
 	}
 
 	auto& world_matrix = m_object->world_matrix();
-	auto corners = filter->mesh->bounding_box().corners();
 
 	// update world space bounding box and bounding sphere
-	m_aabb.reset();
-	for (auto& corner : corners) {
-		corner = glm::vec3(world_matrix * glm::vec4(corner, 1.0));
-		m_aabb.expand(corner);
-	}
-	m_bounding_sphere.center = m_aabb.center();
-	m_bounding_sphere.radius = glm::length(m_aabb.extent());
+	m_aabb = filter->mesh->bounding_box().transformed(world_matrix);
+	m_bounding_sphere = filter->mesh->bounding_sphere().transformed(world_matrix);
 }
 
 }  // namespace setsuna
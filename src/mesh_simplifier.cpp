@@ -0,0 +1,294 @@
+#include <setsuna/mesh_simplifier.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace setsuna {
+
+static constexpr auto no_vertex = std::numeric_limits<uint32_t>::max();
+
+/*
+Symmetric 4x4 matrix of the sum of squared distances to a set of planes,
+weighted by the areas of the triangles that contributed them.
+*/
+struct quadric {
+	double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+	double weight;
+};
+
+static void add_plane(quadric& q, const glm::vec3& n, float d, double weight) {
+	double a = n.x, b = n.y, c = n.z, dd = d;
+	q.a2 += a * a * weight;
+	q.b2 += b * b * weight;
+	q.c2 += c * c * weight;
+	q.ab += a * b * weight;
+	q.ac += a * c * weight;
+	q.bc += b * c * weight;
+	q.ad += a * dd * weight;
+	q.bd += b * dd * weight;
+	q.cd += c * dd * weight;
+	q.d2 += dd * dd * weight;
+	q.weight += weight;
+}
+
+static void add_quadric(quadric& q, const quadric& r) {
+	q.a2 += r.a2;
+	q.b2 += r.b2;
+	q.c2 += r.c2;
+	q.ab += r.ab;
+	q.ac += r.ac;
+	q.bc += r.bc;
+	q.ad += r.ad;
+	q.bd += r.bd;
+	q.cd += r.cd;
+	q.d2 += r.d2;
+	q.weight += r.weight;
+}
+
+// weighted mean of the squared distances from p to the planes of q and r
+static float collapse_error_sq(const quadric& q, const quadric& r, const glm::vec3& p) {
+	double x = p.x, y = p.y, z = p.z;
+	auto eval = [x, y, z](const quadric& m) {
+		return m.a2 * x * x + m.b2 * y * y + m.c2 * z * z +
+		       2.0 * (m.ab * x * y + m.ac * x * z + m.bc * y * z) +
+		       2.0 * (m.ad * x + m.bd * y + m.cd * z) + m.d2;
+	};
+	auto weight = q.weight + r.weight;
+	if (weight <= 0.0) return 0.0f;
+	return static_cast<float>(std::max(0.0, (eval(q) + eval(r)) / weight));
+}
+
+namespace {
+
+struct position_hash {
+	std::size_t operator()(const glm::vec3& p) const {
+		uint32_t bits[3];
+		std::memcpy(bits, &p, sizeof(bits));
+		return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+	}
+};
+
+struct position_equal {
+	bool operator()(const glm::vec3& a, const glm::vec3& b) const {
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+};
+
+struct collapse {
+	uint32_t source;
+	uint32_t target;
+	float error_sq;
+};
+
+}  // namespace
+
+std::vector<uint32_t> mesh_simplifier::simplify(const std::vector<uint32_t>& indices,
+                                                const std::vector<glm::vec3>& positions,
+                                                std::size_t target_indices_count,
+                                                float target_error,
+                                                float* result_error) {
+	std::vector<uint32_t> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+	auto error_sq = 0.0f;
+	auto target_error_sq = target_error * target_error;
+
+	// topology is built on welded positions, so that attribute seams are not taken as borders
+	std::vector<uint32_t> welded(positions.size());
+	std::vector<uint32_t> welded_count(positions.size(), 0);
+	{
+		std::unordered_map<glm::vec3, uint32_t, position_hash, position_equal> first;
+		first.reserve(positions.size());
+		for (uint32_t v = 0; v < positions.size(); ++v) {
+			welded[v] = first.emplace(positions[v], v).first->second;
+			++welded_count[welded[v]];
+		}
+	}
+
+	// lock seams, open borders and non-manifold edges
+	std::vector<bool> locked(positions.size(), false);
+	{
+		std::unordered_map<uint64_t, uint32_t> edges;
+		edges.reserve(result.size());
+		for (std::size_t i = 0; i < result.size(); i += 3) {
+			for (uint32_t k = 0; k < 3; ++k) {
+				uint64_t a = welded[result[i + k]], b = welded[result[i + (k + 1) % 3]];
+				++edges[a < b ? (a << 32) | b : (b << 32) | a];
+			}
+		}
+		for (auto& [edge, count] : edges) {
+			if (count != 2) {
+				locked[edge >> 32] = true;
+				locked[edge & 0xFFFFFFFF] = true;
+			}
+		}
+		for (uint32_t v = 0; v < positions.size(); ++v) {
+			if (welded_count[welded[v]] > 1) locked[welded[v]] = true;
+		}
+	}
+
+	std::vector<quadric> quadrics(positions.size(), quadric{});
+	for (std::size_t i = 0; i < result.size(); i += 3) {
+		auto& p0 = positions[result[i]];
+		auto n = glm::cross(positions[result[i + 1]] - p0, positions[result[i + 2]] - p0);
+		auto length = glm::length(n);
+		if (length <= 0.0f) continue;
+
+		n /= length;
+		auto d = -glm::dot(n, p0);
+		for (uint32_t k = 0; k < 3; ++k) {
+			add_plane(quadrics[welded[result[i + k]]], n, d, length * 0.5);
+		}
+	}
+
+	std::vector<uint32_t> adjacency_offsets(positions.size() + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<collapse> candidates;
+	std::vector<uint32_t> collapse_target(positions.size());
+	std::vector<bool> touched(positions.size());
+	std::vector<uint32_t> stamp(positions.size(), 0);
+	uint32_t current_stamp = 0;
+
+	while (result.size() > target_indices_count) {
+		// triangles around every welded vertex
+		std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+		for (auto v : result) ++adjacency_offsets[welded[v] + 1];
+		for (std::size_t v = 0; v < positions.size(); ++v) {
+			adjacency_offsets[v + 1] += adjacency_offsets[v];
+		}
+		adjacency.resize(result.size());
+		auto fill = adjacency_offsets;
+		for (uint32_t i = 0; i < result.size(); ++i) {
+			adjacency[fill[welded[result[i]]]++] = i / 3;
+		}
+
+		candidates.clear();
+		for (std::size_t i = 0; i < result.size(); i += 3) {
+			for (uint32_t k = 0; k < 3; ++k) {
+				auto a = result[i + k], b = result[i + (k + 1) % 3];
+				auto wa = welded[a], wb = welded[b];
+				if (wa == wb) continue;
+				if (!locked[wa]) {
+					candidates.push_back(collapse{a, b, collapse_error_sq(quadrics[wa], quadrics[wb], positions[b])});
+				}
+				if (!locked[wb]) {
+					candidates.push_back(collapse{b, a, collapse_error_sq(quadrics[wb], quadrics[wa], positions[a])});
+				}
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(),
+		          [](const collapse& lhs, const collapse& rhs) { return lhs.error_sq < rhs.error_sq; });
+
+		// every collapse removes two triangles of a closed surface
+		auto collapses_limit = std::max<std::size_t>((result.size() - target_indices_count) / 6, 1);
+		std::size_t collapses_count = 0;
+		std::fill(collapse_target.begin(), collapse_target.end(), no_vertex);
+		std::fill(touched.begin(), touched.end(), false);
+
+		for (auto& c : candidates) {
+			if (collapses_count >= collapses_limit || c.error_sq > target_error_sq) break;
+
+			auto ws = welded[c.source], wt = welded[c.target];
+			if (touched[ws] || touched[wt]) continue;
+
+			// link condition, the two end points must share exactly the two opposite vertices
+			++current_stamp;
+			for (auto a = adjacency_offsets[ws]; a < adjacency_offsets[ws + 1]; ++a) {
+				for (uint32_t k = 0; k < 3; ++k) {
+					stamp[welded[result[adjacency[a] * 3 + k]]] = current_stamp;
+				}
+			}
+			uint32_t shared = 0;
+			++current_stamp;
+			for (auto a = adjacency_offsets[wt]; a < adjacency_offsets[wt + 1]; ++a) {
+				for (uint32_t k = 0; k < 3; ++k) {
+					auto w = welded[result[adjacency[a] * 3 + k]];
+					if (w != ws && w != wt && stamp[w] == current_stamp - 1) {
+						stamp[w] = current_stamp;
+						++shared;
+					}
+				}
+			}
+			if (shared != 2) continue;
+
+			// the remaining triangles around the source must not flip
+			auto flipped = false;
+			for (auto a = adjacency_offsets[ws]; a < adjacency_offsets[ws + 1] && !flipped; ++a) {
+				auto t = adjacency[a] * 3;
+				glm::vec3 p[3], q[3];
+				auto contains_target = false;
+				for (uint32_t k = 0; k < 3; ++k) {
+					auto w = welded[result[t + k]];
+					contains_target = contains_target || w == wt;
+					p[k] = positions[result[t + k]];
+					q[k] = w == ws ? positions[c.target] : p[k];
+				}
+				if (contains_target) continue;
+
+				auto n0 = glm::cross(p[1] - p[0], p[2] - p[0]);
+				auto n1 = glm::cross(q[1] - q[0], q[2] - q[0]);
+				flipped = glm::dot(n0, n1) < 0.25f * glm::length(n0) * glm::length(n1) ||
+				          glm::length(n1) <= 0.0f;
+			}
+			if (flipped) continue;
+
+			collapse_target[ws] = c.target;
+			for (auto a = adjacency_offsets[ws]; a < adjacency_offsets[ws + 1]; ++a) {
+				for (uint32_t k = 0; k < 3; ++k) {
+					touched[welded[result[adjacency[a] * 3 + k]]] = true;
+				}
+			}
+			add_quadric(quadrics[wt], quadrics[ws]);
+			error_sq = std::max(error_sq, c.error_sq);
+			++collapses_count;
+		}
+
+		if (collapses_count == 0) break;
+
+		// unlocked vertices are never split by seams, so the welded vertex is the vertex itself
+		std::size_t write = 0;
+		for (std::size_t i = 0; i < result.size(); i += 3) {
+			uint32_t tri[3];
+			for (uint32_t k = 0; k < 3; ++k) {
+				auto target = collapse_target[welded[result[i + k]]];
+				tri[k] = target == no_vertex ? result[i + k] : target;
+			}
+			if (welded[tri[0]] == welded[tri[1]] || welded[tri[1]] == welded[tri[2]] ||
+			    welded[tri[0]] == welded[tri[2]]) {
+				continue;
+			}
+			result[write++] = tri[0];
+			result[write++] = tri[1];
+			result[write++] = tri[2];
+		}
+		result.resize(write);
+	}
+
+	if (result_error != nullptr) *result_error = glm::sqrt(error_sq);
+	return result;
+}
+
+std::vector<mesh_lod> mesh_simplifier::build_lods(const std::vector<uint32_t>& indices,
+                                                  const std::vector<glm::vec3>& positions,
+                                                  uint32_t max_levels,
+                                                  float reduction,
+                                                  float max_error) {
+	std::vector<mesh_lod> lods;
+	lods.push_back(mesh_lod{indices, 0.0f});
+
+	while (lods.size() < max_levels) {
+		auto previous_count = lods.back().indices.size();
+		auto previous_error = lods.back().error;
+		if (previous_error >= max_error) break;
+
+		auto target = static_cast<std::size_t>(previous_count / 3 * reduction) * 3;
+		auto error = 0.0f;
+		auto simplified = simplify(lods.back().indices, positions, target, max_error - previous_error, &error);
+		if (simplified.empty() || simplified.size() * 10 > previous_count * 9) break;
+
+		lods.push_back(mesh_lod{std::move(simplified), previous_error + error});
+	}
+
+	return lods;
+}
+
+}  // namespace setsuna
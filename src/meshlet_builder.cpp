@@ -0,0 +1,170 @@
+#include <setsuna/meshlet_builder.h>
+#include <setsuna/bounds_calculator.h>
+#include <algorithm>
+#include <limits>
+
+namespace setsuna {
+
+static constexpr auto no_triangle = std::numeric_limits<uint32_t>::max();
+
+std::vector<meshlet> meshlet_builder::build(std::vector<uint32_t>& indices,
+                                            const std::vector<glm::vec3>& positions,
+                                            uint32_t vertices_limit,
+                                            uint32_t triangles_limit,
+                                            thread_pool* pool) {
+	std::vector<meshlet> result;
+	auto triangles_count = static_cast<uint32_t>(indices.size() / 3);
+	if (triangles_count == 0) return result;
+
+	vertices_limit = std::max(vertices_limit, 3u);
+	triangles_limit = std::max(triangles_limit, 1u);
+
+	// triangles around every vertex, in compressed rows
+	std::vector<uint32_t> adjacency_offsets(positions.size() + 1, 0);
+	for (uint32_t i = 0; i < triangles_count * 3; ++i) {
+		++adjacency_offsets[indices[i] + 1];
+	}
+	for (std::size_t v = 0; v < positions.size(); ++v) {
+		adjacency_offsets[v + 1] += adjacency_offsets[v];
+	}
+	std::vector<uint32_t> adjacency(triangles_count * 3);
+	auto fill = adjacency_offsets;
+	for (uint32_t i = 0; i < triangles_count * 3; ++i) {
+		adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	std::vector<glm::vec3> centroids(triangles_count);
+	for (uint32_t t = 0; t < triangles_count; ++t) {
+		centroids[t] = (positions[indices[t * 3]] + positions[indices[t * 3 + 1]] +
+		                positions[indices[t * 3 + 2]]) / 3.0f;
+	}
+
+	std::vector<bool> emitted(triangles_count, false);
+	// the meshlet a vertex or a candidate triangle was last added to, counted from 1
+	std::vector<uint32_t> vertex_owner(positions.size(), 0);
+	std::vector<uint32_t> candidate_owner(triangles_count, 0);
+
+	std::vector<uint32_t> output;
+	output.reserve(triangles_count * 3);
+	std::vector<uint32_t> candidates;
+	uint32_t cursor = 0;
+
+	while (true) {
+		// continue from a neighbor of the previous meshlet, or the next triangle in order
+		auto seed = no_triangle;
+		for (auto t : candidates) {
+			if (!emitted[t]) {
+				seed = t;
+				break;
+			}
+		}
+		if (seed == no_triangle) {
+			while (cursor < triangles_count && emitted[cursor]) ++cursor;
+			if (cursor == triangles_count) break;
+			seed = cursor;
+		}
+
+		auto id = static_cast<uint32_t>(result.size() + 1);
+		meshlet m{static_cast<uint32_t>(output.size()), 0, 0, sphere(), glm::vec3(0.0f), 1.0f};
+		glm::vec3 vertices_sum(0.0f);
+		candidates.clear();
+
+		auto add = [&](uint32_t t) {
+			emitted[t] = true;
+			for (uint32_t k = 0; k < 3; ++k) {
+				auto v = indices[t * 3 + k];
+				output.push_back(v);
+				if (vertex_owner[v] == id) continue;
+
+				vertex_owner[v] = id;
+				++m.vertices_count;
+				vertices_sum += positions[v];
+				for (auto a = adjacency_offsets[v]; a < adjacency_offsets[v + 1]; ++a) {
+					auto neighbor = adjacency[a];
+					if (!emitted[neighbor] && candidate_owner[neighbor] != id) {
+						candidate_owner[neighbor] = id;
+						candidates.push_back(neighbor);
+					}
+				}
+			}
+			m.indices_count += 3;
+		};
+
+		add(seed);
+		while (m.indices_count / 3 < triangles_limit) {
+			auto center = vertices_sum / static_cast<float>(m.vertices_count);
+			auto best = no_triangle;
+			uint32_t best_extra = 4;
+			auto best_dist_sq = std::numeric_limits<float>::max();
+
+			for (std::size_t c = 0; c < candidates.size();) {
+				auto t = candidates[c];
+				if (emitted[t]) {
+					candidates[c] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+				++c;
+
+				auto a = indices[t * 3], b = indices[t * 3 + 1], d = indices[t * 3 + 2];
+				uint32_t extra = (vertex_owner[a] != id) +
+				                 (vertex_owner[b] != id && b != a) +
+				                 (vertex_owner[d] != id && d != a && d != b);
+				if (m.vertices_count + extra > vertices_limit) continue;
+
+				auto offset = centroids[t] - center;
+				auto dist_sq = glm::dot(offset, offset);
+				if (extra < best_extra || (extra == best_extra && dist_sq < best_dist_sq)) {
+					best = t;
+					best_extra = extra;
+					best_dist_sq = dist_sq;
+				}
+			}
+
+			if (best == no_triangle) break;
+			add(best);
+		}
+
+		compute_cone(m, output, positions);
+		result.push_back(m);
+	}
+
+	indices.swap(output);
+	bounds_calculator::calculate(result, indices, positions, pool);
+	return result;
+}
+
+void meshlet_builder::compute_cone(meshlet& m,
+                                   const std::vector<uint32_t>& indices,
+                                   const std::vector<glm::vec3>& positions) {
+	// the cone must contain the normals of all triangles, ignoring degenerate ones
+	std::vector<glm::vec3> normals;
+	glm::vec3 axis(0.0f);
+	for (auto i = m.first_index; i < m.first_index + m.indices_count; i += 3) {
+		auto& p0 = positions[indices[i]];
+		auto n = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+		auto length = glm::length(n);
+		if (length <= 0.0f) continue;
+
+		normals.push_back(n / length);
+		axis += normals.back();
+	}
+
+	m.cone_axis = glm::vec3(0.0f);
+	m.cone_cutoff = 1.0f;
+	auto length = glm::length(axis);
+	if (length <= 0.0f) return;
+
+	m.cone_axis = axis / length;
+	auto min_dot = 1.0f;
+	for (auto& n : normals) {
+		min_dot = std::min(min_dot, glm::dot(n, m.cone_axis));
+	}
+
+	// a cone of half angle beyond 90 degrees never faces away entirely
+	if (min_dot > 0.0f) {
+		m.cone_cutoff = glm::sqrt(1.0f - min_dot * min_dot);
+	}
+}
+
+}  // namespace setsuna
@@ -0,0 +1,55 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/meshlet_culler.h>
+#include <setsuna/camera.h>
+#include <setsuna/mesh.h>
+
+namespace setsuna {
+
+meshlet_culler::meshlet_culler(const camera& cam) :
+    m_frustum(cam.frustum()), m_camera_position(glm::inverse(cam.view_matrix())[3]),
+    m_frustum_culled{0}, m_backface_culled{0} {}
+
+uint32_t meshlet_culler::cull(const mesh& m, const glm::mat4& world, std::vector<index_range>& visible) {
+	visible.clear();
+	auto& meshlets = m.meshlets();
+	if (meshlets.empty()) return 0;
+
+	glm::vec3 scales(glm::length(glm::vec3(world[0])),
+	                 glm::length(glm::vec3(world[1])),
+	                 glm::length(glm::vec3(world[2])));
+	auto max_scale = glm::max(glm::max(scales.x, scales.y), scales.z);
+	auto min_scale = glm::min(glm::min(scales.x, scales.y), scales.z);
+	auto test_cones = max_scale > 0.0f && (max_scale - min_scale) <= max_scale * 1e-3f;
+	glm::mat3 rotation(world);
+	if (test_cones) rotation /= max_scale;
+
+	uint32_t visible_count = 0;
+	for (auto& ml : meshlets) {
+		auto bounds = ml.bounds.transformed(world);
+		if (!m_frustum.intersect(bounds)) {
+			++m_frustum_culled;
+			continue;
+		}
+
+		if (test_cones && ml.cone_cutoff < 1.0f) {
+			auto axis = rotation * ml.cone_axis;
+			auto to_center = bounds.center - m_camera_position;
+			if (glm::dot(to_center, axis) >= ml.cone_cutoff * glm::length(to_center) + bounds.radius) {
+				++m_backface_culled;
+				continue;
+			}
+		}
+
+		++visible_count;
+		if (!visible.empty() && visible.back().first_index + visible.back().count == ml.first_index) {
+			visible.back().count += ml.indices_count;
+		}
+		else {
+			visible.push_back(index_range{ml.first_index, ml.indices_count});
+		}
+	}
+
+	return visible_count;
+}
+
+}  // namespace setsuna
@@ -0,0 +1,194 @@
+#include <setsuna/readback_manager.h>
+#include <setsuna/gl_state.h>
+#include <setsuna/logger.h>
+#include <algorithm>
+#include <cstring>
+
+namespace setsuna {
+
+static GLsizeiptr pixel_size(GLenum format, GLenum type) {
+	GLsizeiptr components;
+	switch (format) {
+	case GL_RED:
+	case GL_DEPTH_COMPONENT:
+	case GL_STENCIL_INDEX:
+		components = 1;
+		break;
+	case GL_RG:
+		components = 2;
+		break;
+	case GL_RGB:
+	case GL_BGR:
+		components = 3;
+		break;
+	default:
+		components = 4;
+		break;
+	}
+
+	switch (type) {
+	case GL_UNSIGNED_BYTE:
+	case GL_BYTE:
+		return components;
+	case GL_UNSIGNED_SHORT:
+	case GL_SHORT:
+	case GL_HALF_FLOAT:
+		return components * 2;
+	case GL_UNSIGNED_INT_24_8:
+		return 4;
+	default:
+		return components * 4;
+	}
+}
+
+readback_manager::readback_manager() :
+    m_next{0}, m_stalls{0}, m_option{3} {}
+
+// the context is gone by now, the buffers are deleted by release()
+readback_manager::~readback_manager() {}
+
+void readback_manager::request(GLuint framebuffer, GLenum read_buffer, GLsizei width, GLsizei height,
+                               GLenum format, GLenum type, callback_t callback) {
+	if (width <= 0 || height <= 0) return;
+
+	if (m_slots.size() != m_option.ring_size && pending() == 0) {
+		for (auto& s : m_slots) {
+			gl_state::instance().on_delete_buffer(s.pbo);
+			glDeleteBuffers(1, &s.pbo);
+		}
+		m_slots.clear();
+		m_slots.resize(std::max(m_option.ring_size, 1u), slot{0, 0, nullptr, {}, nullptr});
+		m_next = 0;
+	}
+
+	auto& s = m_slots[m_next];
+	if (s.fence != nullptr) {
+		// the ring is full, wait for the oldest readback, its callback is called by update()
+		++m_stalls;
+		take(s);
+	}
+
+	// rows are tightly packed
+	auto size = pixel_size(format, type) * width * height;
+	if (s.capacity < size) {
+		if (s.pbo != 0) {
+			gl_state::instance().on_delete_buffer(s.pbo);
+			glDeleteBuffers(1, &s.pbo);
+		}
+		glCreateBuffers(1, &s.pbo);
+		glNamedBufferStorage(s.pbo, size, nullptr, GL_MAP_READ_BIT);
+		s.capacity = size;
+	}
+
+	auto& state = gl_state::instance();
+	state.bind_framebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	// the read buffer belongs to the framebuffer, so put it back afterwards
+	GLint previous_read_buffer = GL_NONE;
+	if (read_buffer != GL_NONE) {
+		glGetIntegerv(GL_READ_BUFFER, &previous_read_buffer);
+		glNamedFramebufferReadBuffer(framebuffer, read_buffer);
+	}
+	state.bind_buffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+	state.pixel_store(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, format, type, nullptr);
+	state.bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (read_buffer != GL_NONE && static_cast<GLenum>(previous_read_buffer) != read_buffer) {
+		glNamedFramebufferReadBuffer(framebuffer, static_cast<GLenum>(previous_read_buffer));
+	}
+
+	s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	s.result.width = width;
+	s.result.height = height;
+	s.result.format = format;
+	s.result.type = type;
+	s.callback = std::move(callback);
+
+	m_next = (m_next + 1) % m_slots.size();
+}
+
+void readback_manager::update() {
+	// collect in order of request, starting from the oldest one
+	for (std::size_t i = 0; i < m_slots.size(); ++i) {
+		auto& s = m_slots[(m_next + i) % m_slots.size()];
+		if (s.fence == nullptr) continue;
+
+		auto status = glClientWaitSync(s.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+		take(s);
+	}
+	deliver_ready();
+}
+
+void readback_manager::flush() {
+	for (std::size_t i = 0; i < m_slots.size(); ++i) {
+		auto& s = m_slots[(m_next + i) % m_slots.size()];
+		if (s.fence != nullptr) take(s);
+	}
+	deliver_ready();
+}
+
+void readback_manager::release() {
+	for (auto& s : m_slots) {
+		if (s.fence != nullptr) glDeleteSync(s.fence);
+		gl_state::instance().on_delete_buffer(s.pbo);
+		glDeleteBuffers(1, &s.pbo);
+	}
+	m_slots.clear();
+	m_ready.clear();
+	m_next = 0;
+}
+
+uint32_t readback_manager::pending() const {
+	uint32_t count = 0;
+	for (auto& s : m_slots) {
+		if (s.fence != nullptr) ++count;
+	}
+	return count;
+}
+
+void readback_manager::take(slot& s) {
+	// flush so that the fence is guaranteed to signal eventually
+	auto status = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(-1));
+	glDeleteSync(s.fence);
+	s.fence = nullptr;
+	if (status == GL_WAIT_FAILED) {
+		LOG_ERROR("Wait for the readback failed");
+		s.callback = nullptr;
+		return;
+	}
+
+	auto size = pixel_size(s.result.format, s.result.type) * s.result.width * s.result.height;
+	auto data = glMapNamedBufferRange(s.pbo, 0, size, GL_MAP_READ_BIT);
+	if (data == nullptr) {
+		LOG_ERROR("Map the readback buffer failed");
+		s.callback = nullptr;
+		return;
+	}
+	s.result.pixels.resize(size);
+	std::memcpy(s.result.pixels.data(), data, size);
+	glUnmapNamedBuffer(s.pbo);
+
+	m_ready.push_back(delivery{std::move(s.result), std::move(s.callback)});
+	s.callback = nullptr;
+}
+
+void readback_manager::deliver_ready() {
+	// requests made by the callbacks queue their stalls for the next call
+	auto ready = std::move(m_ready);
+	m_ready.clear();
+	for (auto& d : ready) {
+		if (d.callback) d.callback(d.result);
+	}
+
+	// keep the storage for the next readbacks
+	for (auto& d : ready) {
+		for (auto& s : m_slots) {
+			if (s.fence == nullptr && s.result.pixels.capacity() == 0) {
+				s.result.pixels = std::move(d.result.pixels);
+				break;
+			}
+		}
+	}
+}
+
+}  // namespace setsuna
@@ -0,0 +1,41 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/render_system.h>
+#include <setsuna/logger.h>
+
+namespace setsuna {
+
+render_pass_builder::render_pass_builder(render_system& system, uint32_t pass) :
+    m_system{&system}, m_pass{pass} {}
+
+attachment_handle render_pass_builder::create(std::string_view name, const texture_description& desc) {
+	auto handle = m_system->find_or_add(name);
+	auto& node = m_system->m_attachments[handle];
+	if (node.imported || node.created) {
+		LOG_WARNING("The attachment \"%s\" is created more than once", node.name.c_str());
+	}
+	else {
+		node.description = desc;
+		node.created = true;
+	}
+	return write(name);
+}
+
+attachment_handle render_pass_builder::read(std::string_view name) {
+	auto handle = m_system->find_or_add(name);
+	m_system->m_attachments[handle].readers.push_back(m_pass);
+	m_system->m_passes[m_pass].reads.push_back(handle);
+	return handle;
+}
+
+attachment_handle render_pass_builder::write(std::string_view name) {
+	auto handle = m_system->find_or_add(name);
+	m_system->m_attachments[handle].writers.push_back(m_pass);
+	m_system->m_passes[m_pass].writes.push_back(handle);
+	return handle;
+}
+
+void render_pass_builder::set_side_effect() {
+	m_system->m_passes[m_pass].side_effect = true;
+}
+
+}  // namespace setsuna
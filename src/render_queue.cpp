@@ -0,0 +1,124 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/render_queue.h>
+#include <setsuna/mesh.h>
+#include <setsuna/dynamic_mesh.h>
+#include <setsuna/material_instance.h>
+#include <algorithm>
+#include <array>
+
+namespace setsuna {
+
+// bit widths of the sort key fields
+static constexpr uint32_t PASS_BITS = 2;
+static constexpr uint32_t SHADER_BITS = 12;
+static constexpr uint32_t MATERIAL_BITS = 16;
+static constexpr uint32_t MESH_BITS = 16;
+static constexpr uint32_t DEPTH_BITS = 18;
+
+static_assert(PASS_BITS + SHADER_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS == 64,
+              "Sort key fields must fill 64 bits");
+
+static constexpr uint64_t mask(uint32_t bits) {
+	return (uint64_t(1) << bits) - 1;
+}
+
+render_queue::render_queue(frame_allocator& allocator) :
+    m_items(allocator), m_keys(allocator), m_order(allocator),
+    m_keys_tmp(allocator), m_order_tmp(allocator),
+    m_view_matrix(1.0f), m_near_plane{0.0f}, m_far_plane{1.0f} {}
+
+void render_queue::begin(const camera& cam) {
+	m_items.clear();
+	m_keys.clear();
+	m_order.clear();
+
+	m_view_matrix = cam.view_matrix();
+	m_near_plane = cam.near_plane();
+	m_far_plane = cam.far_plane();
+}
+
+void render_queue::push(const render_item& item, pass p, uint32_t shader) {
+	// camera looks at the negative z-axis
+	auto view_z = -(m_view_matrix * (*item.world_matrix)[3]).z;
+	auto depth = (view_z - m_near_plane) / (m_far_plane - m_near_plane);
+
+	uint32_t mesh = 0;
+	if (item.dynamic_mesh) {
+		mesh = item.dynamic_mesh->id();
+	}
+	else if (item.mesh) {
+		mesh = item.mesh->id();
+	}
+	m_keys.push_back(make_key(p, shader, item.material ? item.material->id() : 0, mesh, depth));
+	m_order.push_back(static_cast<uint32_t>(m_items.size()));
+	m_items.push_back(item);
+}
+
+render_queue::key_t render_queue::make_key(pass p, uint32_t shader,
+                                           uint32_t material, uint32_t mesh, float depth) {
+	auto quantized = static_cast<uint64_t>(glm::clamp(depth, 0.0f, 1.0f) * mask(DEPTH_BITS));
+
+	// ids wider than their fields wrap around, which only affects grouping
+	key_t key = uint64_t(p) & mask(PASS_BITS);
+	if (p == pass::RP_TRANSPARENT) {
+		key = (key << DEPTH_BITS) | (mask(DEPTH_BITS) - quantized);
+		key = (key << SHADER_BITS) | (shader & mask(SHADER_BITS));
+		key = (key << MATERIAL_BITS) | (material & mask(MATERIAL_BITS));
+		key = (key << MESH_BITS) | (mesh & mask(MESH_BITS));
+	}
+	else {
+		key = (key << SHADER_BITS) | (shader & mask(SHADER_BITS));
+		key = (key << MATERIAL_BITS) | (material & mask(MATERIAL_BITS));
+		key = (key << MESH_BITS) | (mesh & mask(MESH_BITS));
+		key = (key << DEPTH_BITS) | quantized;
+	}
+	return key;
+}
+
+void render_queue::sort() {
+	constexpr uint32_t RADIX_BITS = 8;
+	constexpr uint32_t RADIX = 1 << RADIX_BITS;
+	constexpr uint32_t PASSES = sizeof(key_t) * 8 / RADIX_BITS;
+
+	auto count = m_keys.size();
+	if (count < 2) return;
+
+	// build histograms of all digits in one sweep
+	std::array<std::array<uint32_t, RADIX>, PASSES> histograms{};
+	for (auto key : m_keys) {
+		for (uint32_t pass = 0; pass < PASSES; ++pass) {
+			++histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX - 1)];
+		}
+	}
+
+	m_keys_tmp.resize(count);
+	m_order_tmp.resize(count);
+
+	for (uint32_t pass = 0; pass < PASSES; ++pass) {
+		auto& histogram = histograms[pass];
+		auto shift = pass * RADIX_BITS;
+
+		// skip the pass if all keys share the same digit
+		if (histogram[(m_keys[0] >> shift) & (RADIX - 1)] == count) continue;
+
+		// exclusive prefix sum gives the output offset of each bucket
+		uint32_t offset = 0;
+		for (auto& bucket : histogram) {
+			auto n = bucket;
+			bucket = offset;
+			offset += n;
+		}
+
+		for (std::size_t i = 0; i < count; ++i) {
+			auto key = m_keys[i];
+			auto dst = histogram[(key >> shift) & (RADIX - 1)]++;
+			m_keys_tmp[dst] = key;
+			m_order_tmp[dst] = m_order[i];
+		}
+
+		m_keys.swap(m_keys_tmp);
+		m_order.swap(m_order_tmp);
+	}
+}
+
+}  // namespace setsuna
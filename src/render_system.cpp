@@ -0,0 +1,278 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/render_system.h>
+#include <setsuna/texture_manager.h>
+#include <setsuna/gl_state.h>
+#include <setsuna/logger.h>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace setsuna {
+
+render_system::render_system() :
+    m_compiled{false}, m_transient_count{0}, m_texture_count{0} {}
+
+void render_system::import_attachment(std::string_view name, ref<texture> tex) {
+	m_imports[std::string(name)] = tex;
+	m_compiled = false;
+}
+
+attachment_handle render_system::find_or_add(std::string_view name) {
+	auto search = m_names.find(name);
+	if (search != m_names.end()) return search->second;
+
+	auto handle = static_cast<attachment_handle>(m_attachments.size());
+	auto& node = m_attachments.emplace_back();
+	node.name = name;
+	node.created = false;
+	node.imported = false;
+	node.refs = 0;
+	m_names.emplace(node.name, handle);
+	return handle;
+}
+
+void render_system::compile() {
+	m_attachments.clear();
+	m_names.clear();
+	m_order.clear();
+	m_transient_count = 0;
+	m_texture_count = 0;
+
+	for (auto& [name, tex] : m_imports) {
+		auto& node = m_attachments[find_or_add(name)];
+		node.imported = true;
+		node.tex = tex;
+	}
+
+	for (uint32_t i = 0; i < m_passes.size(); ++i) {
+		auto& node = m_passes[i];
+		node.reads.clear();
+		node.writes.clear();
+		node.side_effect = false;
+		node.culled = false;
+		node.target.reset();
+
+		render_pass_builder builder(*this, i);
+		node.pass->setup(builder);
+	}
+
+	for (auto& node : m_attachments) {
+		if (!node.created && !node.imported) {
+			LOG_ERROR("The attachment \"%s\" is neither created nor imported", node.name.c_str());
+			return;
+		}
+	}
+
+	cull();
+	if (!sort()) return;
+	allocate();
+	m_compiled = true;
+
+	LOG_DEBUG("Frame graph: %u of %u passes culled, %u transient attachments in %u textures",
+	          culled_passes_count(), static_cast<uint32_t>(m_passes.size()),
+	          m_transient_count, m_texture_count);
+}
+
+void render_system::cull() {
+	/*
+	A pass is alive while some attachment it writes is read, an attachment is
+	alive while some alive pass reads it. Imported attachments are considered
+	read by the outside world.
+	*/
+	std::vector<attachment_handle> unused;
+	for (attachment_handle h = 0; h < m_attachments.size(); ++h) {
+		auto& node = m_attachments[h];
+		node.refs = static_cast<uint32_t>(node.readers.size()) + (node.imported ? 1 : 0);
+		if (node.refs == 0) unused.push_back(h);
+	}
+
+	auto cull_pass = [this, &unused](pass_node& pass) {
+		pass.culled = true;
+		for (auto h : pass.reads) {
+			if (--m_attachments[h].refs == 0) unused.push_back(h);
+		}
+	};
+
+	for (auto& pass : m_passes) {
+		pass.refs = static_cast<uint32_t>(pass.writes.size());
+		if (pass.refs == 0 && !pass.side_effect) cull_pass(pass);
+	}
+
+	while (!unused.empty()) {
+		auto h = unused.back();
+		unused.pop_back();
+		for (auto writer : m_attachments[h].writers) {
+			auto& pass = m_passes[writer];
+			if (!pass.side_effect && !pass.culled && --pass.refs == 0) cull_pass(pass);
+		}
+	}
+}
+
+bool render_system::sort() {
+	auto count = static_cast<uint32_t>(m_passes.size());
+	std::vector<std::vector<uint32_t>> successors(count);
+	std::vector<uint32_t> in_degree(count, 0);
+
+	auto add_edge = [&](uint32_t from, uint32_t to) {
+		if (from == to) return;
+		successors[from].push_back(to);
+		++in_degree[to];
+	};
+
+	/*
+	Writers of an attachment execute in order of declaration. A reader sees the
+	content of the last writer declared before it, or of the first writer if it
+	is declared before all of them, and must execute before the next writer.
+	*/
+	for (auto& node : m_attachments) {
+		std::vector<uint32_t> writers;
+		for (auto w : node.writers) {
+			if (!m_passes[w].culled && (writers.empty() || writers.back() != w)) {
+				writers.push_back(w);
+			}
+		}
+		for (std::size_t i = 1; i < writers.size(); ++i) {
+			add_edge(writers[i - 1], writers[i]);
+		}
+		if (writers.empty()) continue;
+
+		for (auto r : node.readers) {
+			if (m_passes[r].culled) continue;
+
+			// writers before r, and r itself if it reads and writes the attachment
+			auto lo = std::lower_bound(writers.begin(), writers.end(), r);
+			auto hi = std::upper_bound(writers.begin(), writers.end(), r);
+			if (lo != writers.begin()) {
+				add_edge(*(lo - 1), r);
+				if (hi != writers.end()) add_edge(r, *hi);
+			}
+			else if (lo == hi) {
+				add_edge(writers.front(), r);
+				if (writers.size() > 1) add_edge(r, writers[1]);
+			}
+			else if (hi != writers.end()) {
+				add_edge(r, *hi);
+			}
+		}
+	}
+
+	// Kahn's algorithm, preferring the order of declaration
+	std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+	uint32_t alive = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		if (m_passes[i].culled) continue;
+		++alive;
+		if (in_degree[i] == 0) ready.push(i);
+	}
+
+	while (!ready.empty()) {
+		auto pass = ready.top();
+		ready.pop();
+		m_order.push_back(pass);
+		for (auto next : successors[pass]) {
+			if (--in_degree[next] == 0) ready.push(next);
+		}
+	}
+
+	if (m_order.size() != alive) {
+		LOG_ERROR("The render passes have cyclic dependencies");
+		m_order.clear();
+		return false;
+	}
+	return true;
+}
+
+void render_system::allocate() {
+	constexpr auto unused = std::numeric_limits<uint32_t>::max();
+	for (auto& node : m_attachments) {
+		node.first_use = unused;
+		node.last_use = 0;
+	}
+
+	for (uint32_t pos = 0; pos < m_order.size(); ++pos) {
+		auto& pass = m_passes[m_order[pos]];
+		for (auto& handles : {std::cref(pass.reads), std::cref(pass.writes)}) {
+			for (auto h : handles.get()) {
+				auto& node = m_attachments[h];
+				node.first_use = std::min(node.first_use, pos);
+				node.last_use = std::max(node.last_use, pos);
+			}
+		}
+	}
+
+	// transient attachments starting and ending at every position
+	std::vector<std::vector<attachment_handle>> starts(m_order.size());
+	std::vector<std::vector<attachment_handle>> ends(m_order.size());
+	for (attachment_handle h = 0; h < m_attachments.size(); ++h) {
+		auto& node = m_attachments[h];
+		if (node.imported || node.first_use == unused) continue;
+		starts[node.first_use].push_back(h);
+		ends[node.last_use].push_back(h);
+		++m_transient_count;
+	}
+
+	// textures no longer used by any live attachment, ready to be aliased
+	std::map<texture_description, std::vector<ref<texture>>> released;
+
+	for (uint32_t pos = 0; pos < m_order.size(); ++pos) {
+		for (auto h : starts[pos]) {
+			auto& node = m_attachments[h];
+			auto& pool = released[node.description];
+			if (pool.empty()) {
+				node.tex = texture_manager::instance().new_texture(node.description);
+				++m_texture_count;
+			}
+			else {
+				node.tex = pool.back();
+				pool.pop_back();
+			}
+		}
+		for (auto h : ends[pos]) {
+			auto& node = m_attachments[h];
+			released[node.description].push_back(node.tex);
+		}
+	}
+
+	for (auto index : m_order) {
+		auto& pass = m_passes[index];
+		if (pass.writes.empty()) continue;
+
+		pass.target = std::make_unique<framebuffer>();
+		for (auto h : pass.writes) {
+			pass.target->add_attachments(m_attachments[h].tex);
+		}
+		if (!pass.target->is_complete()) {
+			LOG_ERROR("The framebuffer of the render pass \"%s\" is incomplete", pass.pass->name().c_str());
+		}
+	}
+}
+
+void render_system::execute() {
+	if (!m_compiled) {
+		compile();
+		if (!m_compiled) return;
+	}
+
+	auto& state = gl_state::instance();
+	for (auto index : m_order) {
+		auto& pass = m_passes[index];
+		state.bind_framebuffer(GL_FRAMEBUFFER, pass.target ? pass.target->name() : 0);
+		pass.pass->execute(*this);
+	}
+	state.bind_framebuffer(GL_FRAMEBUFFER, 0);
+}
+
+ref<texture> render_system::attachment(attachment_handle handle) const {
+	if (handle < m_attachments.size()) {
+		return m_attachments[handle].tex;
+	}
+	return nullptr;
+}
+
+uint32_t render_system::culled_passes_count() const {
+	return static_cast<uint32_t>(std::count_if(m_passes.begin(), m_passes.end(),
+	                                           [](const pass_node& pass) { return pass.culled; }));
+}
+
+}  // namespace setsuna
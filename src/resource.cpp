@@ -1,13 +1,19 @@
 #include <setsuna/rtti_prefix.h>
 #include <setsuna/logger.h>
+#include <atomic>
 
 namespace setsuna {
 
+static uint32_t next_resource_id() {
+	static std::atomic<uint32_t> cnt{1};
+	return cnt++;
+}
+
 resource::resource() :
-    m_ref_count{0} {}
+    m_ref_count{0}, m_id{next_resource_id()} {}
 
 resource::resource(const resource&) :
-    m_ref_count{0} {
+    m_ref_count{0}, m_id{next_resource_id()} {
 	// copy nothing
 }
 
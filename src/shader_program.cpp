@@ -1,8 +1,10 @@
 #include <setsuna/shader_program.h>
 #include <setsuna/texture_property.h>
 #include <setsuna/logger.h>
+#include <setsuna/gl_state.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <fstream>
+#include <algorithm>
 #include <regex>
 
 #define INVALID_LOCATION 0xFFFFFFFF
@@ -20,6 +22,7 @@ shader_program::~shader_program() {
 	m_shaders.clear();
 
 	if (m_program != 0) {
+		gl_state::instance().on_delete_program(m_program);
 		glDeleteProgram(m_program);
 	}
 }
@@ -192,77 +195,91 @@ void shader_program::compile() {
 	}
 }
 
-GLint* shader_program::get_uniform_location(std::string_view& name) {
+template<typename T>
+GLint* shader_program::prepare_upload(std::string_view& name, const T& value) {
 	if (m_program == 0) return nullptr;
 
-	GLint* locations = nullptr;
 	auto search = m_uniforms.find(name);  // O(log(n))
-	if (search != m_uniforms.end()) {
-		locations = search->second.locations.data();
-	}
-	else {
+	if (search == m_uniforms.end()) {
 		LOG_WARNING("The uniform variable \"%s\" doesn't exist", name.data())
+		return nullptr;
+	}
+
+	auto& cached = search->second.value;
+	auto bytes = reinterpret_cast<const uint8_t*>(&value);
+	if (cached.size() == sizeof(T) && std::equal(cached.begin(), cached.end(), bytes)) {
+		gl_state::instance().count_elided();
+		return nullptr;
 	}
-	return locations;
+
+	cached.assign(bytes, bytes + sizeof(T));
+	gl_state::instance().count_issued();
+	return search->second.locations.data();
 }
 
 void shader_program::upload_uniform(std::string_view name, int value) {
-	auto location = get_uniform_location(name);
+	auto location = prepare_upload(name, value);
 	if (location != nullptr) {
 		glUniform1i(*location, value);
 	}
 }
 
 void shader_program::upload_uniform(std::string_view name, float value) {
-	auto location = get_uniform_location(name);
+	auto location = prepare_upload(name, value);
 	if (location != nullptr) {
 		glUniform1f(*location, value);
 	}
 }
 
 void shader_program::upload_uniform(std::string_view name, bool value) {
-	auto location = get_uniform_location(name);
+	auto location = prepare_upload(name, value);
 	if (location != nullptr) {
 		glUniform1i(*location, value);
 	}
 }
 
 void shader_program::upload_uniform(std::string_view name, const glm::vec2& value) {
-	auto location = get_uniform_location(name);
+	auto location = prepare_upload(name, value);
 	if (location != nullptr) {
 		glUniform2f(*location, value.x, value.y);
 	}
 }
 
 void shader_program::upload_uniform(std::string_view name, const glm::vec3& value) {
-	auto location = get_uniform_location(name);
+	auto location = prepare_upload(name, value);
 	if (location != nullptr) {
 		glUniform3f(*location, value.x, value.y, value.z);
 	}
 }
 
 void shader_program::upload_uniform(std::string_view name, const glm::mat3& value) {
-	auto location = get_uniform_location(name);
+	auto location = prepare_upload(name, value);
 	if (location != nullptr) {
 		glUniformMatrix3fv(*location, 1, GL_FALSE, glm::value_ptr(value));
 	}
 }
 
 void shader_program::upload_uniform(std::string_view name, const glm::mat4& value) {
-	auto location = get_uniform_location(name);
+	auto location = prepare_upload(name, value);
 	if (location != nullptr) {
 		glUniformMatrix4fv(*location, 1, GL_FALSE, glm::value_ptr(value));
 	}
 }
 
 void shader_program::upload_uniform(std::string_view name, const texture_address& value) {
-	auto location = get_uniform_location(name);
+	auto location = prepare_upload(name, value);
 	if (location != nullptr) {
 		glUniform1i(location[0], value.unit);
 		glUniform1i(location[1], value.layer);
 	}
 }
 
+GLint shader_program::uniform_location(std::string_view name) const {
+	auto search = m_uniforms.find(name);
+	if (search == m_uniforms.end() || search->second.locations.empty()) return -1;
+	return search->second.locations.front();
+}
+
 void shader_program::apply() {
 #ifdef _DEBUG
 	glValidateProgram(m_program);
@@ -277,7 +294,7 @@ void shader_program::apply() {
 		delete[] info;
 	}
 #endif
-	glUseProgram(m_program);
+	gl_state::instance().use_program(m_program);
 }
 
 }  // namespace setsuna
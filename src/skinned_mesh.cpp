@@ -0,0 +1,138 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/skinned_mesh.h>
+#include <setsuna/skinning_pass.h>
+#include <setsuna/logger.h>
+#include <setsuna/simd.h>
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+
+namespace setsuna {
+
+vertex_layout skinned_mesh::layout() {
+	return vertex_layout{{{0, 3, GL_FLOAT, offsetof(vertex, position), false},
+	                      {1, 3, GL_FLOAT, offsetof(vertex, normal), false},
+	                      {2, 2, GL_FLOAT, offsetof(vertex, texcoord), false}},
+	                     sizeof(vertex)};
+}
+
+skinned_mesh::skinned_mesh(object3d& o3d, skinning_pass& pass, skin bind_pose, uint32_t joints_count) :
+    component(o3d), m_pass{&pass}, m_bind_pose(std::move(bind_pose)),
+    m_joint_matrices(std::max(joints_count, 1u), glm::mat4(1.0f)),
+    m_skinning_seconds{0.0}, m_upload_seconds{0.0} {
+	auto& s = m_bind_pose;
+	auto count = s.positions.size();
+	if (s.joints.size() != count || s.weights.size() != count) {
+		LOG_ERROR("The joints and weights of the skin do not match its positions");
+		s.positions.clear();
+		s.indices.clear();
+		count = 0;
+	}
+	s.normals.resize(count);
+	s.texcoords.resize(count);
+	s.joints.resize(count);
+	s.weights.resize(count);
+
+	// every influence refers to an existing joint, so skinning needs no checks
+	for (std::size_t i = 0; i < count; ++i) {
+		auto& joints = s.joints[i];
+		auto& weights = s.weights[i];
+		for (int k = 0; k < 4; ++k) {
+			if (joints[k] >= joints_count || !(weights[k] > 0.0f)) {
+				joints[k] = 0;
+				weights[k] = 0.0f;
+			}
+		}
+		auto sum = weights.x + weights.y + weights.z + weights.w;
+		weights = sum > 0.0f ? weights / sum : glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	m_vertices.resize(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		m_vertices[i].texcoord = s.texcoords[i];
+	}
+
+	auto vertices_count = static_cast<uint32_t>(count);
+	auto indices_count = static_cast<uint32_t>(s.indices.size());
+	m_target = dynamic_mesh::create(layout(), std::max(vertices_count, 1u), std::max(indices_count, 1u));
+	m_target->update_indices(0, s.indices.data(), indices_count);
+	m_target->set_counts(vertices_count, indices_count);
+}
+
+void skinned_mesh::update() {
+	m_pass->add(*this);
+}
+
+aabb<3> skinned_mesh::deform(uint32_t begin, uint32_t end) {
+	aabb<3> box;
+	if (begin >= end) return box;
+
+	auto matrices = m_joint_matrices.data();
+	auto& s = m_bind_pose;
+
+#ifdef SETSUNA_SSE2
+	auto box_min = _mm_set1_ps(FLT_MAX);
+	auto box_max = _mm_set1_ps(-FLT_MAX);
+	for (auto i = begin; i < end; ++i) {
+		auto& joints = s.joints[i];
+		auto& weights = s.weights[i];
+
+		// blend the columns of the four matrices
+		auto c0 = _mm_setzero_ps(), c1 = _mm_setzero_ps(), c2 = _mm_setzero_ps(), c3 = _mm_setzero_ps();
+		for (int k = 0; k < 4; ++k) {
+			auto w = _mm_set1_ps(weights[k]);
+			auto& m = matrices[joints[k]];
+			c0 = _mm_add_ps(c0, _mm_mul_ps(w, _mm_loadu_ps(&m[0].x)));
+			c1 = _mm_add_ps(c1, _mm_mul_ps(w, _mm_loadu_ps(&m[1].x)));
+			c2 = _mm_add_ps(c2, _mm_mul_ps(w, _mm_loadu_ps(&m[2].x)));
+			c3 = _mm_add_ps(c3, _mm_mul_ps(w, _mm_loadu_ps(&m[3].x)));
+		}
+
+		auto& p = s.positions[i];
+		auto position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p.x)), _mm_mul_ps(c1, _mm_set1_ps(p.y))),
+		                           _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p.z)), c3));
+		auto& n = s.normals[i];
+		auto normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(n.x)), _mm_mul_ps(c1, _mm_set1_ps(n.y))),
+		                         _mm_mul_ps(c2, _mm_set1_ps(n.z)));
+
+		// the last lane of an affine transformed direction is zero
+		auto length_sq = _mm_mul_ps(normal, normal);
+		length_sq = _mm_add_ps(length_sq, _mm_movehl_ps(length_sq, length_sq));
+		length_sq = _mm_add_ss(length_sq, _mm_shuffle_ps(length_sq, length_sq, _MM_SHUFFLE(1, 1, 1, 1)));
+		auto scale = _mm_div_ss(_mm_set_ss(1.0f), _mm_sqrt_ss(_mm_max_ss(length_sq, _mm_set_ss(FLT_MIN))));
+		normal = _mm_mul_ps(normal, _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(0, 0, 0, 0)));
+
+		box_min = _mm_min_ps(box_min, position);
+		box_max = _mm_max_ps(box_max, position);
+
+		alignas(16) float result[8];
+		_mm_store_ps(result, position);
+		_mm_store_ps(result + 4, normal);
+		auto& v = m_vertices[i];
+		v.position = glm::vec3(result[0], result[1], result[2]);
+		v.normal = glm::vec3(result[4], result[5], result[6]);
+	}
+
+	alignas(16) float extent[8];
+	_mm_store_ps(extent, box_min);
+	_mm_store_ps(extent + 4, box_max);
+	box.min = glm::vec3(extent[0], extent[1], extent[2]);
+	box.max = glm::vec3(extent[4], extent[5], extent[6]);
+#else
+	for (auto i = begin; i < end; ++i) {
+		auto& joints = s.joints[i];
+		auto& weights = s.weights[i];
+		auto m = matrices[joints.x] * weights.x + matrices[joints.y] * weights.y +
+		         matrices[joints.z] * weights.z + matrices[joints.w] * weights.w;
+
+		auto& v = m_vertices[i];
+		v.position = glm::vec3(m * glm::vec4(s.positions[i], 1.0f));
+		auto normal = glm::vec3(m * glm::vec4(s.normals[i], 0.0f));
+		v.normal = normal / std::sqrt(std::max(glm::dot(normal, normal), FLT_MIN));
+		box.expand(v.position);
+	}
+#endif
+	return box;
+}
+
+}  // namespace setsuna
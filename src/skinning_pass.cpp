@@ -0,0 +1,76 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/skinning_pass.h>
+#include <setsuna/skinned_mesh.h>
+#include <setsuna/object3d.h>
+#include <setsuna/thread_pool.h>
+#include <algorithm>
+#include <chrono>
+
+namespace setsuna {
+
+skinning_pass::skinning_pass(thread_pool& pool) :
+    m_pool{&pool}, m_meshes_count{0}, m_vertices_count{0}, m_seconds{0.0} {}
+
+void skinning_pass::add(skinned_mesh& mesh) {
+	m_queue.push_back(&mesh);
+}
+
+void skinning_pass::run() {
+	using clock = std::chrono::steady_clock;
+	auto start = clock::now();
+
+	// a mesh reachable twice in the scene is skinned once
+	std::sort(m_queue.begin(), m_queue.end());
+	m_queue.erase(std::unique(m_queue.begin(), m_queue.end()), m_queue.end());
+
+	m_tasks.clear();
+	m_vertices_count = 0;
+	for (auto mesh : m_queue) {
+		auto count = mesh->vertices_count();
+		for (uint32_t begin = 0; begin < count; begin += chunk_vertices) {
+			m_tasks.push_back(task{mesh, begin, std::min(begin + chunk_vertices, count), 0.0, aabb<3>()});
+		}
+		m_vertices_count += count;
+	}
+
+	m_pool->run(m_tasks.size(), [this](std::size_t i) {
+		auto& t = m_tasks[i];
+		auto begin = clock::now();
+		t.box = t.mesh->deform(t.begin, t.end);
+		t.seconds = std::chrono::duration<double>(clock::now() - begin).count();
+	});
+
+	// the tasks of a mesh are consecutive
+	std::size_t i = 0;
+	for (auto mesh : m_queue) {
+		aabb<3> box;
+		mesh->m_skinning_seconds = 0.0;
+		for (; i < m_tasks.size() && m_tasks[i].mesh == mesh; ++i) {
+			box.expand(m_tasks[i].box.min);
+			box.expand(m_tasks[i].box.max);
+			mesh->m_skinning_seconds += m_tasks[i].seconds;
+		}
+
+		auto begin = clock::now();
+		auto count = mesh->vertices_count();
+		auto& target = mesh->m_target;
+		target->begin_frame(count);
+		target->update_vertices(0, mesh->m_vertices.data(), count);
+		if (count > 0) {
+			auto bounding_sphere = sphere(box.center(), glm::length(box.extent()));
+			target->set_bounds(box, bounding_sphere);
+
+			// for culling, the scene update has refreshed the world matrix
+			auto& world_matrix = mesh->object().world_matrix();
+			mesh->m_aabb = box.transformed(world_matrix);
+			mesh->m_bounding_sphere = bounding_sphere.transformed(world_matrix);
+		}
+		mesh->m_upload_seconds = std::chrono::duration<double>(clock::now() - begin).count();
+	}
+
+	m_meshes_count = static_cast<uint32_t>(m_queue.size());
+	m_queue.clear();
+	m_seconds = std::chrono::duration<double>(clock::now() - start).count();
+}
+
+}  // namespace setsuna
@@ -0,0 +1,56 @@
+#include <setsuna/stream_buffer.h>
+
+namespace setsuna {
+
+stream_buffer::stream_buffer(std::size_t region_size, uint32_t regions_count) :
+    m_fences(regions_count, nullptr),
+    m_region_size{(region_size + 255) & ~std::size_t(255)}, m_regions_count{regions_count},
+    m_region{0}, m_head{0}, m_started{false}, m_stalls{0} {
+	m_buffer.create<uint8_t>(m_region_size * m_regions_count);
+}
+
+stream_buffer::~stream_buffer() {
+	for (auto& fence : m_fences) {
+		if (fence != nullptr) glDeleteSync(fence);
+	}
+}
+
+void stream_buffer::begin_region() {
+	if (m_started) {
+		// every command using the current region has been issued by now
+		if (m_fences[m_region] != nullptr) glDeleteSync(m_fences[m_region]);
+		m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_region = (m_region + 1) % m_regions_count;
+	}
+	m_started = true;
+	m_head = 0;
+
+	auto& fence = m_fences[m_region];
+	if (fence == nullptr) return;
+
+	// poll first so that a stall is only counted when really waiting
+	auto status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		++m_stalls;
+		do {
+			// flush so that the fence is guaranteed to signal eventually
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (status == GL_TIMEOUT_EXPIRED);
+	}
+	if (status == GL_WAIT_FAILED) {
+		LOG_ERROR("Failed to wait for a stream buffer region");
+	}
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+std::optional<GLintptr> stream_buffer::allocate(std::size_t size, std::size_t alignment) {
+	auto offset = (m_head + alignment - 1) & ~(alignment - 1);
+	if (offset + size > m_region_size) return std::nullopt;
+
+	m_head = offset + size;
+	return static_cast<GLintptr>(m_region * m_region_size + offset);
+}
+
+}  // namespace setsuna
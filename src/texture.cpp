@@ -15,6 +15,10 @@ void texture::set_image(GLint mip_level, GLenum data_type, const void* data) {
 	m_container->upload(mip_level, m_layer, data_type, data);
 }
 
+void texture::set_image(GLint mip_level, GLenum data_type, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	m_container->upload(mip_level, m_layer, data_type, buffer, offset, size);
+}
+
 const texture_description& texture::description() const {
 	return m_container->description();
 }
@@ -1,5 +1,6 @@
 ﻿#include <setsuna/texture_container.h>
 #include <setsuna/logger.h>
+#include <setsuna/gl_state.h>
 #include <algorithm>
 #include <array>
 
@@ -97,6 +98,7 @@ texture_container::~texture_container() {
 		LOG_DEBUG("A texture_container is being destructed but it still has unreleased textures");
 	}
 
+	gl_state::instance().on_delete_texture(m_name);
 	glDeleteTextures(1, &m_name);
 }
 
@@ -150,6 +152,32 @@ void texture_container::upload(GLint mip_level, texture_layer l,
 	}
 }
 
+void texture_container::upload(GLint mip_level, texture_layer l, GLenum data_type,
+                               GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	commit_or_free(l, true);
+
+	auto width = std::max(m_desc.width >> mip_level, 1);
+	auto height = std::max(m_desc.height >> mip_level, 1);
+
+	// with a pixel unpack buffer bound, the data pointer is an offset into it
+	auto& state = gl_state::instance();
+	state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	if (m_desc.type == texture_type::TEX_CUBE_MAP) {
+		auto face_size = size / 6;
+		for (int i = 0; i < 6; ++i) {
+			glTextureSubImage3D(m_name, mip_level, 0, 0, 6 * l + i,
+			                    width, height, 1, sized_to_base(m_desc.format​),
+			                    data_type, reinterpret_cast<const void*>(offset + face_size * i));
+		}
+	}
+	else {
+		glTextureSubImage3D(m_name, mip_level, 0, 0, l,
+		                    width, height, 1, sized_to_base(m_desc.format​),
+		                    data_type, reinterpret_cast<const void*>(offset));
+	}
+	state.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
 void texture_container::commit_or_free(texture_layer l, bool commit) {
 	if (!m_sparse) return;
 
@@ -171,7 +199,7 @@ void texture_container::commit_or_free(texture_layer l, bool commit) {
 	}
 
 	// for now texture commitment cannot use DSA
-	glBindTexture(target, m_name);
+	gl_state::instance().bind_texture(target, m_name);
 
 	// commit(or de-commit) all mip levels
 	for (GLint level = 0; level < m_desc.mip_levels_count; ++level) {
@@ -181,7 +209,7 @@ void texture_container::commit_or_free(texture_layer l, bool commit) {
 		height = std::max(1, height / 2);
 	}
 
-	glBindTexture(target, 0);
+	gl_state::instance().bind_texture(target, 0);
 }
 
 }  // namespace setsuna
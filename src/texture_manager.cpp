@@ -1,6 +1,7 @@
 ﻿#include <setsuna/rtti_prefix.h>
 #include <setsuna/texture_manager.h>
 #include <setsuna/texture_container.h>
+#include <setsuna/gl_state.h>
 
 namespace setsuna {
 
@@ -40,14 +41,7 @@ ref<texture> texture_manager::new_texture(const texture_description& desc) {
 }
 
 void texture_manager::assign_unit(texture_unit unit, texture_container& container) {
-	auto old_container = m_units_assignments[unit];
-	if (old_container == nullptr) {
-		glActiveTexture(GL_TEXTURE0 + unit);
-	}
-	if (old_container != &container) {
-		m_units_assignments[unit] = &container;
-		glBindTextureUnit(unit, container.m_name);
-	}
+	gl_state::instance().bind_texture_unit(unit, container.m_name);
 }
 
 std::tuple<texture_container*, texture_layer>
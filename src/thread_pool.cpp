@@ -0,0 +1,92 @@
+#include <setsuna/thread_pool.h>
+
+namespace setsuna {
+
+thread_pool::thread_pool(uint32_t threads_count) :
+    m_task{nullptr}, m_tasks_count{0}, m_generation{0}, m_active{0}, m_stop{false}, m_next{0} {
+	if (threads_count == 0) {
+		auto hardware = std::thread::hardware_concurrency();
+		threads_count = hardware > 1 ? hardware - 1 : 1;
+	}
+
+	m_threads.reserve(threads_count);
+	for (uint32_t i = 0; i < threads_count; ++i) {
+		m_threads.emplace_back(&thread_pool::work, this);
+	}
+}
+
+thread_pool::~thread_pool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_job_cv.notify_all();
+
+	for (auto& t : m_threads) {
+		t.join();
+	}
+}
+
+void thread_pool::run(std::size_t tasks_count, const std::function<void(std::size_t)>& task) {
+	if (tasks_count == 0) return;
+	if (tasks_count == 1 || m_threads.empty()) {
+		for (std::size_t i = 0; i < tasks_count; ++i) {
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		m_tasks_count = tasks_count;
+		m_next.store(0, std::memory_order_relaxed);
+		++m_generation;
+	}
+	m_job_cv.notify_all();
+
+	drain(task, tasks_count);
+
+	/*
+	All tasks have been grabbed, wait for the workers still executing theirs.
+	Clearing the job under the lock guarantees that a worker waking up late
+	never touches a task of a finished job.
+	*/
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle_cv.wait(lock, [this]() { return m_active == 0; });
+	m_task = nullptr;
+	m_tasks_count = 0;
+}
+
+void thread_pool::work() {
+	uint64_t seen = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_job_cv.wait(lock, [&]() { return m_stop || m_generation != seen; });
+		if (m_stop) return;
+
+		seen = m_generation;
+		if (m_task == nullptr) continue;
+
+		auto task = m_task;
+		auto tasks_count = m_tasks_count;
+		++m_active;
+		lock.unlock();
+
+		drain(*task, tasks_count);
+
+		lock.lock();
+		if (--m_active == 0) {
+			m_idle_cv.notify_one();
+		}
+	}
+}
+
+void thread_pool::drain(const std::function<void(std::size_t)>& task, std::size_t tasks_count) {
+	for (auto i = m_next.fetch_add(1, std::memory_order_relaxed); i < tasks_count;
+	     i = m_next.fetch_add(1, std::memory_order_relaxed)) {
+		task(i);
+	}
+}
+
+}  // namespace setsuna
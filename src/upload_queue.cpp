@@ -0,0 +1,180 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/upload_queue.h>
+#include <setsuna/logger.h>
+#include <algorithm>
+
+namespace setsuna {
+
+// offsets of regions, enough for any texel or vertex type
+static constexpr uint64_t staging_alignment = 16;
+
+upload_queue::upload_queue() :
+    m_data{nullptr}, m_capacity{0}, m_head{0}, m_tail{0}, m_first_sequence{0}, m_rejected{0},
+    m_issued_bytes{0}, m_option{64 << 20, 16 << 20} {}
+
+// the context is gone by now, the ring and the fences are deleted by release()
+upload_queue::~upload_queue() {}
+
+std::optional<upload_queue::staging_region> upload_queue::reserve(std::size_t size) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_data == nullptr || size == 0 || size > m_capacity) {
+		++m_rejected;
+		return std::nullopt;
+	}
+
+	// a region never wraps around, the rest of the ring is skipped instead
+	auto begin = (m_head + staging_alignment - 1) & ~(staging_alignment - 1);
+	auto position = begin % m_capacity;
+	if (position + size > m_capacity) {
+		begin += m_capacity - position;
+		position = 0;
+	}
+	if (begin + size - m_tail > m_capacity) {
+		++m_rejected;
+		return std::nullopt;
+	}
+
+	m_head = begin + size;
+	m_reservations.push_back(reservation{m_head, false});
+	auto sequence = m_first_sequence + m_reservations.size() - 1;
+	return staging_region{m_data + position, size, static_cast<GLintptr>(position), sequence};
+}
+
+void upload_queue::release(const staging_region& region) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	mark_done(region.sequence);
+}
+
+void upload_queue::upload_buffer(const staging_region& region, GLuint buffer, GLintptr offset,
+                                 callback_t callback) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_requests.push_back(request{region, buffer, offset, nullptr, 0, GL_NONE, std::move(callback)});
+}
+
+void upload_queue::upload_texture(const staging_region& region, ref<texture> target, GLint mip_level,
+                                  GLenum data_type, callback_t callback) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_requests.push_back(request{region, 0, 0, std::move(target), mip_level, data_type, std::move(callback)});
+}
+
+void upload_queue::update() {
+	complete(false);
+
+	// create or resize the ring when nothing is in flight, under the lock so
+	// that no reservation is made from the old ring meanwhile
+	auto capacity = (m_option.staging_size + staging_alignment - 1) & ~(staging_alignment - 1);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (capacity != m_capacity && m_reservations.empty()) {
+			m_staging = buffer<buffer_usage::BU_PERSISTENT>();
+			m_staging.create<uint8_t>(capacity);
+			m_data = m_staging.data();
+			m_capacity = m_data != nullptr ? capacity : 0;
+			m_head = m_tail = 0;
+		}
+	}
+
+	issue(std::max<std::size_t>(m_option.frame_budget, 1));
+}
+
+void upload_queue::flush() {
+	issue(0);
+	complete(true);
+}
+
+void upload_queue::release() {
+	for (auto& b : m_batches) {
+		glDeleteSync(b.fence);
+	}
+	m_batches.clear();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_requests.clear();
+	// sequences of the dropped reservations never match a later one
+	m_first_sequence += m_reservations.size();
+	m_reservations.clear();
+	m_staging = buffer<buffer_usage::BU_PERSISTENT>();
+	m_data = nullptr;
+	m_capacity = 0;
+	m_head = m_tail = 0;
+}
+
+std::size_t upload_queue::pending_bytes() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return static_cast<std::size_t>(m_head - m_tail);
+}
+
+uint32_t upload_queue::rejected() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_rejected;
+}
+
+void upload_queue::issue(std::size_t budget) {
+	std::vector<request> requests;
+	m_issued_bytes = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		while (!m_requests.empty() && (budget == 0 || m_issued_bytes < budget)) {
+			m_issued_bytes += m_requests.front().region.size;
+			requests.push_back(std::move(m_requests.front()));
+			m_requests.pop_front();
+		}
+	}
+	if (requests.empty()) return;
+
+	batch b{nullptr, {}, {}, {}};
+	for (auto& r : requests) {
+		auto& region = r.region;
+		if (r.target) {
+			r.target->set_image(r.mip_level, r.data_type, m_staging.name(), region.offset,
+			                    static_cast<GLsizeiptr>(region.size));
+			b.targets.push_back(std::move(r.target));
+		}
+		else {
+			glCopyNamedBufferSubData(m_staging.name(), r.buffer, region.offset, r.offset,
+			                         static_cast<GLsizeiptr>(region.size));
+		}
+		b.sequences.push_back(region.sequence);
+		if (r.callback) b.callbacks.push_back(std::move(r.callback));
+	}
+
+	b.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_batches.push_back(std::move(b));
+}
+
+void upload_queue::complete(bool wait) {
+	while (!m_batches.empty()) {
+		auto& b = m_batches.front();
+		// flush so that the fence is guaranteed to signal eventually
+		auto status = glClientWaitSync(b.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+		                               wait ? GLuint64(-1) : 0);
+		if (status == GL_TIMEOUT_EXPIRED) break;
+		if (status == GL_WAIT_FAILED) {
+			LOG_ERROR("Wait for the uploads failed");
+		}
+		glDeleteSync(b.fence);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto sequence : b.sequences) mark_done(sequence);
+		}
+
+		// the callbacks may submit more uploads
+		auto callbacks = std::move(b.callbacks);
+		m_batches.pop_front();
+		for (auto& callback : callbacks) callback();
+	}
+}
+
+void upload_queue::mark_done(uint64_t sequence) {
+	if (sequence < m_first_sequence || sequence - m_first_sequence >= m_reservations.size()) return;
+
+	m_reservations[sequence - m_first_sequence].done = true;
+	while (!m_reservations.empty() && m_reservations.front().done) {
+		m_tail = m_reservations.front().end;
+		m_reservations.pop_front();
+		++m_first_sequence;
+	}
+}
+
+}  // namespace setsuna
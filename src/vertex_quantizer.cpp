@@ -0,0 +1,122 @@
+#include <setsuna/rtti_prefix.h>
+#include <setsuna/vertex_quantizer.h>
+#include <setsuna/logger.h>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace setsuna {
+
+// the inverse of the normalized fixed-point conversion of OpenGL 4.2+
+static int16_t to_snorm16(float v) {
+	return static_cast<int16_t>(std::round(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+static uint16_t to_unorm16(float v) {
+	return static_cast<uint16_t>(std::round(std::clamp(v, 0.0f, 1.0f) * 65535.0f));
+}
+
+attribute<glm::i16vec4> vertex_quantizer::quantize_positions(const std::vector<glm::vec3>& positions,
+                                                             glm::vec3& offset,
+                                                             float& scale) {
+	std::vector<glm::i16vec4> data(positions.size());
+	offset = glm::vec3(0.0f);
+	scale = 1.0f;
+	if (positions.empty()) return attribute(4, GL_SHORT, std::move(data), true);
+
+	auto min = positions.front();
+	auto max = positions.front();
+	for (auto& p : positions) {
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+
+	offset = (min + max) * 0.5f;
+	auto half_extent = (max - min) * 0.5f;
+	scale = std::max({half_extent.x, half_extent.y, half_extent.z});
+	if (scale <= 0.0f) scale = 1.0f;  // all positions coincide
+
+	auto inv_scale = 1.0f / scale;
+	for (std::size_t i = 0; i < positions.size(); ++i) {
+		auto q = (positions[i] - offset) * inv_scale;
+		data[i] = glm::i16vec4(to_snorm16(q.x), to_snorm16(q.y), to_snorm16(q.z), 32767);
+	}
+
+	return attribute(4, GL_SHORT, std::move(data), true);
+}
+
+attribute<glm::u16vec4> vertex_quantizer::half_positions(const std::vector<glm::vec3>& positions) {
+	std::vector<glm::u16vec4> data(positions.size());
+	auto one = glm::packHalf1x16(1.0f);
+	for (std::size_t i = 0; i < positions.size(); ++i) {
+		auto& p = positions[i];
+		data[i] = glm::u16vec4(glm::packHalf1x16(p.x), glm::packHalf1x16(p.y),
+		                       glm::packHalf1x16(p.z), one);
+	}
+
+	return attribute(4, GL_HALF_FLOAT, std::move(data));
+}
+
+/*
+Project the normal onto the octahedron |x| + |y| + |z| = 1, then unfold the
+lower half onto the corners of the square so that the whole sphere maps to [-1, 1]^2.
+*/
+attribute<glm::i16vec2> vertex_quantizer::encode_normals(const std::vector<glm::vec3>& normals) {
+	std::vector<glm::i16vec2> data(normals.size());
+	for (std::size_t i = 0; i < normals.size(); ++i) {
+		auto n = normals[i];
+		auto l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		if (l1 <= 0.0f) {
+			data[i] = glm::i16vec2(0, 0);
+			continue;
+		}
+		n /= l1;
+
+		glm::vec2 e(n.x, n.y);
+		if (n.z < 0.0f) {
+			e.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+			e.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		data[i] = glm::i16vec2(to_snorm16(e.x), to_snorm16(e.y));
+	}
+
+	return attribute(2, GL_SHORT, std::move(data), true);
+}
+
+glm::vec3 vertex_quantizer::decode_normal(const glm::i16vec2& encoded) {
+	auto ex = std::max(encoded.x / 32767.0f, -1.0f);
+	auto ey = std::max(encoded.y / 32767.0f, -1.0f);
+
+	glm::vec3 n(ex, ey, 1.0f - std::abs(ex) - std::abs(ey));
+	auto t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+
+attribute<glm::u16vec2> vertex_quantizer::quantize_texcoords(const std::vector<glm::vec2>& texcoords) {
+	std::vector<glm::u16vec2> data(texcoords.size());
+	auto clamped = false;
+	for (std::size_t i = 0; i < texcoords.size(); ++i) {
+		auto& uv = texcoords[i];
+		clamped = clamped || uv.x < 0.0f || uv.x > 1.0f || uv.y < 0.0f || uv.y > 1.0f;
+		data[i] = glm::u16vec2(to_unorm16(uv.x), to_unorm16(uv.y));
+	}
+
+	if (clamped) {
+		LOG_WARNING("Texture coordinates outside [0, 1] are clamped, consider half_texcoords()");
+	}
+
+	return attribute(2, GL_UNSIGNED_SHORT, std::move(data), true);
+}
+
+attribute<glm::u16vec2> vertex_quantizer::half_texcoords(const std::vector<glm::vec2>& texcoords) {
+	std::vector<glm::u16vec2> data(texcoords.size());
+	for (std::size_t i = 0; i < texcoords.size(); ++i) {
+		data[i] = glm::u16vec2(glm::packHalf1x16(texcoords[i].x), glm::packHalf1x16(texcoords[i].y));
+	}
+
+	return attribute(2, GL_HALF_FLOAT, std::move(data));
+}
+
+}  // namespace setsuna